@@ -1,5 +1,5 @@
 #shader vertex
-#version 400 core
+#version 430 core
 
 in vec4 vPosition;
 in vec4 vColor;
@@ -7,6 +7,7 @@ in vec3 vNormal;
 in vec2 vTexture;
 in vec3 vBarycentric;
 in vec4 vHighlight;
+in uint vDrawID;
 
 out vec4 fColor;
 out vec3 fNormal;
@@ -16,36 +17,62 @@ out vec3 fToEye;
 out vec4 fLightSpace;
 out vec3 fBarycentric;
 out vec4 fHighlight;
+flat out int fFieldOffset;
+
+// Shared with every shader through FrameUniforms (std140):
+layout(std140) uniform FrameData
+{
+	mat4 uProjectionMatrix;
+	mat4 uViewMatrix;
+	vec4 uEyePosition;
+};
+layout(std140) uniform LightData
+{
+	mat4 uLightViewMatrix;
+	mat4 uLightPerspectiveMatrix;
+	vec4 uLightPosition;
+	vec4 uSpecularColor;
+	vec4 uLightCoefficients; // ambient, diffuse, specular, shininess.
+};
 
-uniform mat4 uProjectionMatrix;
-uniform mat4 uViewMatrix;
 uniform mat4 uTransformMatrix;
 
-uniform vec3 uLightPosition;
-uniform vec3 uEyePosition;
+// Batched drawing: one transform per draw, selected by vDrawID.
+uniform int uBatched;
+layout(std430, binding = 0) readonly buffer DrawTransforms
+{
+	mat4 uDrawTransforms[];
+};
 
-uniform mat4 uLightViewMatrix;
-uniform mat4 uLightPerspectiveMatrix;
+// Where the mesh's triangles start in the scalar field, per draw or for the single mesh being drawn.
+uniform int uFieldOffset;
+layout(std430, binding = 1) readonly buffer DrawFieldOffsets
+{
+	int uDrawFieldOffsets[];
+};
 
 void main()
 {
+	mat4 transform = (uBatched == 1) ? uDrawTransforms[vDrawID] : uTransformMatrix;
+
 	// World position:
-	gl_Position = uProjectionMatrix * uViewMatrix * uTransformMatrix * vPosition;
+	gl_Position = uProjectionMatrix * uViewMatrix * transform * vPosition;
 
 	// Shadow map position:
-	fLightSpace = uLightPerspectiveMatrix * uLightViewMatrix* uTransformMatrix * vPosition;
+	fLightSpace = uLightPerspectiveMatrix * uLightViewMatrix* transform * vPosition;
 
 	fColor = vColor;
 	fNormal = vNormal;
 	fTexture = vTexture;
-	fToLight = uLightPosition - vPosition.xyz;
+	fToLight = uLightPosition.xyz - vPosition.xyz;
 	fToEye = vec3(0., 0., 0.) - gl_Position.xyz;
 	fBarycentric = vBarycentric;
 	fHighlight = vHighlight;
+	fFieldOffset = (uBatched == 1) ? uDrawFieldOffsets[vDrawID] : uFieldOffset;
 };
 
 #shader fragment
-#version 400 core
+#version 430 core
 
 in vec4 fColor;
 in vec3 fNormal;
@@ -55,23 +82,73 @@ in vec3 fToEye;
 in vec4 fLightSpace;
 in vec3 fBarycentric;
 in vec4 fHighlight;
+flat in int fFieldOffset;
 
-uniform float uAmbient;
-uniform float uDiffuse;
-uniform float uSpecular;
-uniform float uShininess;
-uniform vec3 uSpecularColor;
+// Shared with every shader through FrameUniforms (std140):
+layout(std140) uniform FrameData
+{
+	mat4 uProjectionMatrix;
+	mat4 uViewMatrix;
+	vec4 uEyePosition;
+};
+layout(std140) uniform LightData
+{
+	mat4 uLightViewMatrix;
+	mat4 uLightPerspectiveMatrix;
+	vec4 uLightPosition;
+	vec4 uSpecularColor;
+	vec4 uLightCoefficients; // ambient, diffuse, specular, shininess.
+};
 
 uniform int uWireframe;
 const float THICKNESS = 0.005;
 
+// Per-triangle scalar field. uFieldBase < 0 shows the vertex colors instead.
+uniform samplerBuffer uScalarField;
+uniform int uFieldBase;
+uniform vec3 uFieldRange; // min, mean, max.
+
+// Depth from the light, compared by the sampler:
+uniform sampler2DShadow uShadowMap;
+const float SHADOW_BIAS = 0.002;
+
 out vec4 color;
 
+// Same colormap as MeshComponent::InterpolateColor(): blue to green below the mean, green to red above it.
+vec3 Colormap(float value)
+{
+	float low = uFieldRange.x;
+	float mean = uFieldRange.y;
+	float high = uFieldRange.z;
+	if (value >= low && value < mean)
+	{
+		float percent = (value - low) / (mean - low);
+		return vec3(0, percent, 1.0 - percent);
+	}
+	else if (value > mean && value <= high)
+	{
+		float percent = pow((value - mean) / (high - mean), 1.0 / 3.0);
+		return vec3(percent, 1.0 - percent, 0);
+	}
+	else if (value == mean)
+	{
+		return vec3(0, 1.0, 0);
+	}
+	return vec3(1.0);
+}
+
 void main()
 {
 	int WIREFRAME = uWireframe < 1 ? 1 : 0;
+
+	vec4 baseColor = fColor;
+	if (uFieldBase >= 0 && fFieldOffset >= 0)
+	{
+		float value = texelFetch(uScalarField, uFieldBase + fFieldOffset + gl_PrimitiveID).r;
+		baseColor = vec4(Colormap(value), 1.0);
+	}
 	
-	vec4 drawColor = (fHighlight.r > 0) ? fHighlight : fColor;
+	vec4 drawColor = (fHighlight.r > 0) ? fHighlight : baseColor;
 	/*
 	if (fHighlight.r > 0)
 	{
@@ -86,20 +163,30 @@ void main()
 	vec3 unitToEye = normalize(fToEye);
 
 	// Ambient:
-	vec3 ambient = uAmbient * drawColor.xyz;
+	vec3 ambient = uLightCoefficients.x * drawColor.xyz;
 
 	// Diffuse:
 	float d = max(dot(fNormal, unitToLight), 0);
-	vec3 diffuse = uDiffuse * d * drawColor.xyz;
+	vec3 diffuse = uLightCoefficients.y * d * drawColor.xyz;
 
 	// Specular:
 	float s = 0;
 	if (dot(fNormal, unitToLight) > 0)
 	{
 		vec3 ref = normalize(reflect(unitToLight, fNormal));
-		s = pow(max(dot(unitToEye, ref), 0), uShininess);
+		s = pow(max(dot(unitToEye, ref), 0), uLightCoefficients.w);
+	}
+	vec3 specular = uLightCoefficients.z * s * uSpecularColor.xyz;
+
+	// Shadow: 1 when lit, 0 when something is between this fragment and the light.
+	vec3 lightSpace = fLightSpace.xyz / fLightSpace.w * 0.5 + 0.5;
+	float lit = 1.0;
+	if (all(greaterThanEqual(lightSpace, vec3(0.0))) && all(lessThanEqual(lightSpace, vec3(1.0))))
+	{
+		lit = texture(uShadowMap, vec3(lightSpace.xy, lightSpace.z - SHADOW_BIAS));
 	}
-	vec3 specular = uSpecular * s * uSpecularColor;
+	diffuse *= lit;
+	specular *= lit;
 
 	float closestEdge = min(fBarycentric.x, min(fBarycentric.y, fBarycentric.z));
 	float width = fwidth(closestEdge);
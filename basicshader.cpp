@@ -23,49 +23,27 @@ void BasicShader::BindAttributes()
 	BindAttribute(3, "vTexture");
 	BindAttribute(4, "vBarycentric");
 	BindAttribute(5, "vHighlight");
+	BindAttribute(6, "vDrawID");
 }
 
 // get uniform locations so uniforms can be bound to the correct shader variables.
 void BasicShader::GetAllUniformLocations()
 {
-	locationProjectionMatrix = GetUniformLocation("uProjectionMatrix");
-
-	locationViewMatrix = GetUniformLocation("uViewMatrix");
+	BindUniformBlock(FrameUniforms::FRAME_BLOCK_NAME, FrameUniforms::FRAME_BINDING);
+	BindUniformBlock(FrameUniforms::LIGHT_BLOCK_NAME, FrameUniforms::LIGHT_BINDING);
 
 	locationTransformMatrix = GetUniformLocation("uTransformMatrix");
 
-
-	locationAmbient = GetUniformLocation("uAmbient");
-
-	locationDiffuse = GetUniformLocation("uDiffuse");
-
-	locationSpecular = GetUniformLocation("uSpecular");
-	locationShininess = GetUniformLocation("uShininess");
-	locationSpecularColor = GetUniformLocation("uSpecularColor");
-
-	locationLightPosition = GetUniformLocation("uLightPosition");
-	locationEyePosition = GetUniformLocation("uEyePosition");
-
-	locationLightView = GetUniformLocation("uLightViewMatrix");
-	locationLightPerspective = GetUniformLocation("uLightPerspectiveMatrix");
 	locationShadowMap = GetUniformLocation("uShadowMap");
 	locationTexture = GetUniformLocation("uTexture");
 
 	locationWireframe = GetUniformLocation("uWireframe");
-}
+	locationBatched = GetUniformLocation("uBatched");
 
-// only need one matrix: modelViewProjection = model * view * projection.
-void BasicShader::LoadProjectionMatrix(glm::mat4& projection)
-{
-	//PrintRowMajor(mvp);
-	LoadUniform(locationProjectionMatrix, projection);
-}
-
-// only need one matrix: modelViewProjection = model * view * projection.
-void BasicShader::LoadViewMatrix(glm::mat4& view)
-{
-	//PrintRowMajor(mvp);
-	LoadUniform(locationViewMatrix, view);
+	locationScalarField = GetUniformLocation("uScalarField");
+	locationFieldBase = GetUniformLocation("uFieldBase");
+	locationFieldRange = GetUniformLocation("uFieldRange");
+	locationFieldOffset = GetUniformLocation("uFieldOffset");
 }
 
 void BasicShader::LoadTransformMatrix(glm::mat4& transform)
@@ -74,26 +52,8 @@ void BasicShader::LoadTransformMatrix(glm::mat4& transform)
 	LoadUniform(locationTransformMatrix, transform);
 }
 
-void BasicShader::LoadLighting(float ambient, float diffuse, float specular,
-				  float shininess, 
-				  glm::vec3 specularColor,
-				  glm::vec3 lightPosition,
-				  glm::vec3 eyePosition)
+void BasicShader::LoadShadows(int shadowMap)
 {
-	LoadUniform(locationAmbient, ambient);
-	LoadUniform(locationDiffuse, diffuse);
-	LoadUniform(locationSpecular, specular);
-	LoadUniform(locationShininess, shininess);
-	LoadUniform(locationSpecularColor, specularColor);
-
-	LoadUniform(locationLightPosition, lightPosition);
-	LoadUniform(locationEyePosition, eyePosition);
-}
-
-void BasicShader::LoadShadows(glm::mat4 lightView, glm::mat4 lightPerspective, int shadowMap)
-{
-	LoadUniform(locationLightView, lightView);
-	LoadUniform(locationLightPerspective, lightPerspective);
 	LoadUniform(locationShadowMap, shadowMap);
 }
 
@@ -108,6 +68,24 @@ void BasicShader::LoadWireframe(bool enableWireframe)
 	LoadUniform(locationWireframe, wireframe);
 }
 
+void BasicShader::LoadBatched(bool batched)
+{
+	int value = batched ? 1 : 0;
+	LoadUniform(locationBatched, value);
+}
+
+void BasicShader::LoadScalarField(int unit, int base, glm::vec3 range)
+{
+	LoadUniform(locationScalarField, unit);
+	LoadUniform(locationFieldBase, base);
+	LoadUniform(locationFieldRange, range);
+}
+
+void BasicShader::LoadFieldOffset(int offset)
+{
+	LoadUniform(locationFieldOffset, offset);
+}
+
 
 std::string BasicShader::shaderFile;
 
@@ -5,6 +5,7 @@
 
 #include "utilities.hpp"
 #include "shaderprogram.hpp"
+#include "frameuniforms.hpp"
 
 /** Implementation of a basic shader program.
  *
@@ -16,20 +17,24 @@
  * 4) vec2 vTexture
  * 5) vec3 vBarycentric
  * 6) vec4 vHighlight
+ * 7) uint vDrawID
+ *
+ * the following uniform blocks, shared with other shaders through FrameUniforms:
+ *
+ * 1) FrameData: projection and view matrices, eye position.
+ * 2) LightData: light view and perspective matrices, light position, specular color,
+ *    ambient/diffuse/specular/shininess coefficients.
  *
  * and the following uniforms:
  *
- * 1) mat4 uProjectionMatrix
- * 2) mat4 uViewMatrix
- * 3) mat4 uTransformMatrix
- * 4) float uAmbient, uDiffuse, uSpecular
- * 5) float uShininess
- * 6) float uSpecularColor
- * 7) vec3 uLightPosition
- * 8) vec3 uEyePosition
- * 10) mat4 uLightViewMatrix
- * 11) mat4 uLightPerspectiveMatrix
- * 12) int uWireframe
+ * 1) mat4 uTransformMatrix
+ * 2) sampler2DShadow uShadowMap
+ * 3) sampler2D uTexture
+ * 4) int uWireframe
+ * 5) int uBatched
+ * 6) samplerBuffer uScalarField
+ * 7) int uFieldBase, vec3 uFieldRange
+ * 8) int uFieldOffset
  */
 class BasicShader : public ShaderProgram
 {
@@ -44,24 +49,12 @@ public:
 	void Initialize();
 
 
-	/** Load the given projection matrix as a uniform. */
-	void LoadProjectionMatrix(glm::mat4& projection);
-
-	/** Load the given view matrix as a uniform. */
-	void LoadViewMatrix(glm::mat4& view);
-
-	/** Load the given transform matrix as a uniform. */
+	/** Load the given transform matrix as a uniform.
+	 * Projection, view and lighting come from the FrameData and LightData blocks instead. */
 	void LoadTransformMatrix(glm::mat4& transform);
 
-	/** Load lighting-related uniforms. */
-	void LoadLighting(float ambient, float diffuse, float specular,
-					  float shininess, 
-					  glm::vec3 specularColor,
-					  glm::vec3 lightPosition,
-					  glm::vec3 eyePosition);
-
-	/** Load shadow-related uniforms. */
-	void LoadShadows(glm::mat4 lightView, glm::mat4 lightPerspective, int shadowMap);
+	/** Load the texture unit of the shadow map. The light matrices come from the LightData block. */
+	void LoadShadows(int shadowMap);
 
 	/** Load texture. */
 	void LoadTexture(int unit);
@@ -69,6 +62,16 @@ public:
 	/** Load wireframe. */
 	void LoadWireframe(bool enableWireframe);
 
+	/** Choose between uTransformMatrix and the per-draw transforms of a BatchRenderer. */
+	void LoadBatched(bool batched);
+
+	/** Show a field of a ScalarField: where it starts in the buffer and its min, mean and max.
+	 * A negative base shows the vertex colors instead. */
+	void LoadScalarField(int unit, int base, glm::vec3 range);
+
+	/** Where the current mesh starts in each field, or -1. Only used when not batched. */
+	void LoadFieldOffset(int offset);
+
 
 private:
 
@@ -76,23 +79,10 @@ private:
 	static std::string shaderFile;
 
 
-	/** ID of the MVP matrix given by GetUniformLocation(mvp). */
-	uint locationProjectionMatrix;
-	uint locationViewMatrix;
+	/** ID of the model transform given by GetUniformLocation(). */
 	uint locationTransformMatrix;
 
-	/** ID of the lighting-related uniforms. */
-	uint locationAmbient;
-	uint locationDiffuse;
-	uint locationSpecular;
-	uint locationShininess;
-	uint locationSpecularColor;
-	uint locationLightPosition;
-	uint locationEyePosition;
-
 	/** ID of the shadow-related uniforms. */
-	uint locationLightView;
-	uint locationLightPerspective;
 	uint locationShadowMap;
 
 	/** ID of the texture-related uniforms. */
@@ -101,6 +91,15 @@ private:
 	/** ID of the uniforms for rendering effects. */
 	uint locationWireframe;
 
+	/** ID of the batched drawing switch. */
+	uint locationBatched;
+
+	/** ID of the scalar field uniforms. */
+	uint locationScalarField;
+	uint locationFieldBase;
+	uint locationFieldRange;
+	uint locationFieldOffset;
+
 	/** Debug print method. This really shouldn't be here. */
 	void PrintRowMajor(glm::mat4& matrix);
 
@@ -114,17 +113,19 @@ protected:
 	 * 4) 3 -> vTexture.
 	 * 5) 4 -> vBarycentric.
 	 * 6) 5 -> vHighlight.
+	 * 7) 6 -> vDrawID.
 	 */
 	void BindAttributes();
 
 
-	/** Get all uniform locations from the GPU:
+	/** Get all uniform locations from the GPU and bind the shared blocks:
 	 *
-	 * 1) Projection matrix.
-	 * 2) View matrix.
-	 * 3) Model transform matrix.
-	 * 4) All five lighting-related uniforms.
-	 * 5) Wireframe.
+	 * 1) FrameData and LightData blocks.
+	 * 2) Model transform matrix.
+	 * 3) Shadow map and texture units.
+	 * 4) Wireframe.
+	 * 5) Batched.
+	 * 6) Scalar field.
 	 */
 	void GetAllUniformLocations();
 
@@ -0,0 +1,139 @@
+#include "batchrenderer.hpp"
+
+BatchRenderer::BatchRenderer() {}
+BatchRenderer::~BatchRenderer() {}
+
+void BatchRenderer::Initialize()
+{
+	glGenBuffers(1, &indirectBufferID);
+	glGenBuffers(1, &transformBufferID);
+	glGenBuffers(1, &drawIDBufferID);
+	glGenBuffers(1, &fieldOffsetBufferID);
+}
+
+void BatchRenderer::Build(std::vector<MeshComponent>& meshes)
+{
+	PROFILE_SCOPE("BatchRenderer::Build");
+	commands.clear();
+	triangleCount = 0;
+
+	// One command per mesh, in mesh order, so a mesh index also selects its command and its transform.
+	std::vector<uint> drawIDs;
+	std::vector<int> fieldOffsets;
+	for (int i = 0; i < meshes.size(); ++i)
+	{
+		DrawElementsIndirectCommand command;
+		command.count = 0; // Meshes without an allocation are skipped in Draw().
+		command.instanceCount = 1;
+		command.firstIndex = 0;
+		command.baseVertex = 0;
+		command.baseInstance = i; // Selects vDrawID for this draw.
+
+		if (meshes[i].getAllocation() != -1)
+		{
+			GPUAllocation& allocation = GPUMemory::GetAllocation(meshes[i].getAllocation());
+			command.count = allocation.indexCount;
+			command.firstIndex = allocation.indexOffset;
+			command.baseVertex = allocation.vertexOffset;
+			triangleCount += allocation.indexCount / 3;
+		}
+		commands.push_back(command);
+		drawIDs.push_back(i);
+		fieldOffsets.push_back(meshes[i].fieldOffset);
+	}
+
+	// Sized for every mesh; Draw() fills in only the commands that are actually drawn.
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBufferID);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	glBindBuffer(GL_ARRAY_BUFFER, drawIDBufferID);
+	glBufferData(GL_ARRAY_BUFFER, drawIDs.size() * sizeof(uint), drawIDs.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, fieldOffsetBufferID);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, fieldOffsets.size() * sizeof(int), fieldOffsets.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	UpdateTransforms(meshes);
+}
+
+void BatchRenderer::UpdateTransforms(std::vector<MeshComponent>& meshes)
+{
+	transforms.clear();
+	for (int i = 0; i < meshes.size(); ++i)
+	{
+		transforms.push_back(meshes[i].transform);
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, transformBufferID);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, transforms.size() * sizeof(glm::mat4), transforms.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void BatchRenderer::Draw()
+{
+	std::vector<int> all;
+	for (int i = 0; i < commands.size(); ++i)
+	{
+		all.push_back(i);
+	}
+	Draw(all);
+}
+
+void BatchRenderer::Draw(const std::vector<int>& visible)
+{
+	PROFILE_SCOPE("BatchRenderer::Draw");
+	frameCommands.clear();
+	for (int i = 0; i < visible.size(); ++i)
+	{
+		DrawElementsIndirectCommand& command = commands[visible[i]];
+		if (command.count > 0)
+		{
+			frameCommands.push_back(command);
+		}
+	}
+	if (frameCommands.empty())
+	{
+		return;
+	}
+
+	glBindVertexArray(GPUMemory::getVAO());
+
+	// Per-draw index into the transform buffer: one value per "instance", starting at baseInstance.
+	glBindBuffer(GL_ARRAY_BUFFER, drawIDBufferID);
+	glVertexAttribIPointer(DRAW_ID_ATTRIBUTE, 1, GL_UNSIGNED_INT, sizeof(uint), 0);
+	glVertexAttribDivisor(DRAW_ID_ATTRIBUTE, 1);
+	glEnableVertexAttribArray(DRAW_ID_ATTRIBUTE);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TRANSFORM_BINDING, transformBufferID);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, FIELD_OFFSET_BINDING, fieldOffsetBufferID);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBufferID);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, frameCommands.size() * sizeof(DrawElementsIndirectCommand), frameCommands.data());
+
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, frameCommands.size(), 0);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glDisableVertexAttribArray(DRAW_ID_ATTRIBUTE);
+	glBindVertexArray(0);
+}
+
+void BatchRenderer::CleanUp()
+{
+	glDeleteBuffers(1, &indirectBufferID);
+	glDeleteBuffers(1, &transformBufferID);
+	glDeleteBuffers(1, &drawIDBufferID);
+	glDeleteBuffers(1, &fieldOffsetBufferID);
+	commands.clear();
+	frameCommands.clear();
+	transforms.clear();
+}
+
+uint BatchRenderer::getDrawCount()
+{
+	return commands.size();
+}
+uint BatchRenderer::getTriangleCount()
+{
+	return triangleCount;
+}
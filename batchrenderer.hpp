@@ -0,0 +1,88 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+#include <iostream>
+#include "glm/glm.hpp"
+
+#include "utilities.hpp"
+#include "meshcomponent.hpp"
+#include "gpumemory.hpp"
+#include "profiler.hpp"
+
+/** Layout of one command for glMultiDrawElementsIndirect(), as defined by OpenGL. */
+struct DrawElementsIndirectCommand
+{
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+/** Draw many meshes with a single glMultiDrawElementsIndirect() call.
+ *
+ * All meshes already share the buffers of GPUMemory, so a draw only needs to know where each mesh starts.
+ * Build() records one indirect command per mesh and puts every model transform into a shader storage buffer.
+ *
+ * The shader finds its transform through the vDrawID attribute: it is read from a buffer of draw indices
+ * with an attribute divisor of 1, and each command's baseInstance selects its own index.
+ * This works on OpenGL 4.3 without needing gl_DrawID.
+ *
+ * The scalar field offset of each mesh is kept in a second storage buffer, also indexed by vDrawID.
+ *
+ * Commands are indexed by mesh, so a culled subset of the meshes can be drawn by passing their indices to Draw(). */
+class BatchRenderer
+{
+public:
+
+	BatchRenderer();
+	~BatchRenderer();
+
+	/** Create the indirect, transform and draw ID buffers. Needs an OpenGL context. */
+	void Initialize();
+
+	/** Record the draw commands and transforms for the given meshes and upload them.
+	 * Call this whenever meshes are added, removed or re-uploaded. */
+	void Build(std::vector<MeshComponent>& meshes);
+
+	/** Upload the current transforms of the meshes given to Build(). */
+	void UpdateTransforms(std::vector<MeshComponent>& meshes);
+
+	/** Issue one draw for every mesh. The shader must be active and in batched mode. */
+	void Draw();
+
+	/** Issue one draw for each of the given mesh indices, e.g. the meshes that survived culling. */
+	void Draw(const std::vector<int>& visible);
+
+	/** Release all resources. */
+	void CleanUp();
+
+	// getters:
+	uint getDrawCount();
+	uint getTriangleCount();
+
+	/** The binding point of the transform storage buffer. Must match basic.shader. */
+	static const uint TRANSFORM_BINDING = 0;
+
+	/** The binding point of the scalar field offset storage buffer. Must match basic.shader. */
+	static const uint FIELD_OFFSET_BINDING = 1;
+
+	/** The attribute location of vDrawID. Must match BasicShader::BindAttributes(). */
+	static const uint DRAW_ID_ATTRIBUTE = 6;
+
+private:
+
+	uint indirectBufferID = 0;
+	uint transformBufferID = 0;
+	uint drawIDBufferID = 0;
+	uint fieldOffsetBufferID = 0;
+
+	std::vector<DrawElementsIndirectCommand> commands;
+	std::vector<DrawElementsIndirectCommand> frameCommands; // The commands uploaded by the last Draw().
+	std::vector<glm::mat4> transforms;
+
+	uint triangleCount = 0;
+
+};
@@ -0,0 +1,347 @@
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <ctime>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <functional>
+#include <unistd.h>
+
+#include "polyhedron.hpp"
+#include "subdivision.hpp"
+#include "smoothing.hpp"
+#include "meshanalysis.hpp"
+#include "meshfactory.hpp"
+#include "perlinnoise.hpp"
+#include "parallel.hpp"
+
+/** Benchmarks of the core algorithms, without a window or an OpenGL context.
+ *
+ * Every benchmark runs on synthetic meshes: a closed UV sphere written out as an ASCII .ply (so loading is measured too),
+ * and Perlin noise terrain from MeshFactory. The results go out as JSON, one entry per benchmark with the time of every run,
+ * so they can be kept and compared from build to build.
+ *
+ * Usage: bench [options]
+ *	-s size			Rings of the sphere; it has about 2 size^2 vertices and 4 size^2 triangles (default 100).
+ *	-l levels		Loop subdivision levels (default 2).
+ *	-r runs			Runs of every benchmark (default 5).
+ *	-j threads		Threads to use (default: all).
+ *	-o file			Where to write the JSON (default: standard output). */
+
+struct BenchOptions
+{
+	int size = 100;
+	int levels = 2;
+	int runs = 5;
+	std::string output;
+};
+
+// Times of one benchmark, in milliseconds.
+struct BenchResult
+{
+	std::string name;
+	long elements = 0; // What the benchmark processes per run: vertices, triangles, samples...
+	std::string unit;
+	std::vector<double> milliseconds;
+};
+
+std::vector<BenchResult> results;
+
+// Run setup (not timed) and then body (timed) the given number of times.
+void Measure(const std::string& name, long elements, const std::string& unit, int runs, std::function<void()> setup, std::function<void()> body)
+{
+	BenchResult result;
+	result.name = name;
+	result.elements = elements;
+	result.unit = unit;
+	for (int i = 0; i < runs; ++i)
+	{
+		setup();
+		auto start = std::chrono::high_resolution_clock::now();
+		body();
+		result.milliseconds.push_back(Milliseconds(start));
+	}
+	std::cerr << name << ": " << *std::min_element(result.milliseconds.begin(), result.milliseconds.end()) << " ms" << std::endl;
+	results.push_back(result);
+}
+
+// Add a time to the result with the given name, creating it if needed. For benchmarks whose runs are not independent.
+void Record(const std::string& name, long elements, const std::string& unit, double milliseconds)
+{
+	for (int i = 0; i < results.size(); ++i)
+	{
+		if (results[i].name == name)
+		{
+			results[i].milliseconds.push_back(milliseconds);
+			return;
+		}
+	}
+	BenchResult result;
+	result.name = name;
+	result.elements = elements;
+	result.unit = unit;
+	result.milliseconds.push_back(milliseconds);
+	results.push_back(result);
+}
+
+// A closed UV sphere of radius 1 with the given number of rings, as an ASCII .ply.
+void WriteSpherePLY(const std::string& path, int rings)
+{
+	int segments = 2 * rings;
+	int vertices = 2 + (rings - 1) * segments;
+	int triangles = 2 * segments * (rings - 1);
+
+	std::ofstream file(path);
+	file << "ply\nformat ascii 1.0\nelement vertex " << vertices << "\nproperty float x\nproperty float y\nproperty float z\n";
+	file << "element face " << triangles << "\nproperty list uchar int vertex_indices\nend_header\n";
+	file << std::setprecision(9);
+	file << "0 1 0\n";
+	for (int i = 1; i < rings; ++i)
+	{
+		double theta = M_PI * i / rings;
+		for (int j = 0; j < segments; ++j)
+		{
+			double phi = 2.0 * M_PI * j / segments;
+			file << sin(theta) * cos(phi) << " " << cos(theta) << " " << sin(theta) * sin(phi) << "\n";
+		}
+	}
+	file << "0 -1 0\n";
+
+	// Ring i (from 1) starts at vertex 1 + (i - 1) * segments; the caps fan out from the poles.
+	int south = vertices - 1;
+	for (int j = 0; j < segments; ++j)
+	{
+		int next = (j + 1) % segments;
+		file << "3 0 " << 1 + next << " " << 1 + j << "\n";
+	}
+	for (int i = 1; i < rings - 1; ++i)
+	{
+		int ring = 1 + (i - 1) * segments;
+		for (int j = 0; j < segments; ++j)
+		{
+			int next = (j + 1) % segments;
+			file << "3 " << ring + j << " " << ring + next << " " << ring + segments + j << "\n";
+			file << "3 " << ring + next << " " << ring + segments + next << " " << ring + segments + j << "\n";
+		}
+	}
+	int last = 1 + (rings - 2) * segments;
+	for (int j = 0; j < segments; ++j)
+	{
+		int next = (j + 1) % segments;
+		file << "3 " << south << " " << last + j << " " << last + next << "\n";
+	}
+}
+
+void BenchNoise(const BenchOptions& options)
+{
+	PerlinNoise noise;
+	int samples = 100 * options.size * options.size;
+	volatile float sink = 0.0f;
+	Measure("PerlinNoise::Noise", samples, "samples", options.runs, []() {}, [&]()
+	{
+		float sum = 0.0f;
+		for (int i = 0; i < samples; ++i)
+		{
+			sum += noise.Noise(0.013f * i, 0.5f + 0.007f * i, 0.25f);
+		}
+		sink = sum;
+	});
+}
+
+void BenchPolyhedron(const BenchOptions& options, const std::string& path)
+{
+	Polyhedron* p = NULL;
+	int vertices = 2 + (options.size - 1) * 2 * options.size;
+	int triangles = 4 * options.size * (options.size - 1);
+
+	Measure("Load PLY", vertices, "vertices", options.runs, [&]() { delete(p); p = NULL; }, [&]() { p = new Polyhedron(path); });
+
+	// Initialize, with every phase of the task graph as its own entry.
+	for (int i = 0; i < options.runs; ++i)
+	{
+		delete(p);
+		p = new Polyhedron(path);
+		p->Initialize(nullptr);
+		for (int k = 0; k < p->initializeTimings.size(); ++k)
+		{
+			Record("Polyhedron::Initialize/" + p->initializeTimings[k].first, triangles, "triangles", p->initializeTimings[k].second);
+		}
+	}
+	std::cerr << "Polyhedron::Initialize: " << p->initializeTimings.back().second << " ms" << std::endl;
+
+	// Batch metrics on the initialized mesh:
+	Measure("MeshAnalysis::ComputeTriangleMetrics", triangles, "triangles", options.runs, []() {}, [&]()
+	{
+		TriangleMetrics metrics = MeshAnalysis::ComputeTriangleMetrics(p->tlist);
+	});
+	Measure("MeshAnalysis::GetApproximateGaussianCurvatures", triangles, "triangles", options.runs, []() {}, [&]()
+	{
+		std::vector<double> curvatures = MeshAnalysis::GetApproximateGaussianCurvatures(p->tlist);
+	});
+	Measure("MeshAnalysis::GetHorizonMeasuresDouble", triangles, "triangles", options.runs, []() {}, [&]()
+	{
+		std::vector<double> measures = MeshAnalysis::GetHorizonMeasuresDouble(p->tlist);
+	});
+
+	// One smoothing step per weight, each on a fresh mesh, then the update of what it moved.
+	const char* names[] = {"UNIFORM", "CORD_DYNAMIC", "CORD_STATIC", "MEAN_CURVATURE_DYNAMIC", "MEAN_CURVATURE_STATIC", "MEAN_VALUE_DYNAMIC", "MEAN_VALUE_STATIC"};
+	const Weight weights[] = {Weight::UNIFORM, Weight::CORD_DYNAMIC, Weight::CORD_STATIC, Weight::MEAN_CURVATURE_DYNAMIC,
+		Weight::MEAN_CURVATURE_STATIC, Weight::MEAN_VALUE_DYNAMIC, Weight::MEAN_VALUE_STATIC};
+	for (int w = 0; w < 7; ++w)
+	{
+		for (int i = 0; i < options.runs; ++i)
+		{
+			delete(p);
+			p = new Polyhedron(path);
+			p->Initialize(nullptr);
+
+			auto start = std::chrono::high_resolution_clock::now();
+			Smoothing::SmoothMesh(p, 0.1, weights[w]);
+			Record(std::string("Smoothing::SmoothMesh/") + names[w], vertices, "vertices", Milliseconds(start));
+
+			start = std::chrono::high_resolution_clock::now();
+			DirtyRegion region;
+			p->UpdateDirtyRegion(region);
+			Record(std::string("Polyhedron::UpdateDirtyRegion/") + names[w], vertices, "vertices", Milliseconds(start));
+		}
+		std::cerr << "Smoothing::SmoothMesh/" << names[w] << " done" << std::endl;
+	}
+
+	// Loop subdivision, level by level: the subdivision itself, then the Initialize() of the result.
+	for (int i = 0; i < options.runs; ++i)
+	{
+		delete(p);
+		p = new Polyhedron(path);
+		p->Initialize(nullptr);
+		for (int level = 1; level <= options.levels; ++level)
+		{
+			long input = p->tlist.size();
+			auto start = std::chrono::high_resolution_clock::now();
+			Polyhedron* q = Subdivision::LoopSubdivisionHeap(p);
+			Record("Subdivision::LoopSubdivisionHeap/" + std::to_string(level), input, "triangles", Milliseconds(start));
+
+			start = std::chrono::high_resolution_clock::now();
+			q->Initialize(nullptr);
+			Record("Polyhedron::Initialize/subdivided " + std::to_string(level), q->tlist.size(), "triangles", Milliseconds(start));
+			delete(p);
+			p = q;
+		}
+	}
+	std::cerr << "Subdivision::LoopSubdivisionHeap done" << std::endl;
+	delete(p);
+}
+
+void BenchMeshFactory(const BenchOptions& options)
+{
+	PerlinNoise noise;
+	uint side = options.size + 1;
+	long points = (long)side * side;
+
+	Measure("MeshFactory::GetTerrainChunk", points, "vertices", options.runs, []() {}, [&]()
+	{
+		MeshComponent chunk = MeshFactory::GetTerrainChunk(noise, 0, 0, side, 1.0f, 0.6f);
+	});
+	Measure("MeshFactory::GetTerrainPolyhedron", points, "vertices", options.runs, []() {}, [&]()
+	{
+		Polyhedron* terrain = MeshFactory::GetTerrainPolyhedron(noise, 0, 0, side, 1.0f, 0.6f, -0.15f);
+		delete(terrain);
+	});
+	Measure("MeshFactory::GetTerrainChunkLODs", points, "vertices", options.runs, []() {}, [&]()
+	{
+		std::vector<MeshComponent> lods = MeshFactory::GetTerrainChunkLODs(noise, 0, 0, side, 1.0f, 0.6f, -0.15f, 3, 1e-4);
+	});
+	Measure("MeshFactory::GetSphereTriangles", 6 * points, "vertices", options.runs, []() {}, [&]()
+	{
+		MeshComponent sphere = MeshFactory::GetSphereTriangles(1.0f, side);
+	});
+}
+
+void WriteJSON(std::ostream& out, const BenchOptions& options)
+{
+	out << std::setprecision(6);
+	out << "{\n";
+	out << "  \"timestamp\": " << (long)time(NULL) << ",\n";
+	out << "  \"threads\": " << Parallel::GetThreadCount() << ",\n";
+#ifdef __OPTIMIZE__
+	out << "  \"optimized\": true,\n";
+#else
+	out << "  \"optimized\": false,\n";
+#endif
+	out << "  \"size\": " << options.size << ",\n";
+	out << "  \"levels\": " << options.levels << ",\n";
+	out << "  \"runs\": " << options.runs << ",\n";
+	out << "  \"benchmarks\": [\n";
+	for (int i = 0; i < results.size(); ++i)
+	{
+		BenchResult& result = results[i];
+		std::vector<double> sorted = result.milliseconds;
+		std::sort(sorted.begin(), sorted.end());
+		double mean = 0.0;
+		for (int k = 0; k < sorted.size(); ++k)
+		{
+			mean += sorted[k] / sorted.size();
+		}
+		double median = (sorted.size() % 2 == 1) ? sorted[sorted.size() / 2] : 0.5 * (sorted[sorted.size() / 2 - 1] + sorted[sorted.size() / 2]);
+
+		out << "    {\"name\": \"" << result.name << "\", \"elements\": " << result.elements << ", \"unit\": \"" << result.unit << "\", ";
+		out << "\"min_ms\": " << sorted.front() << ", \"median_ms\": " << median << ", \"mean_ms\": " << mean << ", \"max_ms\": " << sorted.back() << ", ";
+		out << "\"ns_per_element\": " << ((result.elements > 0) ? 1e6 * median / result.elements : 0.0) << ", \"runs_ms\": [";
+		for (int k = 0; k < result.milliseconds.size(); ++k)
+		{
+			out << ((k > 0) ? ", " : "") << result.milliseconds[k];
+		}
+		out << "]}" << ((i + 1 < results.size()) ? "," : "") << "\n";
+	}
+	out << "  ]\n";
+	out << "}\n";
+}
+
+int main(int argc, char* argv[])
+{
+	BenchOptions options;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		if (argument.size() != 2 || argument[0] != '-' || i + 1 >= argc)
+		{
+			std::cerr << "Usage: bench [-s size] [-l subdivision levels] [-r runs] [-j threads] [-o output.json]" << std::endl;
+			return -1;
+		}
+		std::string value = argv[++i];
+		switch (argument[1])
+		{
+			case 's': options.size = std::max(2, std::atoi(value.c_str())); break;
+			case 'l': options.levels = std::max(0, std::atoi(value.c_str())); break;
+			case 'r': options.runs = std::max(1, std::atoi(value.c_str())); break;
+			case 'j': Parallel::SetThreadCount(std::atoi(value.c_str())); break;
+			case 'o': options.output = value; break;
+			default:
+				std::cerr << "Usage: bench [-s size] [-l subdivision levels] [-r runs] [-j threads] [-o output.json]" << std::endl;
+				return -1;
+		}
+	}
+
+	std::string path = "/tmp/river-valley-bench-" + std::to_string(getpid()) + ".ply";
+	WriteSpherePLY(path, options.size);
+
+	BenchNoise(options);
+	BenchPolyhedron(options, path);
+	BenchMeshFactory(options);
+	remove(path.c_str());
+
+	if (options.output.empty())
+	{
+		WriteJSON(std::cout, options);
+	}
+	else
+	{
+		std::ofstream file(options.output);
+		WriteJSON(file, options);
+		std::cerr << "Wrote " << options.output << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,145 @@
+#include "bufferallocator.hpp"
+
+BufferAllocator::BufferAllocator() {}
+BufferAllocator::BufferAllocator(uint capacity)
+{
+	Reset(capacity);
+}
+BufferAllocator::~BufferAllocator() {}
+
+bool BufferAllocator::Allocate(uint size, uint& offset)
+{
+	if (size == 0)
+	{
+		offset = 0;
+		return true;
+	}
+
+	for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it)
+	{
+		if (it->second >= size)
+		{
+			offset = it->first;
+			uint remaining = it->second - size;
+			freeBlocks.erase(it);
+
+			// Put the leftover piece back on the free list.
+			if (remaining > 0)
+			{
+				freeBlocks.insert({ offset + size, remaining });
+			}
+			used += size;
+			return true;
+		}
+	}
+	return false;
+}
+
+void BufferAllocator::Free(uint offset, uint size)
+{
+	if (size == 0)
+	{
+		return;
+	}
+	used -= size;
+
+	auto next = freeBlocks.lower_bound(offset);
+
+	// Merge with the following free range if it starts right where this one ends.
+	if (next != freeBlocks.end() && offset + size == next->first)
+	{
+		size += next->second;
+		next = freeBlocks.erase(next);
+	}
+
+	// Merge with the preceding free range if it ends right where this one starts.
+	if (next != freeBlocks.begin())
+	{
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset)
+		{
+			previous->second += size;
+			return;
+		}
+	}
+
+	freeBlocks.insert({ offset, size });
+}
+
+void BufferAllocator::Grow(uint newCapacity)
+{
+	if (newCapacity <= capacity)
+	{
+		return;
+	}
+	uint oldCapacity = capacity;
+	capacity = newCapacity;
+
+	// Free() expects the range to be counted as used.
+	used += newCapacity - oldCapacity;
+	Free(oldCapacity, newCapacity - oldCapacity);
+}
+
+void BufferAllocator::Reset(uint capacity)
+{
+	this->capacity = capacity;
+	this->used = 0;
+	freeBlocks.clear();
+	if (capacity > 0)
+	{
+		freeBlocks.insert({ 0, capacity });
+	}
+}
+
+void BufferAllocator::Compact(uint used)
+{
+	this->used = used;
+	freeBlocks.clear();
+	if (capacity > used)
+	{
+		freeBlocks.insert({ used, capacity - used });
+	}
+}
+
+uint BufferAllocator::getCapacity()
+{
+	return capacity;
+}
+uint BufferAllocator::getUsed()
+{
+	return used;
+}
+uint BufferAllocator::getFree()
+{
+	return capacity - used;
+}
+uint BufferAllocator::getLargestFreeBlock()
+{
+	uint largest = 0;
+	for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it)
+	{
+		if (it->second > largest)
+			largest = it->second;
+	}
+	return largest;
+}
+
+float BufferAllocator::getFragmentation()
+{
+	uint free = getFree();
+	if (free == 0)
+	{
+		return 0.0f;
+	}
+	return 1.0f - (float)getLargestFreeBlock() / (float)free;
+}
+
+void BufferAllocator::Print()
+{
+	std::cout << "Used " << used << " of " << capacity << " elements in " << freeBlocks.size() << " free ranges: ";
+	for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it)
+	{
+		std::cout << "[" << it->first << ", " << it->first + it->second << ") ";
+	}
+	std::cout << std::endl;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <map>
+#include <iterator>
+#include <iostream>
+
+#include "utilities.hpp"
+
+/** Bookkeeping for suballocating ranges out of one large buffer.
+ *
+ * This class does not touch OpenGL: it only tracks which ranges of [0, capacity) are in use.
+ * Offsets and sizes are measured in elements (vertices or indices), not bytes.
+ *
+ * Free ranges are kept in a map ordered by offset so that neighbouring ranges can be merged
+ * whenever something is freed. Allocation is first-fit. */
+class BufferAllocator
+{
+public:
+
+	BufferAllocator();
+	BufferAllocator(uint capacity);
+	~BufferAllocator();
+
+	/** Find room for size elements. Returns false if there is no free range large enough. */
+	bool Allocate(uint size, uint& offset);
+
+	/** Return a range to the free list, merging it with its neighbours. */
+	void Free(uint offset, uint size);
+
+	/** Extend the managed range to newCapacity. The new space is added to the free list. */
+	void Grow(uint newCapacity);
+
+	/** Forget every allocation and start over with a single free range of the given capacity. */
+	void Reset(uint capacity);
+
+	/** Mark [0, used) as allocated and everything after it as free. Used after compacting a buffer. */
+	void Compact(uint used);
+
+	// getters:
+	uint getCapacity();
+	uint getUsed();
+	uint getFree();
+	uint getLargestFreeBlock();
+
+	/** Fraction of the free space that is not part of the largest free block. 0 means no fragmentation. */
+	float getFragmentation();
+
+	void Print();
+
+private:
+
+	uint capacity = 0;
+	uint used = 0;
+
+	// (offset, size) of each free range.
+	std::map<uint, uint> freeBlocks;
+
+};
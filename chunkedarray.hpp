@@ -0,0 +1,183 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <cstddef>
+#include <algorithm>
+#include "parallel.hpp"
+
+/** An array that grows in fixed-size chunks, so elements never move once added.
+ *
+ * Pointers to elements stay valid for as long as the element is in the array, however many elements are added after it,
+ * so no reserve() is needed up front. Indexing costs a shift and a mask more than std::vector.
+ * clear() destroys the elements and frees the memory a chunk at a time. */
+template <typename T, int CHUNK_BITS = 12>
+class ChunkedArray
+{
+public:
+
+	static const size_t CHUNK_SIZE = (size_t)1 << CHUNK_BITS;
+
+	/** Walks the elements in index order. */
+	template <typename Array, typename Element>
+	class Iterator
+	{
+	public:
+
+		Iterator(Array* array, size_t index) : array(array), index(index) {}
+
+		Element& operator*() const { return (*array)[index]; }
+		Element* operator->() const { return &(*array)[index]; }
+		Iterator& operator++() { ++index; return *this; }
+		bool operator==(const Iterator& other) const { return index == other.index; }
+		bool operator!=(const Iterator& other) const { return index != other.index; }
+
+	private:
+
+		Array* array;
+		size_t index;
+	};
+
+	typedef Iterator<ChunkedArray, T> iterator;
+	typedef Iterator<const ChunkedArray, const T> const_iterator;
+
+	ChunkedArray() {}
+	~ChunkedArray()
+	{
+		clear();
+	}
+
+	// Copies the elements. Pointers held by the copied elements still point into the original.
+	ChunkedArray(const ChunkedArray& other)
+	{
+		reserve(other.count);
+		for (size_t i = 0; i < other.count; ++i)
+		{
+			push_back(other[i]);
+		}
+	}
+	ChunkedArray(ChunkedArray&& other)
+	{
+		chunks.swap(other.chunks);
+		std::swap(count, other.count);
+	}
+	ChunkedArray& operator=(const ChunkedArray& other)
+	{
+		if (this != &other)
+		{
+			clear();
+			reserve(other.count);
+			for (size_t i = 0; i < other.count; ++i)
+			{
+				push_back(other[i]);
+			}
+		}
+		return *this;
+	}
+	ChunkedArray& operator=(ChunkedArray&& other)
+	{
+		if (this != &other)
+		{
+			clear();
+			chunks.swap(other.chunks);
+			std::swap(count, other.count);
+		}
+		return *this;
+	}
+
+	T& operator[](size_t i)
+	{
+		return chunks[i >> CHUNK_BITS][i & (CHUNK_SIZE - 1)];
+	}
+	const T& operator[](size_t i) const
+	{
+		return chunks[i >> CHUNK_BITS][i & (CHUNK_SIZE - 1)];
+	}
+
+	T& back()
+	{
+		return (*this)[count - 1];
+	}
+
+	void push_back(const T& value)
+	{
+		new (NextSlot()) T(value);
+		++count;
+	}
+	void push_back(T&& value)
+	{
+		new (NextSlot()) T(std::move(value));
+		++count;
+	}
+
+	/** Replace the contents with n copies of value. Chunks are filled in parallel, since the first touch of the memory
+	 * is what takes the time for large arrays. */
+	void assign(size_t n, const T& value)
+	{
+		clear();
+		reserve(n);
+		Parallel::For(0, (n + CHUNK_SIZE - 1) >> CHUNK_BITS, 1, [&](int begin, int end)
+		{
+			for (size_t i = (size_t)begin << CHUNK_BITS; i < std::min((size_t)end << CHUNK_BITS, n); ++i)
+			{
+				new (&(*this)[i]) T(value);
+			}
+		});
+		count = n;
+	}
+
+	/** Allocate the chunks for n elements now. Only saves time; the array grows as needed either way. */
+	void reserve(size_t n)
+	{
+		while (capacity() < n)
+		{
+			chunks.push_back(std::allocator<T>().allocate(CHUNK_SIZE));
+		}
+	}
+
+	/** Destroy every element and free all chunks. */
+	void clear()
+	{
+		if (!std::is_trivially_destructible<T>::value)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				(*this)[i].~T();
+			}
+		}
+		for (size_t i = 0; i < chunks.size(); ++i)
+		{
+			std::allocator<T>().deallocate(chunks[i], CHUNK_SIZE);
+		}
+		chunks.clear();
+		count = 0;
+	}
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	size_t capacity() const { return chunks.size() * CHUNK_SIZE; }
+
+	iterator begin() { return iterator(this, 0); }
+	iterator end() { return iterator(this, count); }
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, count); }
+
+private:
+
+	std::vector<T*> chunks;
+	size_t count = 0;
+
+	// Where the next element goes, adding a chunk if the last one is full.
+	T* NextSlot()
+	{
+		if (count == capacity())
+		{
+			chunks.push_back(std::allocator<T>().allocate(CHUNK_SIZE));
+		}
+		return &chunks[count >> CHUNK_BITS][count & (CHUNK_SIZE - 1)];
+	}
+
+};
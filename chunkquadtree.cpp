@@ -0,0 +1,171 @@
+#include "chunkquadtree.hpp"
+
+ChunkQuadtree::ChunkQuadtree() {}
+ChunkQuadtree::~ChunkQuadtree() {}
+
+void ChunkQuadtree::Build(std::vector<MeshComponent>& meshes)
+{
+	nodes.clear();
+	meshIndices.clear();
+	boxMin.resize(meshes.size());
+	boxMax.resize(meshes.size());
+
+	for (int i = 0; i < meshes.size(); ++i)
+	{
+		meshes[i].GetWorldBounds(boxMin[i], boxMax[i]);
+		meshIndices.push_back(i);
+	}
+
+	if (!meshIndices.empty())
+	{
+		BuildNode(0, meshIndices.size(), 0);
+	}
+
+	// Lay out the spheres in the final item order.
+	uint count = meshIndices.size();
+	centerX.resize(count);
+	centerY.resize(count);
+	centerZ.resize(count);
+	radius.resize(count);
+	for (int i = 0; i < count; ++i)
+	{
+		glm::vec3 center;
+		meshes[meshIndices[i]].GetWorldBoundingSphere(center, radius[i]);
+		centerX[i] = center.x;
+		centerY[i] = center.y;
+		centerZ[i] = center.z;
+	}
+}
+
+int ChunkQuadtree::BuildNode(uint first, uint count, uint depth)
+{
+	int index = nodes.size();
+	nodes.push_back(QuadtreeNode());
+
+	QuadtreeNode node;
+	node.first = first;
+	node.count = count;
+	node.min = boxMin[meshIndices[first]];
+	node.max = boxMax[meshIndices[first]];
+	for (int i = first + 1; i < first + count; ++i)
+	{
+		node.min = glm::min(node.min, boxMin[meshIndices[i]]);
+		node.max = glm::max(node.max, boxMax[meshIndices[i]]);
+	}
+	for (int i = 0; i < 4; ++i)
+	{
+		node.children[i] = -1;
+	}
+
+	if (count > MAX_LEAF_ITEMS && depth < MAX_DEPTH)
+	{
+		// Sort the items into quadrants around the middle of the node, by the centers of their boxes.
+		float middleX = 0.5f * (node.min.x + node.max.x);
+		float middleZ = 0.5f * (node.min.z + node.max.z);
+		auto quadrant = [&](int mesh)
+		{
+			float x = 0.5f * (boxMin[mesh].x + boxMax[mesh].x);
+			float z = 0.5f * (boxMin[mesh].z + boxMax[mesh].z);
+			return (x < middleX ? 0 : 1) + (z < middleZ ? 0 : 2);
+		};
+
+		std::vector<int>::iterator begin = meshIndices.begin() + first;
+		std::vector<int>::iterator end = begin + count;
+		std::stable_sort(begin, end, [&](int a, int b) { return quadrant(a) < quadrant(b); });
+
+		// Don't split if everything landed in one quadrant; it would never terminate usefully.
+		if (quadrant(*begin) != quadrant(*(end - 1)))
+		{
+			uint start = first;
+			for (int q = 0; q < 4; ++q)
+			{
+				uint size = 0;
+				while (start + size < first + count && quadrant(meshIndices[start + size]) == q)
+				{
+					++size;
+				}
+				if (size > 0)
+				{
+					node.children[q] = BuildNode(start, size, depth + 1);
+				}
+				start += size;
+			}
+		}
+	}
+
+	nodes[index] = node;
+	return index;
+}
+
+void ChunkQuadtree::Cull(Frustum& frustum, std::vector<int>& visible)
+{
+	PROFILE_SCOPE("ChunkQuadtree::Cull");
+	statistics = CullingStatistics();
+	uint before = visible.size();
+
+	if (!nodes.empty())
+	{
+		CullNode(0, frustum, visible);
+	}
+
+	statistics.drawn = visible.size() - before;
+	statistics.culled = meshIndices.size() - statistics.drawn;
+}
+
+void ChunkQuadtree::CullNode(int index, Frustum& frustum, std::vector<int>& visible)
+{
+	QuadtreeNode& node = nodes[index];
+	++statistics.nodesVisited;
+
+	FrustumTest test = frustum.ClassifyBox(node.min, node.max);
+	if (test == FrustumTest::OUTSIDE)
+	{
+		return;
+	}
+	if (test == FrustumTest::INSIDE)
+	{
+		AcceptNode(index, visible);
+		return;
+	}
+
+	bool leaf = true;
+	for (int i = 0; i < 4; ++i)
+	{
+		if (node.children[i] != -1)
+		{
+			leaf = false;
+			CullNode(node.children[i], frustum, visible);
+		}
+	}
+
+	if (leaf)
+	{
+		// Test the spheres of the leaf, then map the item positions back to mesh indices.
+		uint start = visible.size();
+		frustum.CullSpheres(&centerX[node.first], &centerY[node.first], &centerZ[node.first], &radius[node.first],
+							node.count, node.first, visible);
+		for (int i = start; i < visible.size(); ++i)
+		{
+			visible[i] = meshIndices[visible[i]];
+		}
+		statistics.spheresTested += node.count;
+	}
+}
+
+void ChunkQuadtree::AcceptNode(int index, std::vector<int>& visible)
+{
+	QuadtreeNode& node = nodes[index];
+	for (int i = node.first; i < node.first + node.count; ++i)
+	{
+		visible.push_back(meshIndices[i]);
+	}
+}
+
+CullingStatistics& ChunkQuadtree::getStatistics()
+{
+	return statistics;
+}
+uint ChunkQuadtree::getNodeCount()
+{
+	return nodes.size();
+}
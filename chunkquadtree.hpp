@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include "glm/glm.hpp"
+
+#include "utilities.hpp"
+#include "meshcomponent.hpp"
+#include "frustum.hpp"
+#include "profiler.hpp"
+
+/** A node of the quadtree. Every node owns a contiguous range of items, so a node that is
+ * completely inside the frustum can hand over its whole range without testing its children. */
+struct QuadtreeNode
+{
+	glm::vec3 min;
+	glm::vec3 max;
+	uint first;
+	uint count;
+	int children[4]; // -1 for a leaf.
+};
+
+/** Counters from the last ChunkQuadtree::Cull(). */
+struct CullingStatistics
+{
+	uint nodesVisited = 0;
+	uint spheresTested = 0;
+	uint drawn = 0;
+	uint culled = 0;
+};
+
+/** Quadtree over the meshes of a scene, split in the XZ plane.
+ *
+ * The terrain is a flat grid of chunks, so whole quadrants of it can be rejected with a single box test.
+ * Leaves keep the world-space bounding spheres of their meshes as separate x, y, z and radius arrays
+ * so that Frustum::CullSpheres() can test them four at a time. */
+class ChunkQuadtree
+{
+public:
+
+	ChunkQuadtree();
+	~ChunkQuadtree();
+
+	/** Build the tree from the world-space bounds of the meshes.
+	 * Call this again whenever meshes are added or removed, or a transform changes. */
+	void Build(std::vector<MeshComponent>& meshes);
+
+	/** Append the index of every mesh that may be visible. */
+	void Cull(Frustum& frustum, std::vector<int>& visible);
+
+	// getters:
+	CullingStatistics& getStatistics();
+	uint getNodeCount();
+
+	/** Stop splitting at this many meshes. */
+	static const uint MAX_LEAF_ITEMS = 8;
+	static const uint MAX_DEPTH = 8;
+
+private:
+
+	std::vector<QuadtreeNode> nodes;
+
+	// Per item, ordered so that every node's items are contiguous:
+	std::vector<int> meshIndices;
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> radius;
+
+	// World-space box of every mesh, indexed by mesh.
+	std::vector<glm::vec3> boxMin;
+	std::vector<glm::vec3> boxMax;
+
+	CullingStatistics statistics;
+
+	// Build the node covering items [first, first + count) and return its index.
+	int BuildNode(uint first, uint count, uint depth);
+
+	void CullNode(int node, Frustum& frustum, std::vector<int>& visible);
+
+	// Add every item of a node without testing it.
+	void AcceptNode(int node, std::vector<int>& visible);
+
+};
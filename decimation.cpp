@@ -0,0 +1,516 @@
+#include "decimation.hpp"
+
+DecimatedMesh Decimation::Decimate(Polyhedron* p, const DecimationSettings& settings)
+{
+	Decimation decimation(p, settings);
+	decimation.CollapseTo(settings.targetTriangles);
+	return decimation.Extract();
+}
+
+std::vector<DecimatedMesh> Decimation::GetLODChain(Polyhedron* p, const DecimationSettings& settings, int levels, double ratio)
+{
+	std::vector<DecimatedMesh> chain;
+	Decimation decimation(p, settings);
+	double target = decimation.liveTriangles;
+	for (int i = 0; i < levels; ++i)
+	{
+		target *= ratio;
+		decimation.CollapseTo((int)target);
+		chain.push_back(decimation.Extract());
+	}
+	return chain;
+}
+
+Decimation::Decimation(Polyhedron* p, const DecimationSettings& settings) : settings(settings)
+{
+	int vertexCount = p->vlist.size();
+	int triangleCount = p->tlist.size();
+
+	positions.resize(vertexCount);
+	quadrics.resize(vertexCount);
+	stamps.assign(vertexCount, 0);
+	removed.assign(vertexCount, false);
+	locked.assign(vertexCount, false);
+	onBorder.assign(vertexCount, false);
+	vertexTriangles.resize(vertexCount);
+	for (int i = 0; i < vertexCount; ++i)
+	{
+		Vert& v = p->vlist[i];
+		positions[i] = glm::dvec3(v.x, v.y, v.z);
+	}
+
+	triangles.resize(3 * triangleCount);
+	alive.assign(triangleCount, true);
+	for (int i = 0; i < triangleCount; ++i)
+	{
+		Triangle& t = p->tlist[i];
+		for (int j = 0; j < 3; ++j)
+		{
+			triangles[3 * i + j] = t.vertices[j]->index;
+		}
+
+		// Degenerate triangles are dropped.
+		int* v = &triangles[3 * i];
+		if (v[0] == v[1] || v[1] == v[2] || v[2] == v[0])
+		{
+			alive[i] = false;
+			continue;
+		}
+		liveTriangles++;
+		for (int j = 0; j < 3; ++j)
+		{
+			vertexTriangles[v[j]].push_back(i);
+		}
+
+		// Plane of the triangle, weighted by its area.
+		glm::dvec3 p0 = positions[v[0]];
+		glm::dvec3 normal = glm::cross(positions[v[1]] - p0, positions[v[2]] - p0);
+		double length = glm::length(normal);
+		if (length > 0.0)
+		{
+			normal /= length;
+			for (int j = 0; j < 3; ++j)
+			{
+				AddPlane(quadrics[v[j]], normal, -glm::dot(normal, p0), 0.5 * length);
+			}
+		}
+	}
+
+	// Every edge with the triangles on it: one means boundary, two of different materials means material border.
+	struct EdgeUse
+	{
+		uint64_t key;
+		int triangle;
+		int side;
+	};
+	std::vector<EdgeUse> uses;
+	uses.reserve(3 * triangleCount);
+	for (int i = 0; i < triangleCount; ++i)
+	{
+		if (alive[i])
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				uses.push_back({ EdgeKey(triangles[3 * i + j], triangles[3 * i + (j + 1) % 3]), i, j });
+			}
+		}
+	}
+	std::sort(uses.begin(), uses.end(), [](const EdgeUse& a, const EdgeUse& b) { return a.key < b.key; });
+
+	bool hasMaterials = settings.triangleMaterials.size() == triangleCount;
+	for (int first = 0; first < uses.size(); )
+	{
+		int last = first + 1;
+		while (last < uses.size() && uses[last].key == uses[first].key)
+		{
+			++last;
+		}
+		int count = last - first;
+		bool boundary = count == 1;
+		bool border = count != 2 || (hasMaterials && settings.triangleMaterials[uses[first].triangle] != settings.triangleMaterials[uses[first + 1].triangle]);
+
+		int v0 = uses[first].key >> 32;
+		int v1 = uses[first].key & 0xffffffff;
+		if (border)
+		{
+			borderEdges.insert(uses[first].key);
+			onBorder[v0] = true;
+			onBorder[v1] = true;
+
+			// A plane through the edge, perpendicular to each triangle on it.
+			for (int k = first; k < last; ++k)
+			{
+				int* v = &triangles[3 * uses[k].triangle];
+				glm::dvec3 a = positions[v[uses[k].side]];
+				glm::dvec3 b = positions[v[(uses[k].side + 1) % 3]];
+				glm::dvec3 faceNormal = glm::cross(positions[v[1]] - positions[v[0]], positions[v[2]] - positions[v[0]]);
+				glm::dvec3 normal = glm::cross(b - a, faceNormal);
+				double length = glm::length(normal);
+				if (length > 0.0)
+				{
+					normal /= length;
+					double weight = settings.borderWeight * glm::dot(b - a, b - a);
+					AddPlane(quadrics[v0], normal, -glm::dot(normal, a), weight);
+					AddPlane(quadrics[v1], normal, -glm::dot(normal, a), weight);
+				}
+			}
+		}
+		if (boundary && settings.lockBoundary)
+		{
+			locked[v0] = true;
+			locked[v1] = true;
+		}
+		first = last;
+	}
+
+	for (int first = 0; first < uses.size(); )
+	{
+		PushCollapse(uses[first].key >> 32, uses[first].key & 0xffffffff);
+		int last = first + 1;
+		while (last < uses.size() && uses[last].key == uses[first].key)
+		{
+			++last;
+		}
+		first = last;
+	}
+}
+Decimation::~Decimation() {}
+
+void Decimation::CollapseTo(int targetTriangles)
+{
+	while (liveTriangles > targetTriangles && !queue.empty())
+	{
+		EdgeCollapse collapse = queue.top();
+		if (collapse.cost > settings.maxError)
+		{
+			return;
+		}
+		queue.pop();
+
+		// Skip collapses of vertices that have changed since they were queued; they were queued again then.
+		if (removed[collapse.v0] || removed[collapse.v1] || stamps[collapse.v0] != collapse.stamp0 || stamps[collapse.v1] != collapse.stamp1)
+		{
+			continue;
+		}
+		if (IsValid(collapse))
+		{
+			Collapse(collapse);
+		}
+	}
+}
+
+DecimatedMesh Decimation::Extract()
+{
+	DecimatedMesh result;
+	result.error = error;
+	bool hasMaterials = settings.triangleMaterials.size() == alive.size();
+
+	// Number the vertices that are still used.
+	std::vector<int> newIndex(positions.size(), -1);
+	int vertexCount = 0;
+	for (int i = 0; i < alive.size(); ++i)
+	{
+		if (alive[i])
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				int v = triangles[3 * i + j];
+				if (newIndex[v] == -1)
+				{
+					newIndex[v] = vertexCount++;
+				}
+			}
+		}
+	}
+
+	Polyhedron* p = new Polyhedron(vertexCount, 3 * liveTriangles / 2, liveTriangles);
+	std::vector<int> oldIndex(vertexCount);
+	for (int i = 0; i < positions.size(); ++i)
+	{
+		if (newIndex[i] != -1)
+		{
+			oldIndex[newIndex[i]] = i;
+		}
+	}
+	for (int i = 0; i < vertexCount; ++i)
+	{
+		glm::dvec3 position = positions[oldIndex[i]];
+		Vert v(position.x, position.y, position.z);
+		v.index = i;
+		p->vlist.push_back(v);
+	}
+	for (int i = 0; i < alive.size(); ++i)
+	{
+		if (alive[i])
+		{
+			Triangle t;
+			for (int j = 0; j < 3; ++j)
+			{
+				t.vertices[j] = &p->vlist[newIndex[triangles[3 * i + j]]];
+			}
+			t.index = p->tlist.size();
+			p->tlist.push_back(t);
+			if (hasMaterials)
+			{
+				result.triangleMaterials.push_back(settings.triangleMaterials[i]);
+			}
+		}
+	}
+	Corner c;
+	p->clist.assign(3 * p->tlist.size(), c);
+
+	result.polyhedron = p;
+	return result;
+}
+
+void Decimation::PushCollapse(int v0, int v1)
+{
+	if (locked[v0] && locked[v1])
+	{
+		return;
+	}
+
+	Quadric quadric = quadrics[v0];
+	AddQuadric(quadric, quadrics[v1]);
+
+	// A locked vertex stays where it is. Otherwise take the minimum of the quadric, unless it is far off the edge,
+	// and the best of the ends and the middle if not.
+	glm::dvec3 position;
+	if (locked[v0])
+	{
+		position = positions[v0];
+	}
+	else if (locked[v1])
+	{
+		position = positions[v1];
+	}
+	else if (!Minimize(quadric, position) || glm::length(position - 0.5 * (positions[v0] + positions[v1])) > glm::length(positions[v1] - positions[v0]))
+	{
+		glm::dvec3 candidates[3] = { positions[v0], positions[v1], 0.5 * (positions[v0] + positions[v1]) };
+		position = candidates[0];
+		double best = Evaluate(quadric, candidates[0]);
+		for (int i = 1; i < 3; ++i)
+		{
+			double cost = Evaluate(quadric, candidates[i]);
+			if (cost < best)
+			{
+				best = cost;
+				position = candidates[i];
+			}
+		}
+	}
+
+	EdgeCollapse collapse;
+	collapse.cost = std::max(Evaluate(quadric, position), 0.0);
+	collapse.v0 = v0;
+	collapse.v1 = v1;
+	collapse.stamp0 = stamps[v0];
+	collapse.stamp1 = stamps[v1];
+	collapse.position = position;
+	queue.push(collapse);
+}
+
+bool Decimation::IsValid(const EdgeCollapse& collapse)
+{
+	int v0 = collapse.v0;
+	int v1 = collapse.v1;
+
+	// An edge between two border vertices that is not a border itself would pinch the border together.
+	if (onBorder[v0] && onBorder[v1] && borderEdges.count(EdgeKey(v0, v1)) == 0)
+	{
+		return false;
+	}
+
+	// Link condition: the only vertices next to both ends are the ones opposite the edge.
+	// Otherwise the collapse would merge two edges and leave the mesh non-manifold.
+	GetNeighbours(v0, neighbours0);
+	GetNeighbours(v1, neighbours1);
+	int shared = 0;
+	for (int i = 0; i < neighbours0.size(); ++i)
+	{
+		if (std::find(neighbours1.begin(), neighbours1.end(), neighbours0[i]) != neighbours1.end())
+		{
+			shared++;
+		}
+	}
+	int edgeTriangles = 0;
+	for (int i = 0; i < vertexTriangles[v0].size(); ++i)
+	{
+		int t = vertexTriangles[v0][i];
+		if (alive[t] && (triangles[3 * t] == v1 || triangles[3 * t + 1] == v1 || triangles[3 * t + 2] == v1))
+		{
+			edgeTriangles++;
+		}
+	}
+	if (shared != edgeTriangles)
+	{
+		return false;
+	}
+
+	// No triangle that survives may fold over or collapse to a sliver.
+	for (int end = 0; end < 2; ++end)
+	{
+		int v = (end == 0) ? v0 : v1;
+		int other = (end == 0) ? v1 : v0;
+		for (int i = 0; i < vertexTriangles[v].size(); ++i)
+		{
+			int t = vertexTriangles[v][i];
+			int* corners = &triangles[3 * t];
+			if (!alive[t] || corners[0] == other || corners[1] == other || corners[2] == other)
+			{
+				continue;
+			}
+
+			glm::dvec3 before[3];
+			glm::dvec3 after[3];
+			for (int j = 0; j < 3; ++j)
+			{
+				before[j] = positions[corners[j]];
+				after[j] = (corners[j] == v) ? collapse.position : before[j];
+			}
+			glm::dvec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+			glm::dvec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+			double lengths = glm::length(normalBefore) * glm::length(normalAfter);
+			if (lengths <= 0.0 || glm::dot(normalBefore, normalAfter) < MIN_NORMAL_COSINE * lengths)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void Decimation::Collapse(const EdgeCollapse& collapse)
+{
+	int v0 = collapse.v0;
+	int v1 = collapse.v1;
+
+	// Border edges of v1 become border edges of v0.
+	GetNeighbours(v1, neighbours1);
+	for (int i = 0; i < neighbours1.size(); ++i)
+	{
+		int w = neighbours1[i];
+		if (borderEdges.erase(EdgeKey(v1, w)) > 0 && w != v0)
+		{
+			borderEdges.insert(EdgeKey(v0, w));
+		}
+	}
+
+	positions[v0] = collapse.position;
+	AddQuadric(quadrics[v0], quadrics[v1]);
+	locked[v0] = locked[v0] || locked[v1];
+	onBorder[v0] = onBorder[v0] || onBorder[v1];
+	removed[v1] = true;
+	stamps[v0]++;
+	error = std::max(error, collapse.cost);
+
+	// Triangles on the edge disappear; the other triangles of v1 move over to v0.
+	for (int i = 0; i < vertexTriangles[v1].size(); ++i)
+	{
+		int t = vertexTriangles[v1][i];
+		if (!alive[t])
+		{
+			continue;
+		}
+		int* corners = &triangles[3 * t];
+		if (corners[0] == v0 || corners[1] == v0 || corners[2] == v0)
+		{
+			alive[t] = false;
+			liveTriangles--;
+		}
+		else
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				if (corners[j] == v1)
+				{
+					corners[j] = v0;
+				}
+			}
+			vertexTriangles[v0].push_back(t);
+		}
+	}
+	vertexTriangles[v1].clear();
+
+	std::vector<int>& list = vertexTriangles[v0];
+	list.erase(std::remove_if(list.begin(), list.end(), [this](int t) { return !alive[t]; }), list.end());
+
+	// The quadric of v0 changed, so every edge around it costs something else now.
+	GetNeighbours(v0, neighbours0);
+	for (int i = 0; i < neighbours0.size(); ++i)
+	{
+		PushCollapse(v0, neighbours0[i]);
+	}
+}
+
+void Decimation::GetNeighbours(int v, std::vector<int>& neighbours)
+{
+	neighbours.clear();
+	for (int i = 0; i < vertexTriangles[v].size(); ++i)
+	{
+		int t = vertexTriangles[v][i];
+		if (!alive[t])
+		{
+			continue;
+		}
+		for (int j = 0; j < 3; ++j)
+		{
+			int w = triangles[3 * t + j];
+			if (w != v && std::find(neighbours.begin(), neighbours.end(), w) == neighbours.end())
+			{
+				neighbours.push_back(w);
+			}
+		}
+	}
+}
+
+uint64_t Decimation::EdgeKey(int v0, int v1)
+{
+	if (v0 > v1)
+	{
+		std::swap(v0, v1);
+	}
+	return ((uint64_t)v0 << 32) | (uint32_t)v1;
+}
+
+void Decimation::AddPlane(Quadric& quadric, glm::dvec3 n, double d, double weight)
+{
+	double* q = quadric.q;
+	q[0] += weight * n.x * n.x;
+	q[1] += weight * n.x * n.y;
+	q[2] += weight * n.x * n.z;
+	q[3] += weight * n.x * d;
+	q[4] += weight * n.y * n.y;
+	q[5] += weight * n.y * n.z;
+	q[6] += weight * n.y * d;
+	q[7] += weight * n.z * n.z;
+	q[8] += weight * n.z * d;
+	q[9] += weight * d * d;
+}
+
+void Decimation::AddQuadric(Quadric& quadric, const Quadric& other)
+{
+	for (int i = 0; i < 10; ++i)
+	{
+		quadric.q[i] += other.q[i];
+	}
+}
+
+double Decimation::Evaluate(const Quadric& quadric, glm::dvec3 x)
+{
+	const double* q = quadric.q;
+	return q[0] * x.x * x.x + 2.0 * q[1] * x.x * x.y + 2.0 * q[2] * x.x * x.z + 2.0 * q[3] * x.x
+		 + q[4] * x.y * x.y + 2.0 * q[5] * x.y * x.z + 2.0 * q[6] * x.y
+		 + q[7] * x.z * x.z + 2.0 * q[8] * x.z
+		 + q[9];
+}
+
+bool Decimation::Minimize(const Quadric& quadric, glm::dvec3& x)
+{
+	// Solve A x = -b for the upper 3x3 block A and last column b, by Cramer's rule.
+	const double* q = quadric.q;
+	double a00 = q[0], a01 = q[1], a02 = q[2];
+	double a11 = q[4], a12 = q[5];
+	double a22 = q[7];
+	double b0 = -q[3], b1 = -q[6], b2 = -q[8];
+
+	double c00 = a11 * a22 - a12 * a12;
+	double c01 = a02 * a12 - a01 * a22;
+	double c02 = a01 * a12 - a02 * a11;
+	double determinant = a00 * c00 + a01 * c01 + a02 * c02;
+
+	// Nearly flat or nearly straight neighbourhoods have no single minimum.
+	double scale = a00 + a11 + a22;
+	if (std::abs(determinant) <= 1e-9 * scale * scale * scale)
+	{
+		return false;
+	}
+
+	double c11 = a00 * a22 - a02 * a02;
+	double c12 = a01 * a02 - a00 * a12;
+	double c22 = a00 * a11 - a01 * a01;
+	x.x = (c00 * b0 + c01 * b1 + c02 * b2) / determinant;
+	x.y = (c01 * b0 + c11 * b1 + c12 * b2) / determinant;
+	x.z = (c02 * b0 + c12 * b1 + c22 * b2) / determinant;
+	return true;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <functional>
+#include <algorithm>
+#include <unordered_set>
+#include <limits>
+#include <cstdint>
+#include "polyhedron.hpp"
+
+// How far Decimation may go, and what it has to keep.
+struct DecimationSettings
+{
+	// Stop once at most this many triangles are left.
+	int targetTriangles = 0;
+
+	// Stop before a collapse whose quadric error (a squared distance) is larger than this.
+	double maxError = std::numeric_limits<double>::max();
+
+	// Boundary edges and material borders get a plane through them that is this many times stiffer than the surface,
+	// scaled by the squared edge length, so collapses only slide along them.
+	double borderWeight = 1000.0;
+
+	// Never move boundary vertices, so the boundary stays exactly as it was.
+	// Used for terrain chunks: neighbouring chunks still line up, whatever their level of detail.
+	bool lockBoundary = false;
+
+	// Optional material of every triangle, e.g. water and terrain. Borders between materials are kept like boundaries.
+	std::vector<int> triangleMaterials;
+};
+
+// The result of a decimation.
+struct DecimatedMesh
+{
+	// Vertices and triangles only; call Initialize() for the adjacency.
+	Polyhedron* polyhedron = nullptr;
+
+	// Material of every triangle, if materials were given.
+	std::vector<int> triangleMaterials;
+
+	// Largest error of any collapse made.
+	double error = 0.0;
+};
+
+// Quadric of the squared distances to a set of planes, as the upper half of a symmetric 4x4 matrix:
+// a2 ab ac ad / b2 bc bd / c2 cd / d2.
+struct Quadric
+{
+	double q[10] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+};
+
+// A candidate collapse of the edge (v0, v1) into position, for the priority queue.
+struct EdgeCollapse
+{
+	double cost;
+	int v0, v1;
+
+	// The vertices' stamps when this was computed. The collapse is stale once either vertex has changed.
+	int stamp0, stamp1;
+
+	glm::dvec3 position;
+
+	bool operator>(const EdgeCollapse& other) const { return cost > other.cost; }
+};
+
+/** Quadric error metric simplification (Garland and Heckbert) by edge collapse.
+ *
+ * Every vertex gets the quadric of the planes of its triangles, weighted by area. Edges are collapsed cheapest first,
+ * to the point that minimizes the sum of both quadrics. Collapses that would fold a triangle over or make the mesh
+ * non-manifold are skipped. */
+class Decimation
+{
+public:
+
+	// Collapse edges until settings.targetTriangles is reached or the next collapse costs more than settings.maxError.
+	static DecimatedMesh Decimate(Polyhedron* p, const DecimationSettings& settings);
+
+	// Levels of detail: level i has about ratio^(i + 1) of the triangles of p, or fewer if maxError stops it first.
+	// The levels are taken from one run of collapses, so the chain costs about as much as its coarsest level.
+	static std::vector<DecimatedMesh> GetLODChain(Polyhedron* p, const DecimationSettings& settings, int levels, double ratio);
+
+private:
+
+	Decimation(Polyhedron* p, const DecimationSettings& settings);
+	~Decimation();
+
+	// Collapse until at most targetTriangles are left, the queue is empty or the cheapest collapse is over budget.
+	void CollapseTo(int targetTriangles);
+
+	// The current mesh as a new polyhedron.
+	DecimatedMesh Extract();
+
+	// Queue the collapse of the edge (v0, v1).
+	void PushCollapse(int v0, int v1);
+
+	// Whether the collapse would keep the mesh manifold and its borders intact, without folding any triangles over.
+	bool IsValid(const EdgeCollapse& collapse);
+	void Collapse(const EdgeCollapse& collapse);
+
+	// Vertices that share a live triangle with v.
+	void GetNeighbours(int v, std::vector<int>& neighbours);
+
+	static uint64_t EdgeKey(int v0, int v1);
+
+	static void AddPlane(Quadric& quadric, glm::dvec3 normal, double d, double weight);
+	static void AddQuadric(Quadric& quadric, const Quadric& other);
+	static double Evaluate(const Quadric& quadric, glm::dvec3 x);
+
+	// The point that minimizes the quadric, if there is a single one.
+	static bool Minimize(const Quadric& quadric, glm::dvec3& x);
+
+	const DecimationSettings& settings;
+
+	std::vector<glm::dvec3> positions;
+	std::vector<Quadric> quadrics;
+	std::vector<int> stamps;
+	std::vector<bool> removed;
+	std::vector<bool> locked;
+	std::vector<bool> onBorder;
+	std::vector<std::vector<int>> vertexTriangles;
+
+	// Three vertex indices per triangle.
+	std::vector<int> triangles;
+	std::vector<bool> alive;
+	int liveTriangles = 0;
+
+	// Boundary edges and material borders, by EdgeKey().
+	std::unordered_set<uint64_t> borderEdges;
+
+	std::priority_queue<EdgeCollapse, std::vector<EdgeCollapse>, std::greater<EdgeCollapse>> queue;
+	double error = 0.0;
+
+	// Scratch lists for GetNeighbours(), kept to avoid allocating on every collapse.
+	std::vector<int> neighbours0;
+	std::vector<int> neighbours1;
+
+	// Smallest cosine allowed between a triangle's normal before and after a collapse.
+	static constexpr double MIN_NORMAL_COSINE = 0.2;
+
+};
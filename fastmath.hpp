@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FASTMATH_USE_SSE2
+#endif
+
+/** Static class of polynomial approximations to inverse trigonometric functions.
+ *
+ * These avoid calls into libm, so the same code runs on two doubles at a time with SSE2.
+ * Both approximations are from Abramowitz and Stegun, Handbook of Mathematical Functions:
+ *
+ * * Acos(): formula 4.4.46, absolute error at most 2e-8 on [-1, 1].
+ * * Atan2(): formula 4.4.49 for atan on [0, 1] after range reduction, absolute error at most 2e-8.
+ *
+ * Inputs to Acos() must already be clamped to [-1, 1]. */
+class FastMath
+{
+public:
+
+	static inline double Acos(double x)
+	{
+		double a = std::abs(x);
+		double r = std::sqrt(1.0 - a) * AcosPolynomial(a);
+		return x < 0.0 ? M_PI - r : r;
+	}
+
+	static inline double Atan2(double y, double x)
+	{
+		double ay = std::abs(y);
+		double ax = std::abs(x);
+		double high = std::max(ax, ay);
+		if (high == 0.0)
+		{
+			return 0.0;
+		}
+
+		// Reduce to atan on [0, 1], then unfold the octant.
+		double a = std::min(ax, ay) / high;
+		double r = a * AtanPolynomial(a * a);
+		if (ay > ax)
+		{
+			r = 0.5 * M_PI - r;
+		}
+		if (x < 0.0)
+		{
+			r = M_PI - r;
+		}
+		return y < 0.0 ? -r : r;
+	}
+
+#ifdef FASTMATH_USE_SSE2
+	static inline __m128d Acos(__m128d x)
+	{
+		__m128d a = Abs(x);
+		__m128d r = _mm_mul_pd(_mm_sqrt_pd(_mm_sub_pd(_mm_set1_pd(1.0), a)), AcosPolynomial(a));
+		__m128d negative = _mm_cmplt_pd(x, _mm_setzero_pd());
+		return Select(negative, _mm_sub_pd(_mm_set1_pd(M_PI), r), r);
+	}
+
+	static inline __m128d Atan2(__m128d y, __m128d x)
+	{
+		__m128d ay = Abs(y);
+		__m128d ax = Abs(x);
+		__m128d high = _mm_max_pd(ax, ay);
+		__m128d zero = _mm_cmpeq_pd(high, _mm_setzero_pd());
+
+		// Divide by 1 instead of 0 in lanes that are zeroed at the end anyway.
+		__m128d a = _mm_div_pd(_mm_min_pd(ax, ay), Select(zero, _mm_set1_pd(1.0), high));
+		__m128d r = _mm_mul_pd(a, AtanPolynomial(_mm_mul_pd(a, a)));
+		r = Select(_mm_cmpgt_pd(ay, ax), _mm_sub_pd(_mm_set1_pd(0.5 * M_PI), r), r);
+		r = Select(_mm_cmplt_pd(x, _mm_setzero_pd()), _mm_sub_pd(_mm_set1_pd(M_PI), r), r);
+		r = Select(_mm_cmplt_pd(y, _mm_setzero_pd()), _mm_sub_pd(_mm_setzero_pd(), r), r);
+		return _mm_andnot_pd(zero, r);
+	}
+#endif
+
+private:
+
+	FastMath();
+	~FastMath();
+
+	// acos(a) / sqrt(1 - a) on [0, 1].
+	template <typename T>
+	static inline T AcosPolynomial(T a)
+	{
+		return Horner(a, ACOS_COEFFICIENTS, 8);
+	}
+
+	// atan(a) / a on [0, 1], as a polynomial in a^2.
+	template <typename T>
+	static inline T AtanPolynomial(T a2)
+	{
+		return Horner(a2, ATAN_COEFFICIENTS, 9);
+	}
+
+	static inline double Horner(double x, const double* c, int n)
+	{
+		double r = c[n - 1];
+		for (int i = n - 2; i >= 0; --i)
+		{
+			r = r * x + c[i];
+		}
+		return r;
+	}
+
+#ifdef FASTMATH_USE_SSE2
+	static inline __m128d Horner(__m128d x, const double* c, int n)
+	{
+		__m128d r = _mm_set1_pd(c[n - 1]);
+		for (int i = n - 2; i >= 0; --i)
+		{
+			r = _mm_add_pd(_mm_mul_pd(r, x), _mm_set1_pd(c[i]));
+		}
+		return r;
+	}
+
+	static inline __m128d Abs(__m128d x)
+	{
+		return _mm_andnot_pd(_mm_set1_pd(-0.0), x);
+	}
+
+	// mask ? a : b, per lane.
+	static inline __m128d Select(__m128d mask, __m128d a, __m128d b)
+	{
+		return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+	}
+#endif
+
+	static constexpr double ACOS_COEFFICIENTS[8] =
+	{
+		1.5707963050, -0.2145988016, 0.0889789874, -0.0501743046,
+		0.0308918810, -0.0170881256, 0.0066700901, -0.0012624911
+	};
+
+	static constexpr double ATAN_COEFFICIENTS[9] =
+	{
+		1.0, -0.3333314528, 0.1999355085, -0.1420889944, 0.1065626393,
+		-0.0752896400, 0.0429096138, -0.0161657367, 0.0028662257
+	};
+};
@@ -0,0 +1,152 @@
+#include "framescheduler.hpp"
+
+int FrameScheduler::window = 0;
+int FrameScheduler::maxFramesPerSecond = 60;
+int FrameScheduler::frameMilliseconds = 16;
+bool FrameScheduler::visible = true;
+bool FrameScheduler::animating = false;
+bool FrameScheduler::redrawPosted = false;
+bool FrameScheduler::redrawHeld = false;
+bool FrameScheduler::timerPending = false;
+int FrameScheduler::timerGeneration = 0;
+bool FrameScheduler::lastFrameAnimated = false;
+void (*FrameScheduler::animate)() = NULL;
+
+uint64_t FrameScheduler::framesDrawn = 0;
+uint64_t FrameScheduler::redrawRequests = 0;
+uint64_t FrameScheduler::mergedRequests = 0;
+uint64_t FrameScheduler::hiddenRequests = 0;
+uint64_t FrameScheduler::animationTicks = 0;
+
+void FrameScheduler::Initialize(int window, int maxFramesPerSecond)
+{
+	FrameScheduler::window = window;
+	FrameScheduler::maxFramesPerSecond = maxFramesPerSecond;
+	frameMilliseconds = (maxFramesPerSecond > 0) ? 1000 / maxFramesPerSecond : 0;
+	glutIdleFunc(NULL);
+	RequestRedraw();
+}
+
+void FrameScheduler::RequestRedraw()
+{
+	redrawRequests++;
+	if (!visible)
+	{
+		hiddenRequests++;
+		redrawHeld = true;
+		return;
+	}
+	// While animating, the next tick draws the change, so input cannot push the frame rate over the cap.
+	if (redrawPosted || (animating && timerPending))
+	{
+		mergedRequests++;
+		return;
+	}
+	PostRedisplay();
+}
+
+bool FrameScheduler::FrameStarted()
+{
+	framesDrawn++;
+	redrawPosted = false;
+	redrawHeld = false;
+
+	// Only the frames of a running animation follow each other at the frame rate; any other frame came after idle time.
+	bool continuous = animating && visible && lastFrameAnimated;
+	lastFrameAnimated = animating && visible;
+
+	// The next animated frame is due one frame interval after this one started.
+	if (animating && visible && !timerPending)
+	{
+		timerPending = true;
+		glutTimerFunc(frameMilliseconds, Tick, timerGeneration);
+	}
+	return continuous;
+}
+
+void FrameScheduler::SetAnimating(bool animating)
+{
+	if (FrameScheduler::animating == animating)
+	{
+		return;
+	}
+	FrameScheduler::animating = animating;
+	lastFrameAnimated = false;
+	timerGeneration++;
+	timerPending = false;
+	if (animating)
+	{
+		RequestRedraw();
+	}
+}
+
+bool FrameScheduler::IsAnimating()
+{
+	return animating;
+}
+
+void FrameScheduler::SetAnimateFunc(void (*animate)())
+{
+	FrameScheduler::animate = animate;
+}
+
+void FrameScheduler::SetVisible(bool visible)
+{
+	FrameScheduler::visible = visible;
+	if (!visible)
+	{
+		// Stop the animation timer; the first frame after the window shows again restarts it.
+		lastFrameAnimated = false;
+		timerGeneration++;
+		timerPending = false;
+		return;
+	}
+	if (redrawHeld || animating)
+	{
+		RequestRedraw();
+	}
+}
+
+void FrameScheduler::PrintStatistics()
+{
+	std::cout << "Frame scheduler: " << framesDrawn << " frames drawn for " << redrawRequests << " redraw requests, "
+		<< mergedRequests << " merged into a pending frame, " << hiddenRequests << " made while hidden, "
+		<< animationTicks << " animation ticks. Animation " << (animating ? "on" : "off")
+		<< ", at most " << maxFramesPerSecond << " frames per second." << std::endl;
+}
+
+uint64_t FrameScheduler::getFramesDrawn()
+{
+	return framesDrawn;
+}
+
+uint64_t FrameScheduler::getRedrawRequests()
+{
+	return redrawRequests;
+}
+
+void FrameScheduler::Tick(int generation)
+{
+	if (generation != timerGeneration)
+	{
+		return;
+	}
+	timerPending = false;
+	if (!animating || !visible)
+	{
+		return;
+	}
+	animationTicks++;
+	if (animate != NULL)
+	{
+		animate();
+	}
+	RequestRedraw();
+}
+
+void FrameScheduler::PostRedisplay()
+{
+	redrawPosted = true;
+	glutSetWindow(window);
+	glutPostRedisplay();
+}
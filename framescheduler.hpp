@@ -0,0 +1,78 @@
+#pragma once
+
+#include <iostream>
+#include <cstdint>
+
+#include "glut.h"
+#include "utilities.hpp"
+
+/** Static class that decides when the window is redrawn.
+ *
+ * Nothing is drawn unless something asked for it: input, a change to the scene or the animation calls RequestRedraw().
+ * Requests made before the next frame is drawn are merged into that one frame.
+ * While animating, requests wait for the next tick of a GLUT timer, which calls the animation function and requests a frame,
+ * at most maxFramesPerSecond times a second.
+ * While the window is hidden, requests are only remembered, and the timer stops; the frame is drawn once it is visible again.
+ *
+ * So a static scene costs no CPU at all between events, instead of a full core for glutIdleFunc() redrawing it nonstop. */
+class FrameScheduler
+{
+
+public:
+
+	/** Start scheduling frames of the given window. Needs GLUT to be initialized. */
+	static void Initialize(int window, int maxFramesPerSecond);
+
+	/** The scene changed: draw it again soon. Cheap to call any number of times. */
+	static void RequestRedraw();
+
+	/** Call at the start of Display(). Also schedules the next frame of an animation.
+	 * Returns whether this frame directly followed the previous one in a running animation,
+	 * so the time since the previous frame is a frame time and not idle time. */
+	static bool FrameStarted();
+
+	/** Turn the animation timer on or off. animate is called before every animated frame. */
+	static void SetAnimating(bool animating);
+	static bool IsAnimating();
+	static void SetAnimateFunc(void (*animate)());
+
+	/** Call from the visibility callback of the window. */
+	static void SetVisible(bool visible);
+
+	/** Frames drawn, requests made and how many of them were merged or held back, since the start. */
+	static void PrintStatistics();
+
+	// getters:
+	static uint64_t getFramesDrawn();
+	static uint64_t getRedrawRequests();
+
+private:
+
+	FrameScheduler();
+	~FrameScheduler();
+
+	// The GLUT timer callback. Timers cannot be cancelled, so a tick from before the animation was restarted is ignored.
+	static void Tick(int generation);
+
+	// Ask GLUT for a frame now, unless one is already on its way.
+	static void PostRedisplay();
+
+	static int window;
+	static int maxFramesPerSecond;
+	static int frameMilliseconds;
+	static bool visible;
+	static bool animating;
+	static bool redrawPosted;
+	static bool redrawHeld;
+	static bool timerPending;
+	static int timerGeneration;
+	static bool lastFrameAnimated;
+	static void (*animate)();
+
+	static uint64_t framesDrawn;
+	static uint64_t redrawRequests;
+	static uint64_t mergedRequests;
+	static uint64_t hiddenRequests;
+	static uint64_t animationTicks;
+
+};
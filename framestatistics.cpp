@@ -0,0 +1,309 @@
+#include "framestatistics.hpp"
+
+FrameStatistics::FrameStatistics() : history(HISTORY_FRAMES) {}
+FrameStatistics::~FrameStatistics() {}
+
+void FrameStatistics::Initialize()
+{
+	glGenQueries(QUERY_FRAMES * (int)FramePass::COUNT, &queries[0][0]);
+	initialized = true;
+}
+
+void FrameStatistics::BeginFrame(bool continuous)
+{
+	auto now = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::milli> interval = now - frameStart;
+	double cpuFrame = (hasFrameStart && continuous) ? interval.count() : 0.0;
+	frameStart = now;
+	hasFrameStart = true;
+
+	frame++;
+	FrameSample& sample = history[frame % HISTORY_FRAMES];
+	sample = FrameSample();
+	sample.frame = frame;
+	sample.cpuFrame = cpuFrame;
+
+	if (!initialized)
+	{
+		return;
+	}
+
+	// The slot this frame is about to reuse holds the oldest queries; they are dropped if the GPU still has not finished them.
+	// The two newer slots are only read if their results are already there.
+	for (int age = QUERY_FRAMES; age > 0; --age)
+	{
+		int slot = (frame + QUERY_FRAMES - age) % QUERY_FRAMES;
+		for (int pass = 0; pass < (int)FramePass::COUNT; ++pass)
+		{
+			if (queryPending[slot][pass])
+			{
+				ResolveQuery(slot, pass, age == QUERY_FRAMES);
+			}
+		}
+	}
+}
+
+void FrameStatistics::BeginPass(FramePass pass)
+{
+	if (!initialized)
+	{
+		return;
+	}
+	int slot = frame % QUERY_FRAMES;
+	glBeginQuery(GL_TIME_ELAPSED, queries[slot][(int)pass]);
+	queryFrame[slot][(int)pass] = frame;
+	queryPending[slot][(int)pass] = true;
+	history[frame % HISTORY_FRAMES].pendingQueries++;
+}
+
+void FrameStatistics::EndPass(FramePass pass)
+{
+	if (!initialized)
+	{
+		return;
+	}
+	glEndQuery(GL_TIME_ELAPSED);
+}
+
+bool FrameStatistics::EndFrame(double shadowMilliseconds, bool shadowRendered, double submissionMilliseconds, uint draws, uint triangles)
+{
+	FrameSample& sample = history[frame % HISTORY_FRAMES];
+	std::chrono::duration<double, std::milli> display = std::chrono::high_resolution_clock::now() - frameStart;
+	sample.cpuDisplay = display.count();
+	sample.cpuShadow = shadowMilliseconds;
+	sample.shadowRendered = shadowRendered;
+	sample.cpuSubmission = submissionMilliseconds;
+	sample.draws = draws;
+	sample.triangles = triangles;
+
+	// Without queries the sample is already complete; otherwise it is written once they have been read.
+	if (sample.pendingQueries == 0)
+	{
+		WriteSample(sample);
+	}
+
+	framesSinceReport++;
+	if (framesSinceReport < REPORT_FRAMES)
+	{
+		return false;
+	}
+	Report();
+	framesSinceReport = 0;
+	return true;
+}
+
+void FrameStatistics::Reset()
+{
+	for (int i = 0; i < history.size(); ++i)
+	{
+		// Samples still waiting for queries are kept, so the CSV file does not lose them.
+		if (history[i].pendingQueries == 0)
+		{
+			history[i] = FrameSample();
+		}
+	}
+	framesSinceReport = 0;
+	hasFrameStart = false;
+}
+
+bool FrameStatistics::ToggleRecording(const std::string& path)
+{
+	if (csv.is_open())
+	{
+		csv.close();
+		std::cout << "Stopped recording frames to " << path << "." << std::endl;
+		return false;
+	}
+
+	csv.open(path);
+	if (!csv)
+	{
+		std::cout << "COULD NOT WRITE " << path << "." << std::endl;
+		return false;
+	}
+	csv << "frame,cpu_frame_ms,cpu_display_ms,cpu_shadow_ms,cpu_submission_ms,gpu_shadow_ms,gpu_scene_ms,shadow_rendered,draws,triangles\n";
+	std::cout << "Recording frames to " << path << "." << std::endl;
+	return true;
+}
+
+std::string FrameStatistics::getSummary()
+{
+	return summary;
+}
+
+void FrameStatistics::CleanUp()
+{
+	if (initialized)
+	{
+		glDeleteQueries(QUERY_FRAMES * (int)FramePass::COUNT, &queries[0][0]);
+		initialized = false;
+	}
+	if (csv.is_open())
+	{
+		csv.close();
+	}
+}
+
+bool FrameStatistics::ResolveQuery(int slot, int pass, bool force)
+{
+	GLint available = 0;
+	glGetQueryObjectiv(queries[slot][pass], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available && !force)
+	{
+		return false;
+	}
+
+	FrameSample* sample = getSample(queryFrame[slot][pass]);
+	if (available)
+	{
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(queries[slot][pass], GL_QUERY_RESULT, &nanoseconds);
+		if (sample != NULL)
+		{
+			sample->gpu[pass] = nanoseconds / 1000000.0;
+		}
+	}
+	else
+	{
+		droppedQueries++;
+	}
+
+	queryPending[slot][pass] = false;
+	if (sample != NULL)
+	{
+		sample->pendingQueries--;
+		if (sample->pendingQueries == 0)
+		{
+			WriteSample(*sample);
+		}
+	}
+	return true;
+}
+
+FrameSample* FrameStatistics::getSample(uint64_t frame)
+{
+	FrameSample& sample = history[frame % HISTORY_FRAMES];
+	return (sample.frame == frame) ? &sample : NULL;
+}
+
+void FrameStatistics::WriteSample(FrameSample& sample)
+{
+	if (!csv.is_open())
+	{
+		return;
+	}
+	char line[256];
+	snprintf(line, sizeof(line), "%llu,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%d,%u,%u\n", (unsigned long long)sample.frame,
+		sample.cpuFrame, sample.cpuDisplay, sample.cpuShadow, sample.cpuSubmission,
+		sample.gpu[(int)FramePass::SHADOW], sample.gpu[(int)FramePass::SCENE], sample.shadowRendered ? 1 : 0, sample.draws, sample.triangles);
+	csv << line;
+}
+
+void FrameStatistics::Report()
+{
+	std::vector<double> frameTimes;
+	std::vector<double> display;
+	std::vector<double> shadow;
+	std::vector<double> submission;
+	std::vector<double> gpuShadow;
+	std::vector<double> gpuScene;
+	uint64_t first = frame;
+	int frames = 0;
+	int shadowRenders = 0;
+	double draws = 0.0;
+	double triangles = 0.0;
+	for (int i = 0; i < history.size(); ++i)
+	{
+		FrameSample& sample = history[i];
+		if (sample.frame == 0 || sample.frame + HISTORY_FRAMES <= frame)
+		{
+			continue;
+		}
+		first = std::min(first, sample.frame);
+		frames++;
+		shadowRenders += sample.shadowRendered ? 1 : 0;
+		draws += sample.draws;
+		triangles += sample.triangles;
+		if (sample.cpuFrame > 0.0)
+		{
+			frameTimes.push_back(sample.cpuFrame);
+		}
+		display.push_back(sample.cpuDisplay);
+		shadow.push_back(sample.cpuShadow);
+		submission.push_back(sample.cpuSubmission);
+		if (sample.gpu[(int)FramePass::SHADOW] >= 0.0)
+		{
+			gpuShadow.push_back(sample.gpu[(int)FramePass::SHADOW]);
+		}
+		if (sample.gpu[(int)FramePass::SCENE] >= 0.0)
+		{
+			gpuScene.push_back(sample.gpu[(int)FramePass::SCENE]);
+		}
+	}
+	if (frames == 0)
+	{
+		return;
+	}
+
+	double frameMean = 0.0;
+	double displayMean = 0.0;
+	double unused = 0.0;
+	double gpuShadowMean = 0.0;
+	double gpuSceneMean = 0.0;
+	std::cout << "Frames " << first << "-" << frame << " (mean / p50 / p95 / p99):" << std::endl;
+	std::cout << Summarize("  Frame", frameTimes, frameMean);
+	std::cout << Summarize("  CPU Display()", display, displayMean);
+	std::cout << Summarize("  CPU shadow pass", shadow, unused);
+	std::cout << Summarize("  CPU submission", submission, unused);
+	std::cout << Summarize("  GPU shadow pass", gpuShadow, gpuShadowMean);
+	std::cout << Summarize("  GPU scene", gpuScene, gpuSceneMean);
+	std::cout << "  Shadow map rendered in " << shadowRenders << " of " << frames << " frames, "
+		<< draws / frames << " draws and " << triangles / frames << " triangles per frame";
+	if (droppedQueries > 0)
+	{
+		std::cout << ", " << droppedQueries << " GPU timings dropped so far";
+	}
+	std::cout << "." << std::endl;
+
+	// Frames drawn on demand have no frame rate; only an animation does.
+	char line[128];
+	summary = "";
+	if (frameMean > 0.0)
+	{
+		snprintf(line, sizeof(line), "%.1f fps, ", 1000.0 / frameMean);
+		summary = line;
+	}
+	snprintf(line, sizeof(line), "CPU %.2f ms", displayMean);
+	summary += line;
+	if (!gpuScene.empty())
+	{
+		snprintf(line, sizeof(line), ", GPU %.2f ms", gpuShadowMean + gpuSceneMean);
+		summary += line;
+	}
+}
+
+std::string FrameStatistics::Summarize(const char* name, std::vector<double>& values, double& mean)
+{
+	if (values.empty())
+	{
+		return "";
+	}
+	std::sort(values.begin(), values.end());
+	double sum = 0.0;
+	for (int i = 0; i < values.size(); ++i)
+	{
+		sum += values[i];
+	}
+	mean = sum / values.size();
+
+	// Nearest rank.
+	auto percentile = [&values](double p)
+	{
+		size_t rank = (size_t)std::ceil(p * values.size());
+		return values[std::min(values.size(), std::max<size_t>(rank, 1)) - 1];
+	};
+
+	char line[160];
+	snprintf(line, sizeof(line), "%s: %.3f / %.3f / %.3f / %.3f ms\n", name, mean, percentile(0.50), percentile(0.95), percentile(0.99));
+	return line;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+
+#include "utilities.hpp"
+
+/** The render passes timed on the GPU. */
+enum class FramePass
+{
+	SHADOW,
+	SCENE,
+	COUNT
+};
+
+/** Everything measured about one frame. Times are in milliseconds; GPU times are negative until their query has been read. */
+struct FrameSample
+{
+	uint64_t frame = 0;
+	double cpuFrame = 0.0; // From the start of the previous frame to the start of this one. Zero after idle time.
+	double cpuDisplay = 0.0; // Display() itself, up to the buffer swap.
+	double cpuShadow = 0.0;
+	double cpuSubmission = 0.0;
+	double gpu[(int)FramePass::COUNT] = {-1.0, -1.0};
+	bool shadowRendered = false;
+	uint draws = 0;
+	uint triangles = 0;
+	int pendingQueries = 0; // GPU results not read yet. The sample is final once this is zero.
+};
+
+/** Frame time, CPU time of the passes and their GPU time from GL_TIME_ELAPSED queries.
+ *
+ * The queries of a frame are only read a few frames later, from a ring of QUERY_FRAMES sets,
+ * and only once GL_QUERY_RESULT_AVAILABLE says so: reading them right away would stall the CPU until the GPU catches up.
+ * A result that is still not available when its query is needed again is dropped rather than waited for.
+ *
+ * Every REPORT_FRAMES frames the mean and percentiles of the last HISTORY_FRAMES frames are printed.
+ * While recording, every finished frame is also appended to a CSV file. */
+class FrameStatistics
+{
+public:
+
+	FrameStatistics();
+	~FrameStatistics();
+
+	/** Create the query objects. Needs an OpenGL context. */
+	void Initialize();
+
+	/** Call at the very start of Display(). Reads the GPU results that have arrived.
+	 * continuous is false when the window sat idle since the previous frame; that interval is then not counted as a frame time. */
+	void BeginFrame(bool continuous = true);
+
+	/** Bracket a render pass. Only one pass can be timed at a time. */
+	void BeginPass(FramePass pass);
+	void EndPass(FramePass pass);
+
+	/** Call at the end of Display(), with the CPU times and counts of the frame. Returns whether a report was printed. */
+	bool EndFrame(double shadowMilliseconds, bool shadowRendered, double submissionMilliseconds, uint draws, uint triangles);
+
+	/** Forget the rolling window, e.g. after switching the drawing path, so the next report only covers the new one. */
+	void Reset();
+
+	/** Start appending every frame to path, or stop if already recording. Returns whether it is recording now. */
+	bool ToggleRecording(const std::string& path);
+
+	/** Short summary of the last report for the window title, e.g. "60.0 fps, CPU 3.10 ms, GPU 4.20 ms". Without an animation there is no frame rate to show. Empty before the first report. */
+	std::string getSummary();
+
+	/** Release all resources, and close the CSV file if one is open. */
+	void CleanUp();
+
+	static const int QUERY_FRAMES = 3;
+	static const int HISTORY_FRAMES = 120;
+	static const int REPORT_FRAMES = 120;
+
+private:
+
+	uint queries[QUERY_FRAMES][(int)FramePass::COUNT] = {};
+	uint64_t queryFrame[QUERY_FRAMES][(int)FramePass::COUNT] = {}; // Frame that last used each query.
+	bool queryPending[QUERY_FRAMES][(int)FramePass::COUNT] = {};
+	bool initialized = false;
+
+	// The last HISTORY_FRAMES frames, indexed by frame % HISTORY_FRAMES.
+	std::vector<FrameSample> history;
+	uint64_t frame = 0;
+	uint64_t framesSinceReport = 0;
+	uint64_t droppedQueries = 0;
+	std::chrono::high_resolution_clock::time_point frameStart;
+	bool hasFrameStart = false;
+
+	std::ofstream csv;
+	std::string summary;
+
+	// Read the query of a pass in one slot if it is ready, or drop it if force is set. Returns whether the slot is free.
+	bool ResolveQuery(int slot, int pass, bool force);
+
+	// The sample of a frame, if it is still in the history.
+	FrameSample* getSample(uint64_t frame);
+
+	// Write a finished sample to the CSV file, if recording.
+	void WriteSample(FrameSample& sample);
+
+	// Print the statistics of the samples in the history.
+	void Report();
+
+	// One line of mean / 50th / 95th / 99th percentile of values, which are sorted in place. Empty if there are none.
+	static std::string Summarize(const char* name, std::vector<double>& values, double& mean);
+
+};
@@ -0,0 +1,67 @@
+#include "frameuniforms.hpp"
+
+const char* FrameUniforms::FRAME_BLOCK_NAME = "FrameData";
+const char* FrameUniforms::LIGHT_BLOCK_NAME = "LightData";
+
+FrameUniforms::FrameUniforms() {}
+FrameUniforms::~FrameUniforms() {}
+
+void FrameUniforms::Initialize()
+{
+	glGenBuffers(1, &frameBufferID);
+	glBindBuffer(GL_UNIFORM_BUFFER, frameBufferID);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameBlock), nullptr, GL_DYNAMIC_DRAW);
+
+	glGenBuffers(1, &lightBufferID);
+	glBindBuffer(GL_UNIFORM_BUFFER, lightBufferID);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(LightBlock), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	// Binding points are global state, so this only needs to happen once.
+	glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_BINDING, frameBufferID);
+	glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_BINDING, lightBufferID);
+	lightUploaded = false;
+}
+
+void FrameUniforms::UpdateFrame(glm::mat4& projection, glm::mat4& view, glm::vec3 eyePosition)
+{
+	FrameBlock frame;
+	frame.projection = projection;
+	frame.view = view;
+	frame.eyePosition = glm::vec4(eyePosition, 1.0f);
+
+	glBindBuffer(GL_UNIFORM_BUFFER, frameBufferID);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameBlock), &frame);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void FrameUniforms::UpdateLight(glm::mat4& lightView, glm::mat4& lightPerspective,
+				 glm::vec3 lightPosition, glm::vec3 specularColor,
+				 float ambient, float diffuse, float specular, float shininess)
+{
+	LightBlock next;
+	next.lightView = lightView;
+	next.lightPerspective = lightPerspective;
+	next.lightPosition = glm::vec4(lightPosition, 1.0f);
+	next.specularColor = glm::vec4(specularColor, 1.0f);
+	next.coefficients = glm::vec4(ambient, diffuse, specular, shininess);
+
+	// The light rarely changes, so most frames can skip the upload.
+	if (lightUploaded && std::memcmp(&next, &light, sizeof(LightBlock)) == 0)
+	{
+		return;
+	}
+	light = next;
+	lightUploaded = true;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, lightBufferID);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(LightBlock), &light);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void FrameUniforms::CleanUp()
+{
+	glDeleteBuffers(1, &frameBufferID);
+	glDeleteBuffers(1, &lightBufferID);
+	lightUploaded = false;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstring>
+#include "glm/glm.hpp"
+
+#include "utilities.hpp"
+
+/** Per-frame camera state. Mirrors the std140 uniform block FrameData in the shaders.
+ * vec3s are stored as vec4s because std140 pads them to 16 bytes anyway. */
+struct FrameBlock
+{
+	glm::mat4 projection;
+	glm::mat4 view;
+	glm::vec4 eyePosition; // w unused.
+};
+
+/** Light state. Mirrors the std140 uniform block LightData in the shaders. */
+struct LightBlock
+{
+	glm::mat4 lightView;
+	glm::mat4 lightPerspective;
+	glm::vec4 lightPosition; // w unused.
+	glm::vec4 specularColor; // w unused.
+	glm::vec4 coefficients; // ambient, diffuse, specular, shininess.
+};
+
+/** Owns the uniform buffer objects shared by BasicShader and ShadowShader.
+ *
+ * Data that is the same for every mesh in a frame is uploaded once per frame here,
+ * instead of once per mesh through glUniform* calls.
+ * Each shader connects its blocks to the binding points below with ShaderProgram::BindUniformBlock(). */
+class FrameUniforms
+{
+public:
+
+	FrameUniforms();
+	~FrameUniforms();
+
+	/** Create the buffers and attach them to their binding points. Needs an OpenGL context. */
+	void Initialize();
+
+	/** Upload the camera state. Call once per frame, before drawing. */
+	void UpdateFrame(glm::mat4& projection, glm::mat4& view, glm::vec3 eyePosition);
+
+	/** Upload the light state. Nothing is sent to the GPU if it has not changed since the last call. */
+	void UpdateLight(glm::mat4& lightView, glm::mat4& lightPerspective,
+					 glm::vec3 lightPosition, glm::vec3 specularColor,
+					 float ambient, float diffuse, float specular, float shininess);
+
+	/** Release all resources. */
+	void CleanUp();
+
+	/** Binding points of the blocks. */
+	static const uint FRAME_BINDING = 1;
+	static const uint LIGHT_BINDING = 2;
+
+	/** Names of the blocks in shader code. */
+	static const char* FRAME_BLOCK_NAME;
+	static const char* LIGHT_BLOCK_NAME;
+
+private:
+
+	uint frameBufferID = 0;
+	uint lightBufferID = 0;
+
+	// Last uploaded light, to skip redundant uploads.
+	LightBlock light;
+	bool lightUploaded = false;
+
+};
@@ -0,0 +1,123 @@
+#include "frustum.hpp"
+
+Frustum::Frustum()
+{
+	for (int i = 0; i < 6; ++i)
+	{
+		planes[i] = glm::vec4(0);
+	}
+}
+Frustum::~Frustum() {}
+
+void Frustum::Update(const glm::mat4& viewProjection)
+{
+	// glm is column-major, so row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i]).
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+
+	planes[0] = rows[3] + rows[0]; // left
+	planes[1] = rows[3] - rows[0]; // right
+	planes[2] = rows[3] + rows[1]; // bottom
+	planes[3] = rows[3] - rows[1]; // top
+	planes[4] = rows[3] + rows[2]; // near
+	planes[5] = rows[3] - rows[2]; // far
+
+	for (int i = 0; i < 6; ++i)
+	{
+		float length = glm::length(glm::vec3(planes[i]));
+		if (length > 0.0f)
+		{
+			planes[i] /= length;
+		}
+	}
+}
+
+bool Frustum::ContainsSphere(glm::vec3 center, float radius)
+{
+	for (int i = 0; i < 6; ++i)
+	{
+		if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+FrustumTest Frustum::ClassifyBox(glm::vec3 min, glm::vec3 max)
+{
+	FrustumTest result = FrustumTest::INSIDE;
+	for (int i = 0; i < 6; ++i)
+	{
+		glm::vec3 normal = glm::vec3(planes[i]);
+
+		// The corners furthest along and furthest against the normal.
+		glm::vec3 positive = glm::vec3(normal.x >= 0 ? max.x : min.x, normal.y >= 0 ? max.y : min.y, normal.z >= 0 ? max.z : min.z);
+		glm::vec3 negative = glm::vec3(normal.x >= 0 ? min.x : max.x, normal.y >= 0 ? min.y : max.y, normal.z >= 0 ? min.z : max.z);
+
+		if (glm::dot(normal, positive) + planes[i].w < 0)
+		{
+			return FrustumTest::OUTSIDE;
+		}
+		if (glm::dot(normal, negative) + planes[i].w < 0)
+		{
+			result = FrustumTest::INTERSECTING;
+		}
+	}
+	return result;
+}
+
+void Frustum::CullSpheres(const float* x, const float* y, const float* z, const float* radius, uint count,
+						  uint indexOffset, std::vector<int>& visible)
+{
+	uint i = 0;
+
+#ifdef FRUSTUM_USE_SSE
+	__m128 planeX[6], planeY[6], planeZ[6], planeD[6];
+	for (int p = 0; p < 6; ++p)
+	{
+		planeX[p] = _mm_set1_ps(planes[p].x);
+		planeY[p] = _mm_set1_ps(planes[p].y);
+		planeZ[p] = _mm_set1_ps(planes[p].z);
+		planeD[p] = _mm_set1_ps(planes[p].w);
+	}
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 cx = _mm_loadu_ps(x + i);
+		__m128 cy = _mm_loadu_ps(y + i);
+		__m128 cz = _mm_loadu_ps(z + i);
+		__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+
+		// A lane stays set only while its sphere is in front of every plane. Starts as all ones.
+		__m128 inside = _mm_cmpeq_ps(cx, cx);
+		for (int p = 0; p < 6; ++p)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)),
+										 _mm_add_ps(_mm_mul_ps(planeZ[p], cz), planeD[p]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			if (mask & (1 << lane))
+			{
+				visible.push_back(indexOffset + i + lane);
+			}
+		}
+	}
+#endif
+
+	// Whatever is left over, or everything without SSE.
+	for (; i < count; ++i)
+	{
+		if (ContainsSphere(glm::vec3(x[i], y[i], z[i]), radius[i]))
+		{
+			visible.push_back(indexOffset + i);
+		}
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include "glm/glm.hpp"
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define FRUSTUM_USE_SSE
+#endif
+
+#include "utilities.hpp"
+
+/** Result of testing a volume against the frustum. */
+enum class FrustumTest
+{
+	OUTSIDE,
+	INTERSECTING,
+	INSIDE
+};
+
+/** The six planes of a view frustum, used to skip meshes that cannot be seen.
+ *
+ * The planes are pulled straight out of projection * view (Gribb and Hartmann),
+ * so they are in world space and point inward. Each plane is stored as (normal, d) with a unit normal,
+ * which makes dot(normal, p) + d the signed distance from p to the plane. */
+class Frustum
+{
+public:
+
+	Frustum();
+	~Frustum();
+
+	/** Extract the planes from a combined projection * view matrix. */
+	void Update(const glm::mat4& viewProjection);
+
+	/** Test one sphere. */
+	bool ContainsSphere(glm::vec3 center, float radius);
+
+	/** Test an axis-aligned box. INSIDE means nothing in the box needs to be tested again. */
+	FrustumTest ClassifyBox(glm::vec3 min, glm::vec3 max);
+
+	/** Test count spheres given as separate x, y, z and radius arrays.
+	 * The index of every visible sphere, plus indexOffset, is appended to visible.
+	 * Four spheres are tested at a time with SSE when it is available. */
+	void CullSpheres(const float* x, const float* y, const float* z, const float* radius, uint count,
+					 uint indexOffset, std::vector<int>& visible);
+
+	glm::vec4 planes[6];
+
+};
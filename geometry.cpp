@@ -79,10 +79,7 @@ void Vert::Print()
 	std::cout << std::endl;
 }
 
-Edge::Edge()
-{
-	this->vertices = std::vector<Vert*>(2);
-}
+Edge::Edge() {}
 Edge::~Edge() {}
 Edge::Edge(const Edge& e)
 {
@@ -188,8 +185,6 @@ int Edge::Contains(Vert* v)
 
 Triangle::Triangle()
 {
-	this->vertices = std::vector<Vert*>(3);
-	this->edges = std::vector<Edge*>(3);
 	this->normal = glm::dvec3(0.0, 0.0, 0.0);
 }
 Triangle::~Triangle() {}
@@ -278,20 +273,58 @@ Corner::~Corner() {}
 std::vector<Vert*> Corner::GetAdjacentVertices()
 {
 	std::vector<Vert*> connected;
-	// Bounce around until we get back to where we started.
-	int k = -1;
-	Corner* previous = this;
-	while (k != this->index)
+	if (!IsBoundary())
 	{
-		Corner* adjacent = previous->p->o->p;
-		k = adjacent->index;
+		// Bounce around until we get back to where we started.
+		int k = -1;
+		Corner* previous = this;
+		while (k != this->index)
+		{
+			Corner* adjacent = previous->p->o->p;
+			k = adjacent->index;
 
-		connected.push_back(adjacent->n->v);
-		previous = adjacent;
+			connected.push_back(adjacent->n->v);
+			previous = adjacent;
+		}
+		return connected;
+	}
+
+	// On a boundary, first go backwards (c.n.o.n) to the corner just after one boundary edge,
+	// then forwards to the other one, starting with the vertex across the first edge.
+	Corner* previous = this;
+	while (previous->n->o != NULL)
+	{
+		previous = previous->n->o->n;
+	}
+	connected.push_back(previous->p->v);
+	connected.push_back(previous->n->v);
+	while (previous->p->o != NULL)
+	{
+		previous = previous->p->o->p;
+		connected.push_back(previous->n->v);
 	}
 	return connected;
 }
 
+bool Corner::IsBoundary()
+{
+	// Go forwards (c.p.o.p) around c.v. A closed fan gets back here; an open one runs into an edge with no opposite corner.
+	Corner* previous = this;
+	for (int i = 0; i < v->numberOfTriangles; ++i)
+	{
+		if (previous->p->o == NULL)
+		{
+			return true;
+		}
+		previous = previous->p->o->p;
+		if (previous == this)
+		{
+			return false;
+		}
+	}
+	return false;
+}
+
 void Corner::Print()
 {
 	std::cout << std::endl;
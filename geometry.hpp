@@ -2,9 +2,11 @@
 
 #include <iostream>
 #include <vector>
+#include <array>
 #include <cmath>
 #include <glm/glm.hpp>
 #include <glm/gtx/string_cast.hpp>
+#include "utilities.hpp"
 
 /** This file contains the three pieces of geometry that builds up a mesh:
  * 1) Vert
@@ -66,8 +68,9 @@ public:
 	int minMax = -1;
 	int saddle = -1;
 
-	// List of triangles attached to this vertex:
-	std::vector<Triangle*> triangles;
+	// List of triangles attached to this vertex.
+	// Points into the adjacency array of the Polyhedron, see Polyhedron::ConnectVerticesToTriangles().
+	Span<Triangle*> triangles;
 };
 
 
@@ -98,8 +101,8 @@ public:
 	// Length:
 	double length = -1.0;
 
-	// List of vertices attached to this edge:
-	std::vector<Vert*> vertices;
+	// The two vertices of this edge:
+	std::array<Vert*, 2> vertices = {};
 
 	// Number of triangles attached to this edge:
 	int numberOfTriangles = 0;
@@ -136,11 +139,11 @@ public:
 	// Area:
 	double area = -1.0;
 
-	// List of vertices attached to this triangle:
-	std::vector<Vert*> vertices;
+	// The three vertices of this triangle:
+	std::array<Vert*, 3> vertices = {};
 
-	// List of edges attached to this triangle:
-	std::vector<Edge*> edges;
+	// The three edges of this triangle; edge j connects vertices j and j + 1:
+	std::array<Edge*, 3> edges = {};
 };
 
 
@@ -159,9 +162,12 @@ public:
 	Corner(Corner&& v);
 	Corner& operator=(Corner&& v);
 
-	// Get all adjacent vertices to c.v.
+	// Get all adjacent vertices to c.v. On a boundary they run from one boundary edge to the other.
 	std::vector<Vert*> GetAdjacentVertices();
 
+	// Whether c.v is on the boundary of the mesh, i.e. the triangles around it do not close up.
+	bool IsBoundary();
+
 	void Print();
 
 	// ID:
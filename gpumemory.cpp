@@ -0,0 +1,287 @@
+#include "gpumemory.hpp"
+
+uint GPUMemory::vaoID = 0;
+uint GPUMemory::vertexBufferID = 0;
+uint GPUMemory::indexBufferID = 0;
+BufferAllocator GPUMemory::vertexAllocator;
+BufferAllocator GPUMemory::indexAllocator;
+std::vector<GPUAllocation> GPUMemory::allocations;
+std::vector<int> GPUMemory::freeHandles;
+
+GPUMemory::GPUMemory() {}
+GPUMemory::~GPUMemory() {}
+
+
+void GPUMemory::Initialize()
+{
+	glGenVertexArrays(1, &vaoID);
+	glBindVertexArray(vaoID);
+
+	vertexAllocator.Reset(INITIAL_VERTICES);
+	glGenBuffers(1, &vertexBufferID);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+	glBufferData(GL_ARRAY_BUFFER, (size_t)INITIAL_VERTICES * sizeof(Vertex), nullptr, GL_STATIC_DRAW);
+
+	// The element array binding is part of the VAO state.
+	indexAllocator.Reset(INITIAL_INDICES);
+	glGenBuffers(1, &indexBufferID);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (size_t)INITIAL_INDICES * sizeof(uint), nullptr, GL_STATIC_DRAW);
+
+	SetupAttributes();
+
+	glBindVertexArray(0);
+}
+
+void GPUMemory::SetupAttributes()
+{
+	uint vertexSize = sizeof(Vertex);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, vertexSize, 0); // positions 3D.
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, vertexSize, (const void*)(3 * sizeof(float))); // colors 4D.
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, vertexSize, (const void*)(7 * sizeof(float))); // normals 3D.
+	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, vertexSize, (const void*)(10 * sizeof(float))); // textures 2D.
+	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, vertexSize, (const void*)(12 * sizeof(float))); // barycentric 3D.
+	glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, vertexSize, (const void*)(15 * sizeof(float))); // highlight color 4D.
+
+	// Enabled attribute arrays are also part of the VAO state, so this only needs to happen here.
+	for (uint i = 0; i < 6; ++i)
+	{
+		glEnableVertexAttribArray(i);
+	}
+}
+
+
+int GPUMemory::Allocate(uint vertexCount, uint indexCount)
+{
+	if (vaoID == 0)
+	{
+		Initialize();
+	}
+
+	GPUAllocation allocation;
+	allocation.live = true;
+	allocation.vertexCount = vertexCount;
+	allocation.indexCount = indexCount;
+
+	// If the space exists but is scattered, compacting is cheaper than growing.
+	bool vertexFits = vertexAllocator.getLargestFreeBlock() >= vertexCount;
+	bool indexFits = indexAllocator.getLargestFreeBlock() >= indexCount;
+	if ((!vertexFits && vertexAllocator.getFree() >= vertexCount) || (!indexFits && indexAllocator.getFree() >= indexCount))
+	{
+		Defragment();
+	}
+
+	// Growing by the whole count guarantees the new space at the end of the buffer holds it, however scattered the rest is.
+	if (!vertexAllocator.Allocate(vertexCount, allocation.vertexOffset))
+	{
+		GrowBuffer(vertexBufferID, GL_ARRAY_BUFFER, vertexAllocator, sizeof(Vertex), vertexAllocator.getCapacity() + vertexCount);
+		if (!vertexAllocator.Allocate(vertexCount, allocation.vertexOffset))
+		{
+			std::cout << "COULD NOT ALLOCATE " << vertexCount << " VERTICES IN GPU MEMORY." << std::endl;
+			exit(-1);
+		}
+	}
+	if (!indexAllocator.Allocate(indexCount, allocation.indexOffset))
+	{
+		GrowBuffer(indexBufferID, GL_ELEMENT_ARRAY_BUFFER, indexAllocator, sizeof(uint), indexAllocator.getCapacity() + indexCount);
+		if (!indexAllocator.Allocate(indexCount, allocation.indexOffset))
+		{
+			std::cout << "COULD NOT ALLOCATE " << indexCount << " INDICES IN GPU MEMORY." << std::endl;
+			exit(-1);
+		}
+	}
+
+	// Reuse a dead handle if there is one.
+	int handle;
+	if (!freeHandles.empty())
+	{
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+		allocations[handle] = allocation;
+	}
+	else
+	{
+		handle = allocations.size();
+		allocations.push_back(allocation);
+	}
+	return handle;
+}
+
+void GPUMemory::Free(int handle)
+{
+	if (handle < 0 || handle >= (int)allocations.size() || !allocations[handle].live)
+	{
+		return;
+	}
+
+	GPUAllocation& allocation = allocations[handle];
+	vertexAllocator.Free(allocation.vertexOffset, allocation.vertexCount);
+	indexAllocator.Free(allocation.indexOffset, allocation.indexCount);
+	allocation.live = false;
+	freeHandles.push_back(handle);
+}
+
+GPUAllocation& GPUMemory::GetAllocation(int handle)
+{
+	return allocations[handle];
+}
+
+
+void GPUMemory::UploadVertices(int handle, std::vector<Vertex>& vertices)
+{
+	UpdateVertices(handle, 0, vertices.size(), vertices.data());
+}
+
+void GPUMemory::UploadIndices(int handle, std::vector<uint>& indices)
+{
+	GPUAllocation& allocation = allocations[handle];
+	glBindBuffer(GL_COPY_WRITE_BUFFER, indexBufferID);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (size_t)allocation.indexOffset * sizeof(uint), indices.size() * sizeof(uint), indices.data());
+}
+
+void GPUMemory::UpdateVertices(int handle, uint first, uint count, const void* data)
+{
+	UpdateVertices(handle, first, 0, count * sizeof(Vertex), data);
+}
+
+void GPUMemory::UpdateVertices(int handle, uint first, uint byteOffset, uint byteCount, const void* data)
+{
+	GPUAllocation& allocation = allocations[handle];
+	size_t start = (size_t)(allocation.vertexOffset + first) * sizeof(Vertex) + byteOffset;
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+	glBufferSubData(GL_ARRAY_BUFFER, start, byteCount, data);
+}
+
+
+void GPUMemory::GrowBuffer(uint& buffer, GLenum target, BufferAllocator& allocator, uint elementSize, uint minimumCapacity)
+{
+	uint oldCapacity = allocator.getCapacity();
+	uint newCapacity = oldCapacity;
+	while (newCapacity < minimumCapacity || newCapacity == oldCapacity)
+	{
+		newCapacity *= 2;
+	}
+
+	// Copy the old contents to the front of a bigger buffer. Offsets do not change.
+	uint newBuffer;
+	glGenBuffers(1, &newBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, (size_t)newCapacity * elementSize, nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (size_t)oldCapacity * elementSize);
+	glDeleteBuffers(1, &buffer);
+	buffer = newBuffer;
+	allocator.Grow(newCapacity);
+
+	// The VAO still refers to the deleted buffer.
+	glBindVertexArray(vaoID);
+	if (target == GL_ELEMENT_ARRAY_BUFFER)
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+	}
+	else
+	{
+		SetupAttributes();
+	}
+	glBindVertexArray(0);
+}
+
+uint GPUMemory::CompactBuffer(uint buffer, uint elementSize, uint capacity, bool vertices)
+{
+	uint newBuffer;
+	glGenBuffers(1, &newBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, (size_t)capacity * elementSize, nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+
+	uint next = 0;
+	for (int i = 0; i < allocations.size(); ++i)
+	{
+		GPUAllocation& allocation = allocations[i];
+		if (!allocation.live)
+		{
+			continue;
+		}
+		uint& offset = vertices ? allocation.vertexOffset : allocation.indexOffset;
+		uint count = vertices ? allocation.vertexCount : allocation.indexCount;
+		if (count > 0)
+		{
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (size_t)offset * elementSize, (size_t)next * elementSize, (size_t)count * elementSize);
+		}
+		offset = next;
+		next += count;
+	}
+	glDeleteBuffers(1, &buffer);
+	return newBuffer;
+}
+
+void GPUMemory::Defragment()
+{
+	if (vaoID == 0)
+	{
+		return;
+	}
+
+	vertexBufferID = CompactBuffer(vertexBufferID, sizeof(Vertex), vertexAllocator.getCapacity(), true);
+	vertexAllocator.Compact(vertexAllocator.getUsed());
+
+	indexBufferID = CompactBuffer(indexBufferID, sizeof(uint), indexAllocator.getCapacity(), false);
+	indexAllocator.Compact(indexAllocator.getUsed());
+
+	glBindVertexArray(vaoID);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+	SetupAttributes();
+	glBindVertexArray(0);
+}
+
+void GPUMemory::CleanUp()
+{
+	if (vaoID == 0)
+	{
+		return;
+	}
+	glDeleteBuffers(1, &vertexBufferID);
+	glDeleteBuffers(1, &indexBufferID);
+	glDeleteVertexArrays(1, &vaoID);
+	vaoID = 0;
+	vertexBufferID = 0;
+	indexBufferID = 0;
+	allocations.clear();
+	freeHandles.clear();
+	vertexAllocator.Reset(0);
+	indexAllocator.Reset(0);
+}
+
+
+uint GPUMemory::getVAO()
+{
+	return vaoID;
+}
+uint GPUMemory::getVertexBuffer()
+{
+	return vertexBufferID;
+}
+uint GPUMemory::getIndexBuffer()
+{
+	return indexBufferID;
+}
+
+size_t GPUMemory::GetLiveBytes()
+{
+	return (size_t)vertexAllocator.getUsed() * sizeof(Vertex) + (size_t)indexAllocator.getUsed() * sizeof(uint);
+}
+size_t GPUMemory::GetReservedBytes()
+{
+	return (size_t)vertexAllocator.getCapacity() * sizeof(Vertex) + (size_t)indexAllocator.getCapacity() * sizeof(uint);
+}
+
+void GPUMemory::PrintUsage()
+{
+	std::cout << "GPU memory: " << GetLiveBytes() << " bytes live, " << GetReservedBytes() << " bytes reserved. " << std::endl;
+	std::cout << "Vertex buffer: ";
+	vertexAllocator.Print();
+	std::cout << "Index buffer: ";
+	indexAllocator.Print();
+}
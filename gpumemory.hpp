@@ -0,0 +1,115 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+#include <iostream>
+
+#include "utilities.hpp"
+#include "vertex.hpp"
+#include "bufferallocator.hpp"
+
+/** The ranges of the shared buffers that belong to one mesh.
+ * Offsets and counts are in vertices and indices. */
+struct GPUAllocation
+{
+	bool live = false;
+	uint vertexOffset = 0;
+	uint vertexCount = 0;
+	uint indexOffset = 0;
+	uint indexCount = 0;
+};
+
+/** Static class that owns one large vertex buffer, one large index buffer and the VAO that reads them.
+ *
+ * Meshes do not get buffers of their own. Instead, each mesh is given a handle to a GPUAllocation,
+ * which records where its vertices and indices live inside the shared buffers.
+ * Triangle indices are stored relative to the mesh, so they are drawn with glDrawElementsBaseVertex().
+ *
+ * Meshes only ever hold the handle: when the buffers grow or are defragmented, the offsets stored in
+ * the allocation are updated and every mesh keeps working. */
+class GPUMemory
+{
+public:
+
+	/** Reserve space for a mesh with the given number of vertices and indices. Returns its handle.
+	 * The buffers grow (or are defragmented first, if that is enough) when there is not enough room. */
+	static int Allocate(uint vertexCount, uint indexCount);
+
+	/** Return the ranges of the given handle to the free lists. Freeing a dead handle does nothing. */
+	static void Free(int handle);
+
+	/** Look up the current ranges of a handle. */
+	static GPUAllocation& GetAllocation(int handle);
+
+	/** Upload all vertices or indices of an allocation. */
+	static void UploadVertices(int handle, std::vector<Vertex>& vertices);
+	static void UploadIndices(int handle, std::vector<uint>& indices);
+
+	/** Overwrite part of the vertices of an allocation, starting at the mesh-relative vertex first. */
+	static void UpdateVertices(int handle, uint first, uint count, const void* data);
+	static void UpdateVertices(int handle, uint first, uint byteOffset, uint byteCount, const void* data);
+
+	/** Move every live allocation to the front of its buffer so the free space is one contiguous range. */
+	static void Defragment();
+
+	/** Delete the buffers and the VAO. */
+	static void CleanUp();
+
+	// getters:
+	static uint getVAO();
+	static uint getVertexBuffer();
+	static uint getIndexBuffer();
+
+	/** Bytes currently handed out to meshes. */
+	static size_t GetLiveBytes();
+
+	/** Bytes the buffers occupy on the GPU, used or not. */
+	static size_t GetReservedBytes();
+
+	static void PrintUsage();
+
+private:
+
+	/** Create the buffers and the VAO the first time something is allocated. */
+	static void Initialize();
+
+	/** WHILE THE VAO IS ACTIVE:
+	 *
+	 * Point the vertex attributes at the vertex buffer.
+	 *
+	 * THIS METHOD NEEDS TO BE UPDATED whenever more information is added to the Vertex struct.
+	 * Currently, this method accounts for the following:
+	 * 1) Positions 3D.
+	 * 2) Colors 4D.
+	 * 3) Normals 3D.
+	 * 4) Textures 2D.
+	 * 5) Barycentric 3D.
+	 * 6) Highlight color 4D.
+	 * */
+	static void SetupAttributes();
+
+	/** Replace a buffer with a bigger one, copying over the old contents. */
+	static void GrowBuffer(uint& buffer, GLenum target, BufferAllocator& allocator, uint elementSize, uint minimumCapacity);
+
+	/** Create a buffer of the given size and copy the live ranges of one kind into it, back to back. */
+	static uint CompactBuffer(uint buffer, uint elementSize, uint capacity, bool vertices);
+
+	static uint vaoID;
+	static uint vertexBufferID;
+	static uint indexBufferID;
+
+	static BufferAllocator vertexAllocator;
+	static BufferAllocator indexAllocator;
+
+	static std::vector<GPUAllocation> allocations;
+	static std::vector<int> freeHandles;
+
+	// Starting sizes of the buffers, in elements.
+	static const uint INITIAL_VERTICES = 65536;
+	static const uint INITIAL_INDICES = 3 * 65536;
+
+	GPUMemory();
+	~GPUMemory();
+
+};
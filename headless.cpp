@@ -0,0 +1,244 @@
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <sstream>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+#include "polyhedron.hpp"
+#include "subdivision.hpp"
+#include "smoothing.hpp"
+#include "meshanalysis.hpp"
+#include "meshreader.hpp"
+#include "meshwriter.hpp"
+#include "parallel.hpp"
+#include "profiler.hpp"
+#include "memoryreport.hpp"
+
+/** Headless batch processing: the mesh pipeline of the viewer without a window or an OpenGL context.
+ *
+ * Every input file is read, initialized, subdivided, smoothed and analyzed, then written as a binary .ply, which can be read again.
+ * Files are handed out to the shared thread pool one at a time, and each file splits its own phases across the pool as well,
+ * so a batch of small tiles and a single large mesh both keep every thread busy.
+ *
+ * Usage: headless [options] file.ply|file.obj ...
+ *	-n levels		Loop subdivision levels (default 0).
+ *	-c threshold	Only subdivide triangles whose approximate Gaussian curvature is above threshold (default 0: all of them).
+ *	-s iterations	Smoothing iterations (default 0).
+ *	-t dt			Smoothing step (default 0.1).
+ *	-w weight		uniform, cord, cord-static, mean-curvature, mean-curvature-static, mean-value or mean-value-static (default uniform).
+ *	-o directory	Where to write the results (default: next to each input). Results are named input + ".out.ply".
+ *	-j threads		Threads to use (default: all).
+ *	-p file			Write a Chrome trace of the run, in builds with -DENABLE_PROFILER.
+ *	-m 1			Print the memory held by the mesh after every stage. Heap counters need -DENABLE_MEMORY_TRACKING,
+ *					and are for the whole process, so run one file with -j 1 to size a single mesh. */
+
+struct HeadlessOptions
+{
+	int levels = 0;
+	double curvatureThreshold = 0.0;
+	int smoothingIterations = 0;
+	double dt = 0.1;
+	Weight weight = Weight::UNIFORM;
+	std::string outputDirectory;
+	std::string tracePath;
+	bool reportMemory = false;
+	std::vector<std::string> files;
+};
+
+void PrintUsage()
+{
+	std::cout << "Usage: headless [-n levels] [-c curvature threshold] [-s smoothing iterations] [-t dt] [-w weight] [-o output directory] [-j threads] [-p trace.json] [-m 1] file ..." << std::endl;
+}
+
+bool ParseWeight(const std::string& name, Weight& weight)
+{
+	const char* names[] = {"uniform", "cord", "cord-static", "mean-curvature", "mean-curvature-static", "mean-value", "mean-value-static"};
+	const Weight weights[] = {Weight::UNIFORM, Weight::CORD_DYNAMIC, Weight::CORD_STATIC, Weight::MEAN_CURVATURE_DYNAMIC,
+		Weight::MEAN_CURVATURE_STATIC, Weight::MEAN_VALUE_DYNAMIC, Weight::MEAN_VALUE_STATIC};
+	for (int i = 0; i < 7; ++i)
+	{
+		if (name == names[i])
+		{
+			weight = weights[i];
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ParseOptions(int argc, char* argv[], HeadlessOptions& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		if (argument.size() == 2 && argument[0] == '-')
+		{
+			if (i + 1 >= argc)
+			{
+				return false;
+			}
+			std::string value = argv[++i];
+			switch (argument[1])
+			{
+				case 'n': options.levels = std::atoi(value.c_str()); break;
+				case 'c': options.curvatureThreshold = std::atof(value.c_str()); break;
+				case 's': options.smoothingIterations = std::atoi(value.c_str()); break;
+				case 't': options.dt = std::atof(value.c_str()); break;
+				case 'o': options.outputDirectory = value; break;
+				case 'p': options.tracePath = value; break;
+				case 'm': options.reportMemory = (std::atoi(value.c_str()) != 0); break;
+				case 'j': Parallel::SetThreadCount(std::atoi(value.c_str())); break;
+				case 'w':
+					if (!ParseWeight(value, options.weight))
+					{
+						std::cout << "UNKNOWN WEIGHT " << value << "." << std::endl;
+						return false;
+					}
+					break;
+				default: return false;
+			}
+		}
+		else
+		{
+			options.files.push_back(argument);
+		}
+	}
+	return !options.files.empty();
+}
+
+std::string GetOutputPath(const std::string& file, const HeadlessOptions& options)
+{
+	if (options.outputDirectory.empty())
+	{
+		return file + ".out.ply";
+	}
+	size_t slash = file.find_last_of('/');
+	std::string name = (slash == std::string::npos) ? file : file.substr(slash + 1);
+	return options.outputDirectory + "/" + name + ".out.ply";
+}
+
+// Add the memory held by the mesh after a stage to the output of the file, if asked to.
+void ReportMemory(const std::string& file, const std::string& stage, Polyhedron* p, TriangleMetrics* metrics, const HeadlessOptions& options, std::stringstream& log)
+{
+	if (!options.reportMemory)
+	{
+		return;
+	}
+	MemoryReport report(file + ", " + stage);
+	report.AddPolyhedron("Polyhedron", p);
+	if (metrics != NULL)
+	{
+		report.AddTriangleMetrics("Metrics", *metrics);
+	}
+	report.Print(log);
+	MemoryTracker::ResetPeak();
+}
+
+// Run the whole pipeline on one file. Returns a one-line summary, also when the file cannot be read.
+// Everything else printed on the way, e.g. by Polyhedron::Initialize() and the memory reports, goes to log,
+// so the output of files that run side by side does not mix.
+std::string ProcessFile(const std::string& file, const HeadlessOptions& options, bool& written, std::stringstream& log)
+{
+	PROFILE_SCOPE("ProcessFile");
+	auto start = std::chrono::high_resolution_clock::now();
+
+	Polyhedron* p = new Polyhedron();
+	if (!MeshReader::Read(file, p, log))
+	{
+		delete(p);
+		written = false;
+		return file + " -> NOT READ.\n";
+	}
+	ReportMemory(file, "read", p, NULL, options, log);
+	p->Initialize(&log);
+	ReportMemory(file, "initialized", p, NULL, options, log);
+	std::vector<AdaptiveSubdivisionCounts> levels;
+	p = Subdivision::SubdivideMesh(p, options.levels, options.curvatureThreshold, &levels, &log);
+	if (options.levels > 0)
+	{
+		ReportMemory(file, "subdivided", p, NULL, options, log);
+	}
+
+	for (int i = 0; i < options.smoothingIterations; ++i)
+	{
+		Smoothing::SmoothMesh(p, options.dt, options.weight);
+		DirtyRegion region;
+		p->UpdateDirtyRegion(region);
+	}
+	if (options.smoothingIterations > 0)
+	{
+		ReportMemory(file, "smoothed", p, NULL, options, log);
+	}
+
+	TriangleMetrics metrics = MeshAnalysis::ComputeTriangleMetrics(p->tlist);
+	ReportMemory(file, "analyzed", p, &metrics, options, log);
+	double area = 0.0;
+	double horizonArea = 0.0;
+	for (int i = 0; i < metrics.area.size(); ++i)
+	{
+		area += metrics.area[i];
+		horizonArea += metrics.horizonArea[i];
+	}
+
+	std::string output = GetOutputPath(file, options);
+	written = MeshWriter::WritePLY(output, p);
+
+	std::chrono::duration<double, std::milli> time = std::chrono::high_resolution_clock::now() - start;
+	std::stringstream summary;
+	summary << file << " -> " << (written ? output : "NOT WRITTEN") << ": " << p->vlist.size() << " vertices, " << p->tlist.size() << " triangles, "
+		<< "valence deficit " << p->valenceDeficit << ", angle deficit " << p->angleDeficit << ", "
+		<< "area " << area << ", horizon area " << horizonArea << ", " << time.count() << " ms." << std::endl;
+	for (int i = 0; i < levels.size(); ++i)
+	{
+		summary << "  " << Subdivision::Describe(levels[i]) << std::endl;
+	}
+	delete(p);
+	return summary.str();
+}
+
+int main(int argc, char* argv[])
+{
+	HeadlessOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return -1;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	std::vector<std::string> summaries(options.files.size());
+	std::vector<char> written(options.files.size(), 0);
+	std::mutex outputMutex;
+	Parallel::For(0, options.files.size(), 1, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			bool ok = false;
+			std::stringstream log;
+			summaries[i] = ProcessFile(options.files[i], options, ok, log);
+			written[i] = ok;
+
+			std::lock_guard<std::mutex> lock(outputMutex);
+			std::cout << log.str() << summaries[i];
+		}
+	});
+	std::chrono::duration<double, std::milli> time = std::chrono::high_resolution_clock::now() - start;
+
+	// Everything again in input order, after the interleaved output of the files.
+	int failed = 0;
+	std::cout << std::endl << "***** SUMMARY *****" << std::endl;
+	for (int i = 0; i < summaries.size(); ++i)
+	{
+		std::cout << summaries[i];
+		failed += written[i] ? 0 : 1;
+	}
+	std::cout << options.files.size() << " files in " << time.count() << " ms, " << failed << " not written." << std::endl;
+	if (!options.tracePath.empty())
+	{
+		Profiler::WriteTrace(options.tracePath);
+	}
+	return (failed == 0) ? 0 : 1;
+}
@@ -1,84 +1,85 @@
 #include "loader.hpp"
 
+size_t Loader::uploadedBytes = 0;
 
 
-// get a RawModel from a list of Vertices.
+// upload a mesh into the shared buffers.
 void Loader::PrepareMesh(MeshComponent& mesh)
 {
-	// get a VAO ID and bind it:
-	uint vaoID;
-	InitializeVAO(vaoID);
-	mesh.setVAO(vaoID);
-
-	// bind the triangles buffer:
-	AttributeList_Triangles(mesh.getTriangles());
-
-	// store vertex data:
-	mesh.setVBO(AttributeList_StoreData(mesh.getVertices()));
-
-	// unbind the VAO:
-	UnbindVAO();
+	PROFILE_SCOPE("Loader::PrepareMesh");
+	if (mesh.getAllocation() != -1)
+	{
+		ReleaseMesh(mesh);
+	}
+
+	std::vector<Vertex>& vertices = mesh.getVertices();
+	std::vector<uint>& triangles = mesh.getTriangles();
+
+	int handle = GPUMemory::Allocate(vertices.size(), triangles.size());
+	mesh.setAllocation(handle);
+
+	// triangle indices stay relative to the mesh; the draw call adds the base vertex.
+	GPUMemory::UploadIndices(handle, triangles);
+	GPUMemory::UploadVertices(handle, vertices);
+	uploadedBytes += vertices.size() * sizeof(Vertex) + triangles.size() * sizeof(uint);
 }
 
-// pass data to GPU:
-
-void Loader::InitializeVAO(uint& vaoID)
+void Loader::ReleaseMesh(MeshComponent& mesh)
 {
-	// create a VAO ID handle, add it to the VAO list, and bind it.
-	glGenVertexArrays(1, &vaoID);
-	glBindVertexArray(vaoID);
-}
-void Loader::UnbindVAO()
-{
-	glBindVertexArray(0);
+	GPUMemory::Free(mesh.getAllocation());
+	mesh.setAllocation(-1);
 }
 
-void Loader::AttributeList_Triangles(std::vector<uint>& triangles)
+void Loader::UpdateHighlight(MeshComponent& mesh, uint v0, uint v1, uint v2, glm::vec4 color)
 {
-	// create a VBO ID handle, add it to the list, and bind the data.
-	uint vboID;
-	glGenBuffers(1, &vboID);
-
-	// triangle index arrays are ELEMENT ARRAY BUFFERS.
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vboID);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, triangles.size() * sizeof(uint), &triangles[0], GL_STATIC_DRAW);
-
-}
-
-void Loader::UpdateHighlight(uint vbo, uint v0, uint v1, uint v2, glm::vec4 color)
-{
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	uint vertexSize = sizeof(Vertex);
+	PROFILE_SCOPE("Loader::UpdateHighlight");
 	uint bytesToHighlightColor = 15 * sizeof(float);
 	uint highlightColorSize = 4 * sizeof(float);
 	std::vector<float> data = {color.r, color.g, color.b, color.a };
 
-	// First vertex:
-	glBufferSubData(GL_ARRAY_BUFFER, v0 * vertexSize + bytesToHighlightColor, highlightColorSize, &data[0]);
-	
-	// Second vertex:
-	glBufferSubData(GL_ARRAY_BUFFER, v1 * vertexSize + bytesToHighlightColor, highlightColorSize, &data[0]);
-	
-	// Third vertex:
-	glBufferSubData(GL_ARRAY_BUFFER, v2 * vertexSize + bytesToHighlightColor, highlightColorSize, &data[0]);
+	int handle = mesh.getAllocation();
+	GPUMemory::UpdateVertices(handle, v0, bytesToHighlightColor, highlightColorSize, &data[0]);
+	GPUMemory::UpdateVertices(handle, v1, bytesToHighlightColor, highlightColorSize, &data[0]);
+	GPUMemory::UpdateVertices(handle, v2, bytesToHighlightColor, highlightColorSize, &data[0]);
+	uploadedBytes += 3 * highlightColorSize;
 }
 
-uint Loader::AttributeList_StoreData(std::vector<Vertex>& vertices) 
+void Loader::UpdateVertices(MeshComponent& mesh, std::vector<uint> vertexIndices)
 {
-	uint vboID;
-	glGenBuffers(1, &vboID);
-
-	uint vertexSize = sizeof(Vertex);
-
-	glBindBuffer(GL_ARRAY_BUFFER, vboID);
-	glBufferData(GL_ARRAY_BUFFER, vertexSize * vertices.size(), &vertices[0], GL_STATIC_DRAW); // easily get a pointer from std::vector by referencing the 0th element.
+	PROFILE_SCOPE("Loader::UpdateVertices");
+	if (vertexIndices.empty())
+	{
+		return;
+	}
+	std::sort(vertexIndices.begin(), vertexIndices.end());
+
+	std::vector<Vertex>& vertices = mesh.getVertices();
+	int handle = mesh.getAllocation();
+	uint first = vertexIndices[0];
+	uint last = first;
+	for (int i = 1; i <= vertexIndices.size(); ++i)
+	{
+		// Extend the run while the indices are consecutive; upload it when they stop.
+		if (i < vertexIndices.size() && vertexIndices[i] <= last + 1)
+		{
+			last = vertexIndices[i];
+			continue;
+		}
+		GPUMemory::UpdateVertices(handle, first, last - first + 1, &vertices[first]);
+		uploadedBytes += (size_t)(last - first + 1) * sizeof(Vertex);
+		if (i < vertexIndices.size())
+		{
+			first = last = vertexIndices[i];
+		}
+	}
+}
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, vertexSize, 0); // positions 3D.
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, vertexSize, (const void*)(3 * sizeof(float))); // colors 4D.
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, vertexSize, (const void*)(7 * sizeof(float))); // normals 3D.
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, vertexSize, (const void*)(10 * sizeof(float))); // textures 2D.
-	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, vertexSize, (const void*)(12 * sizeof(float))); // barycentric 3D.
-	glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, vertexSize, (const void*)(15 * sizeof(float))); // highlight color 4D.
+void Loader::CleanUp()
+{
+	GPUMemory::CleanUp();
+}
 
-	return vboID;
+size_t Loader::getUploadedBytes()
+{
+	return uploadedBytes;
 }
@@ -4,57 +4,50 @@
 
 #include <vector>
 #include <iostream>
+#include <algorithm>
 
 #include "utilities.hpp"
 #include "meshcomponent.hpp"
+#include "gpumemory.hpp"
+#include "profiler.hpp"
 
-/** Static class that loads model data into the GPU and returns a RawModel object with its VAO ID. 
- * 
- * The most important method is PrepareMesh() which passes a mesh component to the GPU. */
+/** Static class that loads model data into the GPU.
+ *
+ * The most important method is PrepareMesh() which passes a mesh component to the GPU.
+ * The data itself lives in the shared buffers of GPUMemory; the mesh only remembers its allocation handle. */
 class Loader
 {
 public:
 
-	/** Translate the data in the given mesh component into VAO data.
+	/** Copy the data in the given mesh component into the shared GPU buffers.
 	 *
 	 * This assumes the mesh is formatted as TRIANGLES.
-	 * 
-	 * When an entity is created with a mesh, this function should be called on the mesh to register it to the GPU. */
+	 *
+	 * When an entity is created with a mesh, this function should be called on the mesh to register it to the GPU.
+	 * Calling it again on a mesh that is already registered releases the old data first. */
 	static void PrepareMesh(MeshComponent& mesh);
 
-	/** Update the highlight color of the three vertices.
-	 * The arguments are the indices of the vertices in the vertex list. */
-	static void UpdateHighlight(uint vao, uint v0, uint v1, uint v2, glm::vec4 color);
-
-private:
+	/** Give the GPU space used by this mesh back to GPUMemory.
+	 * Copies of a MeshComponent share the same allocation, so only release it once. */
+	static void ReleaseMesh(MeshComponent& mesh);
 
-	// pass data to GPU:
+	/** Update the highlight color of the three vertices.
+	 * The arguments are the indices of the vertices in the mesh's vertex list. */
+	static void UpdateHighlight(MeshComponent& mesh, uint v0, uint v1, uint v2, glm::vec4 color);
 
-	/** Given an empty uint, get a VAO ID from OpenGL and activate it. 
-	 * 
-	 * While this VAO ID is active, data can be assigned to it in the GPU.*/
-	static void InitializeVAO(uint& vaoID);
+	/** Re-upload only the given vertices of the mesh, e.g. after an edit.
+	 * Neighbouring indices are merged so that each run of vertices is a single upload. */
+	static void UpdateVertices(MeshComponent& mesh, std::vector<uint> vertexIndices);
 
-	/** Deactivate the current VAO so that a new one can be registered. */
-	static void UnbindVAO();
+	/** Release all GPU buffers. */
+	static void CleanUp();
 
-	/** WHILE A VAO IS ACTIVE: 
-	 * 
-	 * Generate a VBO consisting of the arrangement of triangles.
-	 * The triangles are stored as an ordered list of uints indicating how the vertices are stitched together. */
-	static void AttributeList_Triangles(std::vector<uint>& triangles);
+	/** Bytes sent to the GPU so far by PrepareMesh() and the updates. */
+	static size_t getUploadedBytes();
 
-	/* WHILE A VAO IS ACTIVE:
-	 *
-	 * Generate a VBO for vertex information.
-	 * 
-	 * THIS METHOD NEEDS TO BE UPDATED whenever more information is added to the Vertex struct.
-	 * Currently, this method accounts for the following:
-	 * 1) Positions 3D.
-	 * 2) Colors 4D.
-	 * */
-	static uint AttributeList_StoreData(std::vector<Vertex>& vertices);
+private:
 
+	static size_t uploadedBytes;
 
 	Loader();
 	~Loader();
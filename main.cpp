@@ -7,6 +7,7 @@
 #include <cmath>
 #include <iostream>
 #include <algorithm>
+#include <chrono>
 
 #include "glew.h"
 #include <GL/gl.h>
@@ -20,12 +21,27 @@
 #include "vertex.hpp"
 #include "meshcomponent.hpp"
 #include "loader.hpp"
+#include "batchrenderer.hpp"
+#include "frustum.hpp"
+#include "chunkquadtree.hpp"
 #include "basicshader.hpp"
 #include "shadowshader.hpp"
+#include "frameuniforms.hpp"
+#include "shadowmap.hpp"
+#include "framestatistics.hpp"
+#include "framescheduler.hpp"
+#include "scalarfield.hpp"
+#include "parallel.hpp"
+#include "profiler.hpp"
 #include "polyhedron.hpp"
 #include "meshanalysis.hpp"
 #include "subdivision.hpp"
+#include "meshcache.hpp"
+#include "meshwriter.hpp"
+#include "textureloader.hpp"
+#include "memoryreport.hpp"
 #include "meshfactory.hpp"
+#include "perlinnoise.hpp"
 #include "mousepicker.hpp"
 #include "camera.hpp"
 
@@ -83,6 +99,12 @@ void MouseMotion(int x, int y);
 void Resize(int x, int y);
 void Visibility(int);
 void Reset();
+void ReportCulling();
+void PrintActiveField();
+void ReportMemory(std::string stage);
+void SculptSelection();
+void UpdateModel();
+void ExportMeshes();
 
 
 
@@ -93,9 +115,7 @@ void Reset();
 /************************************ FILE IO ************************************/
 /*********************************************************************************/
 /*********************************************************************************/
-unsigned char*	BmpToTexture( char *, int *, int * );
-int	ReadInt( FILE * );
-short ReadShort( FILE * );
+void InitializeTexture(std::string file);
 
 
 
@@ -121,13 +141,62 @@ void InitializeShadows(int width, int height);
 MeshComponent mesh;
 std::vector<MeshComponent> meshes;
 
+// The model, kept for editing, and its per-triangle metrics:
+Polyhedron* model = nullptr;
+TriangleMetrics modelMetrics;
+int selectedTriangle = -1; // In model->tlist.
+const double sculptStep = 0.01;
+// Subdivision of the model: triangles whose approximate Gaussian curvature is above this are refined, 0 refines all of them.
+const double adaptiveCurvatureThreshold = 0.0;
+const std::string modelPath = "./tempmodels/bunny.ply";
+const std::string modelCachePath = "./tempmodels/bunny.ply.cache";
+
+// Profiler trace, written by 'p' and on exit in builds with -DENABLE_PROFILER:
+const std::string tracePath = "./trace.json";
+
+// Per-triangle metrics of the model, colormapped on the GPU:
+ScalarField scalarField;
+int activeField = 0; // -1 shows the vertex colors.
+
+// Terrain:
+PerlinNoise terrainNoise;
+const int terrainChunksPerSide = 16;
+const uint terrainChunkResolution = 17;
+const float terrainChunkSize = 1.0f;
+const float terrainHeight = 0.6f;
+const float terrainBaseHeight = -1.5f;
+const float terrainWaterLevel = -0.15f;
+
+// Terrain levels of detail: each level is drawn terrainLODDistance further out than the one before.
+const int terrainLODLevels = 3;
+const float terrainLODDistance = 3.0f;
+const double terrainMaxError = 1e-4;
+
+// Batched rendering:
+BatchRenderer batchRenderer;
+bool enableBatching = true;
+
+// Frustum culling:
+Frustum frustum;
+ChunkQuadtree chunkQuadtree;
+std::vector<int> visibleMeshes;
+bool enableCulling = true;
+uint lastDrawn = 0;
+uint lastCulled = 0;
+
 // Shaders:
 BasicShader shader;
 ShadowShader shadowShader;
+FrameUniforms frameUniforms;
+
+// Shadows:
+ShadowMap shadowMap;
+const int shadowMapSize = 2048;
 
 // Perspective:
 glm::mat4 perspectiveMatrix;
 glm::mat4 lightPerspectiveMatrix;
+glm::mat4 lightViewMatrix = glm::mat4(1);
 glm::mat4 viewMatrix;
 glm::mat4 modelViewProjectionMatrix;
 float near = 0.1f;
@@ -161,11 +230,17 @@ glm::vec3 lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
 // Rendering effects:
 bool enableWireframe = false;
 
-// Animation:
-bool animate = true;
+// Animation. Off by default, so a static scene is only drawn when something changes ('f' toggles it):
+bool animate = false;
+const int maxFramesPerSecond = 60;
 float currentTime = 0;
 #define MS_IN_THE_ANIMATION_CYCLE 10000
 
+// Frame time, CPU and GPU time of the passes, draws and triangles. Printed every few frames, and recorded to CSV with 'o':
+FrameStatistics frameStatistics;
+const std::string frameStatisticsPath = "./frames.csv";
+std::string lastFrameSummary;
+
 // User input:
 MousePicker mousePicker;
 bool selectTriangle = false;
@@ -228,6 +303,7 @@ int main(int argc, char* argv[])
 // Initialize graphics properties.
 void InitGraphics()
 {
+	PROFILE_SCOPE("InitGraphics");
 	// Red-green-blue-alpha color, double-buffering, and z-buffering:
 	glutInitDisplayMode( GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH );
 
@@ -261,36 +337,30 @@ void InitGraphics()
 	glutTabletButtonFunc( NULL );
 	glutMenuStateFunc( NULL );
 	glutTimerFunc( -1, NULL, 0 );
-	glutIdleFunc( Animate );
+	glutIdleFunc( NULL );
+
+	// Frames are drawn on demand, and on a timer while animating, rather than from the idle callback:
+	FrameScheduler::Initialize(mainWindow, maxFramesPerSecond);
+	FrameScheduler::SetAnimateFunc(Animate);
+	FrameScheduler::SetAnimating(animate);
 
 	// Init glew (a window must be open to do this):
 	GLenum err = glewInit( );
 }
 
-Polyhedron* SubdivideMesh(Polyhedron* p, int n)
-{
-	std::vector<Polyhedron*> loops;
-	Polyhedron* lp;
-	lp = p;
-	loops.push_back(lp);
-	for (int i = 0; i < n; ++i)
-	{
-		Polyhedron* q;
-		q = Subdivision::LoopSubdivisionHeap(loops[i]);
-		q->Initialize();
-		loops.push_back(q);
-		delete(loops[i]);
-	}
-	return loops.back();
-}
-
-
 void InitLists()
 {
+	PROFILE_SCOPE("InitLists");
 	// Perspective Matrices:
 	perspectiveMatrix = glm::perspective(glm::pi<float>() / 3.0f, (float)windowWidth / (float)windowHeight, near, far);
 	lightPerspectiveMatrix = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 0.1f, 500.0f);
 
+	// Uniform blocks shared by the shaders:
+	frameUniforms.Initialize();
+
+	// Timer queries for the render passes:
+	frameStatistics.Initialize();
+
 	// Test Shader:
 	shader = BasicShader();
 	shader.Initialize();	
@@ -302,26 +372,107 @@ void InitLists()
 	// Mouse picker:
 	mousePicker = MousePicker(windowWidth, windowHeight, perspectiveMatrix);
 
-	Polyhedron* p = new Polyhedron("./tempmodels/bunny.ply");
-	p->Initialize();
-
 	camera.position = glm::vec3(0, 0, 3.0f);
 
 	lightPosition = camera.position;
 	lightEye = camera.GetDirection();
 
-
+	// The model with its adjacency and metrics comes from the cache if it is up to date;
+	// otherwise it is built from the .ply file and the cache is written for the next run.
 	int n = 0;
-	Polyhedron* lp = SubdivideMesh(p, n);
+	std::string build = "loop " + std::to_string(n) + " " + std::to_string(adaptiveCurvatureThreshold);
+	auto modelStart = std::chrono::high_resolution_clock::now();
+	Polyhedron* lp = nullptr;
+	bool cached = MeshCache::Load(modelCachePath, modelPath, build, lp, modelMetrics);
+	if (!cached)
+	{
+		Polyhedron* p = new Polyhedron(modelPath);
+		p->Initialize();
+		std::vector<AdaptiveSubdivisionCounts> levels;
+		lp = Subdivision::SubdivideMesh(p, n, adaptiveCurvatureThreshold, &levels);
+		for (int i = 0; i < levels.size(); ++i)
+		{
+			std::cout << Subdivision::Describe(levels[i]) << std::endl;
+		}
+		modelMetrics = MeshAnalysis::ComputeTriangleMetrics(lp->tlist);
+		MeshCache::Save(modelCachePath, modelPath, build, lp, modelMetrics);
+	}
+	std::chrono::duration<double, std::milli> modelTime = std::chrono::high_resolution_clock::now() - modelStart;
+	std::cout << (cached ? "Loaded model from cache in " : "Built model in ") << modelTime.count() << " ms." << std::endl;
+	model = lp;
+	ReportMemory("model built");
+
+	// Every metric is uploaded once; 'm' switches between them.
+	std::vector<double> horizons(lp->tlist.size());
+	std::vector<double> originalHorizons(lp->tlist.size());
+	std::vector<double> curvatures(lp->tlist.size());
+	for (int i = 0; i < lp->tlist.size(); ++i)
+	{
+		horizons[i] = modelMetrics.horizonArea[i] / modelMetrics.perimeter[i];
+		originalHorizons[i] = modelMetrics.horizonArea[i] / modelMetrics.area[i];
+		curvatures[i] = modelMetrics.sphericalArea[i] / modelMetrics.area[i];
+	}
+	scalarField.AddField("Area(H_V) / Length(V)", horizons);
+	scalarField.AddField("Area(H_V) / Area(V)", originalHorizons);
+	scalarField.AddField("Approximate Gaussian curvature", curvatures);
+	scalarField.Upload();
+	PrintActiveField();
 
-	std::vector<double> horizons = MeshAnalysis::GetHorizonMeasuresDouble(lp->tlist);
-	//std::vector<double> horizons = MeshAnalysis::GetApproximateGaussianCurvatures(lp->tlist);
-	//std::vector<double> horizons = MeshAnalysis::GetOriginalHorizonMeasuresDouble(lp->tlist);
-	mesh = MeshComponent(lp, horizons);
+	mesh = MeshFactory::GetTriangleMesh(lp, glm::vec4(1.0f));
+	mesh.fieldOffset = 0;
 
-	delete(lp);
+	// The polyhedron is kept so it can be edited ('e').
 	Loader::PrepareMesh(mesh);
 	meshes.push_back(mesh);
+
+	// Terrain chunks around the model, every level of detail of each.
+	// The chunks are independent, so they are built in parallel; only the upload has to happen here.
+	auto terrainStart = std::chrono::high_resolution_clock::now();
+	int terrainChunks = terrainChunksPerSide * terrainChunksPerSide;
+	std::vector<std::vector<MeshComponent>> terrainLODs(terrainChunks);
+	Parallel::For(0, terrainChunks, 1, [&](int begin, int end)
+	{
+		for (int c = begin; c < end; ++c)
+		{
+			int x = c % terrainChunksPerSide - terrainChunksPerSide / 2;
+			int z = c / terrainChunksPerSide - terrainChunksPerSide / 2;
+			terrainLODs[c] = MeshFactory::GetTerrainChunkLODs(terrainNoise, x, z, terrainChunkResolution, terrainChunkSize, terrainHeight, terrainWaterLevel, terrainLODLevels, terrainMaxError);
+		}
+	});
+	uint terrainTriangles[terrainLODLevels] = {};
+	for (int c = 0; c < terrainChunks; ++c)
+	{
+		std::vector<MeshComponent>& lods = terrainLODs[c];
+		for (int i = 0; i < lods.size(); ++i)
+		{
+			MeshComponent& chunk = lods[i];
+			chunk.transform = glm::translate(glm::mat4(1), glm::vec3(0.0f, terrainBaseHeight, 0.0f)) * chunk.transform;
+			chunk.lodNear = (i == 0) ? 0.0f : i * terrainLODDistance;
+			chunk.lodFar = (i == lods.size() - 1) ? std::numeric_limits<float>::max() : (i + 1) * terrainLODDistance;
+			terrainTriangles[i] += chunk.getTriangles().size() / 3;
+			Loader::PrepareMesh(chunk);
+			meshes.push_back(chunk);
+		}
+	}
+	std::chrono::duration<double, std::milli> terrainTime = std::chrono::high_resolution_clock::now() - terrainStart;
+	std::cout << "Built terrain levels of detail in " << terrainTime.count() << " ms:";
+	for (int i = 0; i < terrainLODLevels; ++i)
+	{
+		std::cout << " " << terrainTriangles[i];
+	}
+	std::cout << " triangles." << std::endl;
+	GPUMemory::PrintUsage();
+	ReportMemory("terrain uploaded");
+
+	// Record one indirect draw per mesh:
+	batchRenderer.Initialize();
+	batchRenderer.Build(meshes);
+
+	// Bounds of every mesh, for culling:
+	chunkQuadtree.Build(meshes);
+
+	// Depth from the light:
+	InitializeShadows(shadowMapSize, shadowMapSize);
 	
 	/*
 	mesh = MeshFactory::GetSphereTriangles(1.0f, 300);
@@ -362,6 +513,9 @@ void InitLists()
 // Main loop: draw the scene.
 void Display()
 {
+	PROFILE_SCOPE("Display");
+	bool continuous = FrameScheduler::FrameStarted();
+	frameStatistics.BeginFrame(continuous);
 	// Parameters for the window we will draw to:
 	glutSetWindow( mainWindow );
 	glDrawBuffer(GL_BACK);
@@ -392,52 +546,294 @@ void Display()
 	// Update the mouse picker to the new camera:
 	mousePicker.UpdateViewMatrix(viewMatrix);
 
+	// Light:
+	glm::vec3 lightUp = (std::abs(lightEye.y) > 0.99f * glm::length(lightEye)) ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+	lightViewMatrix = glm::lookAt(lightPosition, lightPosition + lightEye, lightUp);
+	frameUniforms.UpdateLight(lightViewMatrix, lightPerspectiveMatrix, lightPosition, lightColor, ambient, diffuse, specular, shininess);
+
+	// Shadow pass. Only runs when the light or the geometry has changed since the last one:
+	auto shadowStart = std::chrono::high_resolution_clock::now();
+	frameStatistics.BeginPass(FramePass::SHADOW);
+	shadowMap.Update(lightViewMatrix, lightPerspectiveMatrix);
+	bool shadowRendered = shadowMap.Render(shadowShader, meshes);
+	if (shadowRendered)
+	{
+		glViewport(0, 0, windowWidth, windowHeight);
+	}
+	frameStatistics.EndPass(FramePass::SHADOW);
+	std::chrono::duration<double, std::milli> shadowTime = std::chrono::high_resolution_clock::now() - shadowStart;
+
+	auto submissionStart = std::chrono::high_resolution_clock::now();
+
+	// Find the meshes that can be seen:
+	visibleMeshes.clear();
+	if (enableCulling)
+	{
+		frustum.Update(perspectiveMatrix * viewMatrix);
+		chunkQuadtree.Cull(frustum, visibleMeshes);
+	}
+	else
+	{
+		for (int i = 0; i < meshes.size(); ++i)
+		{
+			visibleMeshes.push_back(i);
+		}
+	}
+
+	// Only one level of detail of each terrain chunk, depending on how far away it is:
+	glm::vec3 eye = glm::vec3(glm::inverse(viewMatrix)[3]);
+	visibleMeshes.erase(std::remove_if(visibleMeshes.begin(), visibleMeshes.end(), [eye](int i) { return !meshes[i].IsLODVisible(eye); }), visibleMeshes.end());
+	ReportCulling();
+
+	// One draw per visible mesh on either path:
+	uint triangles = 0;
+	for (int j = 0; j < visibleMeshes.size(); ++j)
+	{
+		triangles += GPUMemory::GetAllocation(meshes[visibleMeshes[j]].getAllocation()).indexCount / 3;
+	}
+
+	// The GPU time of the scene covers the terrain, water included, and the models:
+	frameStatistics.BeginPass(FramePass::SCENE);
+
+	// Per-frame state is uploaded once, for every shader:
+	frameUniforms.UpdateFrame(perspectiveMatrix, viewMatrix, camera.position);
+
 	// Activate the shader:
 	shader.Start();
+	shader.LoadTexture(3);
+	shader.LoadWireframe(enableWireframe);
+	shader.LoadBatched(enableBatching);
+	shader.LoadShadows(ShadowMap::TEXTURE_UNIT);
+	shadowMap.Bind(ShadowMap::TEXTURE_UNIT);
+
+	// Only a few uniforms change when another metric is shown:
+	if (activeField >= 0)
+	{
+		ScalarFieldRange& field = scalarField.getField(activeField);
+		shader.LoadScalarField(ScalarField::TEXTURE_UNIT, field.offset, glm::vec3(field.min, field.mean, field.max));
+	}
+	else
+	{
+		shader.LoadScalarField(ScalarField::TEXTURE_UNIT, -1, glm::vec3(0));
+	}
+	scalarField.Bind(ScalarField::TEXTURE_UNIT);
 
-	for (int i = 0; i < meshes.size(); ++i)
+	if (enableBatching)
 	{
-		glBindVertexArray(meshes[i].getVAO());
-
-		glEnableVertexAttribArray(0);
-		glEnableVertexAttribArray(1);
-		glEnableVertexAttribArray(2);
-		glEnableVertexAttribArray(3);
-		glEnableVertexAttribArray(4);
-		glEnableVertexAttribArray(5);
-
-		shader.LoadProjectionMatrix(perspectiveMatrix);
-		shader.LoadViewMatrix(viewMatrix);
-		shader.LoadTransformMatrix(meshes[i].transform);
-		shader.LoadLighting(ambient, diffuse, specular, shininess, lightColor, lightPosition, camera.position);
-		shader.LoadTexture(3);
-		shader.LoadWireframe(enableWireframe);
-		
 		// Draw calls:
-		glDrawElements(GL_TRIANGLES, meshes[i].getCount(), GL_UNSIGNED_INT, nullptr);
-		//glDrawArrays(GL_TRIANGLES, 0, meshes[i].getCount());
+		batchRenderer.Draw(visibleMeshes);
+	}
+	else
+	{
+		// Every mesh lives in the same buffers, so the VAO only needs to be bound once:
+		glBindVertexArray(GPUMemory::getVAO());
+
+		for (int j = 0; j < visibleMeshes.size(); ++j)
+		{
+			int i = visibleMeshes[j];
+			GPUAllocation& allocation = GPUMemory::GetAllocation(meshes[i].getAllocation());
+
+			// Only the model transform and field offset change from mesh to mesh:
+			shader.LoadTransformMatrix(meshes[i].transform);
+			shader.LoadFieldOffset(meshes[i].fieldOffset);
+
+			// Draw calls:
+			const void* indexOffset = (const void*)((size_t)allocation.indexOffset * sizeof(uint));
+			glDrawElementsBaseVertex(GL_TRIANGLES, allocation.indexCount, GL_UNSIGNED_INT, indexOffset, allocation.vertexOffset);
+			//glDrawArrays(GL_TRIANGLES, 0, meshes[i].getCount());
+		}
+
+		glBindVertexArray(0);
 	}
 
 	shader.Stop();
+	frameStatistics.EndPass(FramePass::SCENE);
+
+	std::chrono::duration<double, std::milli> submission = std::chrono::high_resolution_clock::now() - submissionStart;
+	frameStatistics.EndFrame(shadowTime.count(), shadowRendered, submission.count(), visibleMeshes.size(), triangles);
 
 
 	// Be sure the graphics buffer has been sent:
 	// Note: be sure to use glFlush( ) here, not glFinish( ) !
-	glutSwapBuffers( );
-	glFlush( );
+	{
+		PROFILE_SCOPE("Swap buffers");
+		glutSwapBuffers( );
+		glFlush( );
+	}
+}
+
+
+// Push the vertices of the selected triangle outward along their normals.
+void SculptSelection()
+{
+	if (model == nullptr || selectedTriangle < 0)
+	{
+		std::cout << "Select a triangle on the model first ('t')." << std::endl;
+		return;
+	}
+
+	Triangle& t = model->tlist[selectedTriangle];
+	for (int j = 0; j < 3; ++j)
+	{
+		Vert* v = t.vertices[j];
+		v->x += sculptStep * v->normal.x;
+		v->y += sculptStep * v->normal.y;
+		v->z += sculptStep * v->normal.z;
+		model->MarkDirty(v->index);
+	}
+	UpdateModel();
+}
+
+// Bring everything derived from the model up to date after its vertices moved,
+// touching only the triangles around the moved vertices.
+void UpdateModel()
+{
+	PROFILE_SCOPE("UpdateModel");
+	if (model == nullptr || !model->HasDirtyVertices())
+	{
+		return;
+	}
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// Normals, areas and angles, then the metrics that depend on them:
+	DirtyRegion region;
+	model->UpdateDirtyRegion(region);
+	MeshAnalysis::UpdateTriangleMetrics(model->tlist, region.triangles, modelMetrics);
+
+	// The model mesh has three vertices per triangle, in tlist order (MeshFactory::GetTriangleMesh()).
+	MeshComponent& modelMesh = meshes[0];
+	std::vector<Vertex>& vertices = modelMesh.getVertices();
+	std::vector<uint> changed;
+	std::vector<double> horizons, originalHorizons, curvatures;
+	for (int i = 0; i < region.triangles.size(); ++i)
+	{
+		int k = region.triangles[i];
+		Triangle& t = model->tlist[k];
+		for (int j = 0; j < 3; ++j)
+		{
+			Vert* v = t.vertices[j];
+			Vertex& w = vertices[3 * k + j];
+			w.setPosition((float)v->x, (float)v->y, (float)v->z);
+			w.setNormal((float)v->normal.x, (float)v->normal.y, (float)v->normal.z);
+			changed.push_back(3 * k + j);
+		}
+		horizons.push_back(modelMetrics.horizonArea[k] / modelMetrics.perimeter[k]);
+		originalHorizons.push_back(modelMetrics.horizonArea[k] / modelMetrics.area[k]);
+		curvatures.push_back(modelMetrics.sphericalArea[k] / modelMetrics.area[k]);
+	}
+
+	// Only the changed ranges go to the GPU:
+	Loader::UpdateVertices(modelMesh, changed);
+	scalarField.UpdateValues(0, region.triangles, horizons);
+	scalarField.UpdateValues(1, region.triangles, originalHorizons);
+	scalarField.UpdateValues(2, region.triangles, curvatures);
+	if (selectedTriangle >= 0)
+	{
+		uint first = 3 * selectedTriangle;
+		Loader::UpdateHighlight(modelMesh, first, first + 1, first + 2, glm::vec4(1.0f, 215.0f / 255.0f, 0.0f, 1.0f));
+	}
+
+	// Bounds for culling, and the part of the shadow map the model covers.
+	// The shadow the model cast before the edit has to go too, so both the old and the new bounds are redrawn.
+	glm::vec3 oldMin, oldMax;
+	modelMesh.GetWorldBounds(oldMin, oldMax);
+	modelMesh.ComputeBounds();
+	chunkQuadtree.Build(meshes);
+	shadowMap.MarkDirty(oldMin, oldMax);
+	shadowMap.MarkDirty(modelMesh);
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+	std::cout << "Updated " << region.vertices.size() << " vertices and " << region.triangles.size() << " triangles in " << elapsed.count() << " ms." << std::endl;
+}
+
+// Write the model, as edited, and the finest level of the terrain to .ply files.
+void ExportMeshes()
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	bool exported = MeshWriter::WritePLY("./tempmodels/model.ply", model);
+
+	std::vector<MeshComponent*> terrain;
+	for (int i = 0; i < meshes.size(); ++i)
+	{
+		if (meshes[i].lodLevel == 0)
+		{
+			terrain.push_back(&meshes[i]);
+		}
+	}
+	exported = MeshWriter::WritePLY("./tempmodels/terrain.ply", terrain) && exported;
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+	if (exported)
+		std::cout << "Exported the model and " << terrain.size() << " terrain chunks in " << elapsed.count() << " ms." << std::endl;
+}
+
+
+// Print the bytes held by the model, the meshes and the GPU, e.g. after a stage of building the scene. Also on 'k'.
+void ReportMemory(std::string stage)
+{
+	MemoryReport report(stage);
+	if (model != nullptr)
+	{
+		report.AddPolyhedron("Model", model);
+		report.AddTriangleMetrics("Model", modelMetrics);
+	}
+	report.AddMeshComponents("Meshes", meshes);
+
+	// What the GPU holds. Everything sent through Loader lives in the shared mesh buffers.
+	report.Add("GPU", "mesh buffers (live)", meshes.size(), GPUMemory::GetLiveBytes());
+	report.Add("GPU", "mesh buffers (free)", 0, GPUMemory::GetReservedBytes() - GPUMemory::GetLiveBytes());
+	report.Add("GPU", "textures", TextureLoader::GetTextureCount(), TextureLoader::GetBytes());
+	report.Add("GPU", "shadow map", 1, (size_t)shadowMap.getWidth() * shadowMap.getHeight() * 4);
+	report.Print();
+	std::cout << "  Loader has uploaded " << MemoryReport::FormatBytes(Loader::getUploadedBytes()) << " so far." << std::endl;
+}
+
+
+// Print the name and range of the metric being shown.
+void PrintActiveField()
+{
+	if (activeField < 0)
+	{
+		std::cout << "Showing vertex colors." << std::endl;
+		return;
+	}
+	ScalarFieldRange& field = scalarField.getField(activeField);
+	std::cout << "Showing " << field.name << ": min " << field.min << ", mean " << field.mean << ", max " << field.max << "." << std::endl;
+}
+
+
+// Show how many meshes were drawn and culled this frame in the window title, with the last frame statistics.
+// The title only changes when one of them does.
+void ReportCulling()
+{
+	uint drawn = visibleMeshes.size();
+	uint culled = meshes.size() - drawn;
+	std::string frameSummary = frameStatistics.getSummary();
+	if (drawn == lastDrawn && culled == lastCulled && frameSummary == lastFrameSummary)
+	{
+		return;
+	}
+	lastDrawn = drawn;
+	lastCulled = culled;
+	lastFrameSummary = frameSummary;
+
+	char title[256];
+	snprintf(title, sizeof(title), "Computer Graphics Renderer - %u drawn, %u culled", drawn, culled);
+	std::string text = title;
+	if (!frameSummary.empty())
+	{
+		text += " - " + frameSummary;
+	}
+	glutSetWindowTitle(text.c_str());
 }
 
 
-// Call when GLUT has nothing else to do - good for animation parameters.
+// Called by FrameScheduler before every animated frame - good for animation parameters.
 void Animate()
 {
-	const int animationCycleMilliseconds = 10000;
 	int ms = glutGet(GLUT_ELAPSED_TIME); // In milliseconds.
 	ms %= MS_IN_THE_ANIMATION_CYCLE;
 	currentTime = (float)ms / (float)MS_IN_THE_ANIMATION_CYCLE; // [0, 1).
-
-	glutSetWindow( mainWindow );
-	glutPostRedisplay( );
 }
 
 
@@ -462,6 +858,22 @@ void DoMainMenu(int id)
 			// gracefully close the graphics window:
 			// gracefully exit the program:
 			glutSetWindow( mainWindow );
+			for (int i = 0; i < meshes.size(); ++i)
+			{
+				Loader::ReleaseMesh(meshes[i]);
+			}
+			Loader::CleanUp();
+			TextureLoader::CleanUp();
+			batchRenderer.CleanUp();
+			frameUniforms.CleanUp();
+			shadowMap.CleanUp();
+			frameStatistics.CleanUp();
+			scalarField.CleanUp();
+			delete(model);
+			if (Profiler::IsEnabled())
+			{
+				Profiler::WriteTrace(tracePath);
+			}
 			glFinish( );
 			glutDestroyWindow( mainWindow );
 			exit( 0 );
@@ -471,13 +883,13 @@ void DoMainMenu(int id)
 			fprintf( stderr, "Don't know what to do with Main Menu ID %d\n", id );
 	}
 
-	glutSetWindow( mainWindow );
-	glutPostRedisplay( );
+	FrameScheduler::RequestRedraw();
 }
 
 void DoWireframeMenu(int id)
 {
 	enableWireframe = id;
+	FrameScheduler::RequestRedraw();
 }
 
 void InitMenus()
@@ -549,16 +961,63 @@ void Keyboard(unsigned char c, int x, int y)
 
 		case 'f':
 			animate = !animate;
-			if (animate)
-				glutIdleFunc(Animate);
+			FrameScheduler::SetAnimating(animate);
+			break;
+
+		case 'b':
+			enableBatching = !enableBatching;
+			frameStatistics.Reset();
+			if (enableBatching)
+				std::cout << "Batched drawing on." << std::endl;
+			else
+				std::cout << "Batched drawing off." << std::endl;
+			break;
+
+		case 'e':
+			SculptSelection();
+			break;
+
+		case 'm':
+			// Cycle through the metrics, then the vertex colors.
+			activeField++;
+			if (activeField >= scalarField.getFieldCount())
+				activeField = -1;
+			PrintActiveField();
+			break;
+
+		case 'v':
+			enableCulling = !enableCulling;
+			if (enableCulling)
+				std::cout << "Frustum culling on." << std::endl;
 			else
-				glutIdleFunc(NULL);
+				std::cout << "Frustum culling off." << std::endl;
 			break;
 
 		case 'q':
 			DoMainMenu(1);	// will not return here
 			break;				// happy compiler
 
+		case 'x':
+			ExportMeshes();
+			break;
+
+		case 'p':
+			// Startup and every frame so far; open in chrome://tracing or ui.perfetto.dev.
+			Profiler::WriteTrace(tracePath);
+			break;
+
+		case 'i':
+			FrameScheduler::PrintStatistics();
+			break;
+
+		case 'k':
+			ReportMemory("now");
+			break;
+
+		case 'o':
+			frameStatistics.ToggleRecording(frameStatisticsPath);
+			break;
+
 		case 't':
 			selectTriangle = !selectTriangle;
 			if (selectTriangle)
@@ -572,8 +1031,7 @@ void Keyboard(unsigned char c, int x, int y)
 	}
 
 	// Force a call to Display( ):
-	glutSetWindow( mainWindow );
-	glutPostRedisplay( );
+	FrameScheduler::RequestRedraw();
 }
 
 void InfoDumpSelectedTriangle(uint meshIndex, uint triangleIndex, uint v0, uint v1, uint v2)
@@ -607,7 +1065,7 @@ void SetHighlight(uint meshID, uint triangleIndex, glm::vec4 color)
 	uint v0 = mesh.getTriangles()[triangleIndex + 0];
 	uint v1 = mesh.getTriangles()[triangleIndex + 1];
 	uint v2 = mesh.getTriangles()[triangleIndex + 2];
-	Loader::UpdateHighlight(mesh.getVBO(), v0, v1, v2, color);
+	Loader::UpdateHighlight(mesh, v0, v1, v2, color);
 	InfoDumpSelectedTriangle(meshID, triangleIndex, v0, v1, v2);
 }
 
@@ -653,7 +1111,11 @@ void MouseRayTriangleIntersection(glm::vec3& ray)
 		}
 	}
 	if (meshIndex > -1 && index > -1)
+	{
 		SetHighlight(meshIndex, index, glm::vec4(1.0f, 215.0f / 255.0f, 0.0f, 1.0f));
+		if (meshIndex == 0)
+			selectedTriangle = index / 3;
+	}
 	/*
 	if (index == -1)
 	{
@@ -735,8 +1197,7 @@ void MouseButton(int button, int state, int x, int y)
 		MouseRayTriangleIntersection(ray);
 	}
 
-	glutSetWindow(mainWindow);
-	glutPostRedisplay();
+	FrameScheduler::RequestRedraw();
 
 }
 
@@ -779,8 +1240,7 @@ void MouseMotion(int x, int y)
 	mouseX = x;			// new current position
 	mouseY = y;
 
-	glutSetWindow( mainWindow );
-	glutPostRedisplay( );
+	FrameScheduler::RequestRedraw();
 }
 
 
@@ -799,28 +1259,27 @@ void Reset()
 }
 
 
+// Create the shadow map. The scene is drawn into it on the next frame.
+void InitializeShadows(int width, int height)
+{
+	shadowMap.Initialize(width, height);
+}
+
+
 // When the window is resized.
 void Resize(int width, int height)
 {
 	// Don't really need to do anything since window size is checked each frame in Display().
 
-	glutSetWindow(mainWindow);
-	glutPostRedisplay();
+	FrameScheduler::RequestRedraw();
 }
 
 
 // When the visibility of the window is changed.
 void Visibility(int state)
 {
-	if( state == GLUT_VISIBLE )
-	{
-		glutSetWindow( mainWindow );
-		glutPostRedisplay( );
-	}
-	else
-	{
-		// Could optimize by keeping track of the fact that the window is not visible and avoid animating/redrawing.
-	}
+	// Nothing is drawn or animated while the window cannot be seen.
+	FrameScheduler::SetVisible(state == GLUT_VISIBLE);
 }
 
 
@@ -832,155 +1291,8 @@ void Visibility(int state)
 /*********************************** FILE IO ***********************************/
 /*******************************************************************************/
 /*******************************************************************************/
-void InitializeTexture(char* file, int width, int height)
-{
-	// Load a texture from file:
-	unsigned char* texture;
-	texture = BmpToTexture(file, &width, &height);
-
-	glGenTextures(1, &textureHandle);
-	glBindTexture(GL_TEXTURE_2D, textureHandle);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, texture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-}
-
-struct bmfh
-{
-	short bfType;
-	int bfSize;
-	short bfReserved1;
-	short bfReserved2;
-	int bfOffBits;
-} FileHeader;
-
-struct bmih
-{
-	int biSize;
-	int biWidth;
-	int biHeight;
-	short biPlanes;
-	short biBitCount;
-	int biCompression;
-	int biSizeImage;
-	int biXPelsPerMeter;
-	int biYPelsPerMeter;
-	int biClrUsed;
-	int biClrImportant;
-} InfoHeader;
-
-const int birgb = { 0 };
-
-// Read a BMP file into a Texture:
-unsigned char* BmpToTexture(char *filename, int* width, int* height)
-{
-	FILE *fp = fopen( filename, "rb" );
-	if( fp == NULL )
-	{
-		fprintf( stderr, "Cannot open Bmp file '%s'\n", filename );
-		return NULL;
-	}
-
-	FileHeader.bfType = ReadShort( fp );
-
-
-	// if bfType is not 0x4d42, the file is not a bmp:
-
-	if( FileHeader.bfType != 0x4d42 )
-	{
-		fprintf( stderr, "File '%s' is the wrong type of file: 0x%0x\n", filename, FileHeader.bfType );
-		fclose( fp );
-		return NULL;
-	}
-
-	FileHeader.bfSize = ReadInt( fp );
-	FileHeader.bfReserved1 = ReadShort( fp );
-	FileHeader.bfReserved2 = ReadShort( fp );
-	FileHeader.bfOffBits = ReadInt( fp );
-
-	InfoHeader.biSize = ReadInt( fp );
-	InfoHeader.biWidth = ReadInt( fp );
-	InfoHeader.biHeight = ReadInt( fp );
-
-	int nums = InfoHeader.biWidth;
-	int numt = InfoHeader.biHeight;
-
-	InfoHeader.biPlanes = ReadShort( fp );
-	InfoHeader.biBitCount = ReadShort( fp );
-	InfoHeader.biCompression = ReadInt( fp );
-	InfoHeader.biSizeImage = ReadInt( fp );
-	InfoHeader.biXPelsPerMeter = ReadInt( fp );
-	InfoHeader.biYPelsPerMeter = ReadInt( fp );
-	InfoHeader.biClrUsed = ReadInt( fp );
-	InfoHeader.biClrImportant = ReadInt( fp );
-
-	fprintf( stderr, "Image size in file '%s' is: %d x %d\n", filename, nums, numt );
-
-	unsigned char * texture = new unsigned char[ 3 * nums * numt ];
-	if( texture == NULL )
-	{
-		fprintf( stderr, "Cannot allocate the texture array!\b" );
-		return NULL;
-	}
-
-	// extra padding bytes:
-
-	int numextra =  4*(( (3*InfoHeader.biWidth)+3)/4) - 3*InfoHeader.biWidth;
-
-	// we do not support compression:
-
-	if( InfoHeader.biCompression != birgb )
-	{
-		fprintf( stderr, "Image file '%s' has the wrong type of image compression: %d\n", filename, InfoHeader.biCompression );
-		fclose( fp );
-		return NULL;
-	}
-
-	rewind( fp );
-	fseek( fp, 14+40, SEEK_SET );
-
-	if( InfoHeader.biBitCount == 24 )
-	{
-		unsigned char *tp = texture;
-		for( int t = 0; t < numt; t++ )
-		{
-			for( int s = 0; s < nums; s++, tp += 3 )
-			{
-				*(tp+2) = fgetc( fp );		// b
-				*(tp+1) = fgetc( fp );		// g
-				*(tp+0) = fgetc( fp );		// r
-			}
-
-			for( int e = 0; e < numextra; e++ )
-			{
-				fgetc( fp );
-			}
-		}
-	}
-
-	fclose( fp );
-
-	*width = nums;
-	*height = numt;
-	return texture;
-}
-
-int ReadInt(FILE* fp)
-{
-	unsigned char b3, b2, b1, b0;
-	b0 = fgetc( fp );
-	b1 = fgetc( fp );
-	b2 = fgetc( fp );
-	b3 = fgetc( fp );
-	return ( b3 << 24 )  |  ( b2 << 16 )  |  ( b1 << 8 )  |  b0;
-}
-
-short ReadShort(FILE* fp)
+void InitializeTexture(std::string file)
 {
-	unsigned char b1, b0;
-	b0 = fgetc( fp );
-	b1 = fgetc( fp );
-	return ( b1 << 8 )  |  b0;
+	// Load a texture from a .bmp or .ppm file. Loaded textures and their mipmaps are cached by TextureLoader.
+	textureHandle = TextureLoader::Load(file);
 }
@@ -0,0 +1,275 @@
+#include "memoryreport.hpp"
+#include "polyhedron.hpp"
+#include "meshcomponent.hpp"
+#include "meshanalysis.hpp"
+
+MemoryReport::MemoryReport(std::string title) : title(title) {}
+MemoryReport::~MemoryReport() {}
+
+void MemoryReport::Add(const std::string& subsystem, const std::string& name, size_t count, size_t bytes)
+{
+	entries.push_back({subsystem, name, count, bytes});
+}
+
+void MemoryReport::AddPolyhedron(const std::string& subsystem, Polyhedron* p)
+{
+	AddChunkedArray(subsystem, "vlist", p->vlist);
+	AddChunkedArray(subsystem, "elist", p->elist);
+	AddChunkedArray(subsystem, "tlist", p->tlist);
+	AddChunkedArray(subsystem, "clist", p->clist);
+
+	// Vert::triangles are spans into one array; Edge::triangles are vectors of their own.
+	AddVector(subsystem, "Vert::triangles", p->vertexTriangles);
+	size_t edgeTriangles = 0;
+	size_t edgeTriangleBytes = 0;
+	for (int i = 0; i < p->elist.size(); ++i)
+	{
+		edgeTriangles += p->elist[i].triangles.size();
+		edgeTriangleBytes += p->elist[i].triangles.capacity() * sizeof(Triangle*);
+	}
+	Add(subsystem, "Edge::triangles", edgeTriangles, edgeTriangleBytes);
+
+	AddVector(subsystem, "dirty vertices", p->dirtyVertices);
+	Add(subsystem, "dirty flags", p->isDirty.size(), p->isDirty.capacity() / 8);
+}
+
+void MemoryReport::AddMeshComponents(const std::string& subsystem, std::vector<MeshComponent>& meshes)
+{
+	size_t vertices = 0;
+	size_t vertexBytes = 0;
+	size_t indices = 0;
+	size_t indexBytes = 0;
+	for (int i = 0; i < meshes.size(); ++i)
+	{
+		vertices += meshes[i].getVertices().size();
+		vertexBytes += meshes[i].getVertices().capacity() * sizeof(Vertex);
+		indices += meshes[i].getTriangles().size();
+		indexBytes += meshes[i].getTriangles().capacity() * sizeof(uint);
+	}
+	Add(subsystem, "MeshComponent", meshes.size(), meshes.capacity() * sizeof(MeshComponent));
+	Add(subsystem, "MeshComponent::vertices", vertices, vertexBytes);
+	Add(subsystem, "MeshComponent::triangles", indices, indexBytes);
+}
+
+void MemoryReport::AddMeshComponent(const std::string& subsystem, MeshComponent& mesh)
+{
+	AddVector(subsystem, "MeshComponent::vertices", mesh.getVertices());
+	AddVector(subsystem, "MeshComponent::triangles", mesh.getTriangles());
+}
+
+void MemoryReport::AddTriangleMetrics(const std::string& subsystem, TriangleMetrics& metrics)
+{
+	AddVector(subsystem, "horizon area", metrics.horizonArea);
+	AddVector(subsystem, "perimeter", metrics.perimeter);
+	AddVector(subsystem, "area", metrics.area);
+	AddVector(subsystem, "spherical area", metrics.sphericalArea);
+}
+
+size_t MemoryReport::GetTotal()
+{
+	size_t total = 0;
+	for (int i = 0; i < entries.size(); ++i)
+	{
+		total += entries[i].bytes;
+	}
+	return total;
+}
+
+size_t MemoryReport::GetTotal(const std::string& subsystem)
+{
+	size_t total = 0;
+	for (int i = 0; i < entries.size(); ++i)
+	{
+		if (entries[i].subsystem == subsystem)
+		{
+			total += entries[i].bytes;
+		}
+	}
+	return total;
+}
+
+void MemoryReport::Print(std::ostream& out)
+{
+	out << "***** MEMORY: " << title << " *****" << std::endl;
+
+	// Subsystems in the order they were first added, each followed by its total.
+	std::vector<std::string> subsystems;
+	for (int i = 0; i < entries.size(); ++i)
+	{
+		if (std::find(subsystems.begin(), subsystems.end(), entries[i].subsystem) == subsystems.end())
+		{
+			subsystems.push_back(entries[i].subsystem);
+		}
+	}
+
+	char line[256];
+	for (int s = 0; s < subsystems.size(); ++s)
+	{
+		for (int i = 0; i < entries.size(); ++i)
+		{
+			MemoryEntry& entry = entries[i];
+			if (entry.subsystem != subsystems[s])
+			{
+				continue;
+			}
+			snprintf(line, sizeof(line), "  %-12s %-28s %12zu %12s", entry.subsystem.c_str(), entry.name.c_str(), entry.count, FormatBytes(entry.bytes).c_str());
+			out << line << std::endl;
+		}
+		snprintf(line, sizeof(line), "  %-12s %-28s %12s %12s", subsystems[s].c_str(), "total", "", FormatBytes(GetTotal(subsystems[s])).c_str());
+		out << line << std::endl;
+	}
+	snprintf(line, sizeof(line), "  %-41s %12s %12s", "Total", "", FormatBytes(GetTotal()).c_str());
+	out << line << std::endl;
+
+	if (MemoryTracker::IsEnabled())
+	{
+		out << "  Heap: " << MemoryTracker::GetAllocations() << " allocations, " << MemoryTracker::GetFrees() << " frees, "
+			<< FormatBytes(MemoryTracker::GetLiveBytes()) << " live, " << FormatBytes(MemoryTracker::GetPeakBytes()) << " peak." << std::endl;
+	}
+}
+
+std::string MemoryReport::FormatBytes(size_t bytes)
+{
+	const char* units[] = {"B", "KB", "MB", "GB", "TB"};
+	double value = bytes;
+	int unit = 0;
+	while (value >= 1024.0 && unit < 4)
+	{
+		value /= 1024.0;
+		unit++;
+	}
+	char text[32];
+	snprintf(text, sizeof(text), (unit == 0) ? "%.0f %s" : "%.1f %s", value, units[unit]);
+	return text;
+}
+
+
+std::atomic<uint64_t> MemoryTracker::allocations(0);
+std::atomic<uint64_t> MemoryTracker::frees(0);
+std::atomic<size_t> MemoryTracker::liveBytes(0);
+std::atomic<size_t> MemoryTracker::peakBytes(0);
+
+bool MemoryTracker::IsEnabled()
+{
+#ifdef ENABLE_MEMORY_TRACKING
+	return true;
+#else
+	return false;
+#endif
+}
+
+uint64_t MemoryTracker::GetAllocations()
+{
+	return allocations.load(std::memory_order_relaxed);
+}
+
+uint64_t MemoryTracker::GetFrees()
+{
+	return frees.load(std::memory_order_relaxed);
+}
+
+size_t MemoryTracker::GetLiveBytes()
+{
+	return liveBytes.load(std::memory_order_relaxed);
+}
+
+size_t MemoryTracker::GetPeakBytes()
+{
+	return peakBytes.load(std::memory_order_relaxed);
+}
+
+void MemoryTracker::ResetPeak()
+{
+	peakBytes.store(liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void* MemoryTracker::Allocate(size_t size)
+{
+	unsigned char* block = (unsigned char*)malloc(size + HEADER_SIZE);
+	if (block == NULL)
+	{
+		return NULL;
+	}
+	*(size_t*)block = size;
+
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	size_t live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+	size_t peak = peakBytes.load(std::memory_order_relaxed);
+	while (live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed));
+	return block + HEADER_SIZE;
+}
+
+void MemoryTracker::Free(void* pointer)
+{
+	if (pointer == NULL)
+	{
+		return;
+	}
+	unsigned char* block = (unsigned char*)pointer - HEADER_SIZE;
+	frees.fetch_add(1, std::memory_order_relaxed);
+	liveBytes.fetch_sub(*(size_t*)block, std::memory_order_relaxed);
+	free(block);
+}
+
+
+#ifdef ENABLE_MEMORY_TRACKING
+
+// Replacements for the global operator new and delete, so every allocation of the program goes through the tracker.
+// Over-aligned types still use the default aligned versions, and are not counted.
+
+void* operator new(size_t size)
+{
+	void* pointer = MemoryTracker::Allocate(size);
+	if (pointer == NULL)
+	{
+		throw std::bad_alloc();
+	}
+	return pointer;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return MemoryTracker::Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return MemoryTracker::Allocate(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+	MemoryTracker::Free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+	MemoryTracker::Free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+	MemoryTracker::Free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+	MemoryTracker::Free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+	MemoryTracker::Free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+	MemoryTracker::Free(pointer);
+}
+
+#endif
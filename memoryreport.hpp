@@ -0,0 +1,122 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+
+#include "utilities.hpp"
+#include "chunkedarray.hpp"
+
+class Polyhedron;
+class MeshComponent;
+struct TriangleMetrics;
+
+/** Memory accounting: how many bytes each container holds, grouped by subsystem.
+ *
+ * A MemoryReport is filled with the containers of interest and printed as a table, e.g. after every stage of the pipeline.
+ * Containers are counted by capacity, since that is what they hold on to, not by size.
+ *
+ * Heap allocations of the whole program are counted by MemoryTracker, in builds with -DENABLE_MEMORY_TRACKING
+ * (make CPPFLAGS=-DENABLE_MEMORY_TRACKING). Otherwise the tracker reports nothing and costs nothing. */
+
+// One container in a report.
+struct MemoryEntry
+{
+	std::string subsystem;
+	std::string name;
+	size_t count; // Elements in use.
+	size_t bytes; // Bytes held.
+};
+
+class MemoryReport
+{
+
+public:
+
+	MemoryReport(std::string title);
+	~MemoryReport();
+
+	// Any other memory, e.g. GPU buffers and textures, which only the code that owns the OpenGL context can measure.
+	void Add(const std::string& subsystem, const std::string& name, size_t count, size_t bytes);
+
+	template <typename T>
+	void AddVector(const std::string& subsystem, const std::string& name, const std::vector<T>& v)
+	{
+		Add(subsystem, name, v.size(), v.capacity() * sizeof(T));
+	}
+
+	template <typename T, int CHUNK_BITS>
+	void AddChunkedArray(const std::string& subsystem, const std::string& name, const ChunkedArray<T, CHUNK_BITS>& a)
+	{
+		// The chunk pointers are a few bytes per chunk; the chunks are the rest.
+		size_t chunks = a.capacity() / ChunkedArray<T, CHUNK_BITS>::CHUNK_SIZE;
+		Add(subsystem, name, a.size(), a.capacity() * sizeof(T) + chunks * sizeof(T*));
+	}
+
+	// The element lists of a polyhedron, and the arrays hanging off its elements.
+	void AddPolyhedron(const std::string& subsystem, Polyhedron* p);
+
+	// The CPU copy of the vertices and triangles of meshes. Their GPU copy lives in GPUMemory.
+	void AddMeshComponents(const std::string& subsystem, std::vector<MeshComponent>& meshes);
+	void AddMeshComponent(const std::string& subsystem, MeshComponent& mesh);
+
+	void AddTriangleMetrics(const std::string& subsystem, TriangleMetrics& metrics);
+
+	// Total bytes of every entry, or of one subsystem.
+	size_t GetTotal();
+	size_t GetTotal(const std::string& subsystem);
+
+	// Print every entry, a total per subsystem, and the heap counters if they are tracked.
+	void Print(std::ostream& out = std::cout);
+
+	// e.g. "12.3 MB".
+	static std::string FormatBytes(size_t bytes);
+
+private:
+
+	std::string title;
+	std::vector<MemoryEntry> entries;
+
+};
+
+/** Static class with counters of every heap allocation, kept by the replacement operator new and delete in memoryreport.cpp. */
+class MemoryTracker
+{
+
+public:
+
+	// Whether the counters are kept in this build.
+	static bool IsEnabled();
+
+	static uint64_t GetAllocations();
+	static uint64_t GetFrees();
+	static size_t GetLiveBytes();
+	static size_t GetPeakBytes();
+
+	// Start measuring the peak again from the bytes live now, e.g. at the start of a pipeline stage.
+	static void ResetPeak();
+
+	// Called by operator new and delete only.
+	static void* Allocate(size_t size);
+	static void Free(void* pointer);
+
+private:
+
+	MemoryTracker();
+	~MemoryTracker();
+
+	static std::atomic<uint64_t> allocations;
+	static std::atomic<uint64_t> frees;
+	static std::atomic<size_t> liveBytes;
+	static std::atomic<size_t> peakBytes;
+
+	// Every block starts with its size, padded so the memory after it keeps the alignment of malloc().
+	static const size_t HEADER_SIZE = alignof(std::max_align_t);
+
+};
@@ -4,43 +4,199 @@
 MeshAnalysis::MeshAnalysis() {}
 MeshAnalysis::~MeshAnalysis() {}
 
-std::vector<double> MeshAnalysis::GetApproximateGaussianCurvatures(std::vector<Triangle>& triangles)
+std::vector<double> MeshAnalysis::GetApproximateGaussianCurvatures(ChunkedArray<Triangle>& triangles)
 {
+	PROFILE_SCOPE("MeshAnalysis::GetApproximateGaussianCurvatures");
+	TriangleMetrics metrics = ComputeTriangleMetrics(triangles);
 	std::vector<double> gaussianCurvatures(triangles.size());
 	for (int i = 0; i < triangles.size(); ++i)
 	{
-		gaussianCurvatures[i] = ComputeApproximateGaussianCurvature(triangles[i]);
+		gaussianCurvatures[i] = metrics.sphericalArea[i] / metrics.area[i];
 	}
 	return gaussianCurvatures;
 }
-std::vector<double> MeshAnalysis::GetHorizonMeasuresDouble(std::vector<Triangle>& triangles)
+std::vector<double> MeshAnalysis::GetHorizonMeasuresDouble(ChunkedArray<Triangle>& triangles)
 {
+	PROFILE_SCOPE("MeshAnalysis::GetHorizonMeasuresDouble");
+	TriangleMetrics metrics = ComputeTriangleMetrics(triangles);
 	std::vector<double> horizonMeasures(triangles.size());
 	for (int i = 0; i < triangles.size(); ++i)
 	{
-		horizonMeasures[i] = ComputeHorizonMeasureDouble(triangles[i]);
+		horizonMeasures[i] = metrics.horizonArea[i] / metrics.perimeter[i];
 	}
 	return horizonMeasures;
 }
-std::vector<double> MeshAnalysis::GetOriginalHorizonMeasuresDouble(std::vector<Triangle>& triangles)
+std::vector<double> MeshAnalysis::GetOriginalHorizonMeasuresDouble(ChunkedArray<Triangle>& triangles)
 {
+	TriangleMetrics metrics = ComputeTriangleMetrics(triangles);
 	std::vector<double> horizonMeasures(triangles.size());
 	for (int i = 0; i < triangles.size(); ++i)
 	{
-		horizonMeasures[i] = ComputeOriginalHorizonMeasureDouble(triangles[i]);
+		horizonMeasures[i] = metrics.horizonArea[i] / metrics.area[i];
 	}
 	return horizonMeasures;
 }
-std::vector<float> MeshAnalysis::GetHorizonMeasures(std::vector<Triangle>& triangles)
+std::vector<float> MeshAnalysis::GetHorizonMeasures(ChunkedArray<Triangle>& triangles)
 {
+	TriangleMetrics metrics = ComputeTriangleMetrics(triangles);
 	std::vector<float> horizonMeasures(triangles.size());
 	for (int i = 0; i < triangles.size(); ++i)
 	{
-		horizonMeasures[i] = ComputeHorizonMeasure(triangles[i]);
+		horizonMeasures[i] = (float)(metrics.horizonArea[i] / metrics.perimeter[i]);
 	}
 	return horizonMeasures;
 }
 
+TriangleMetrics MeshAnalysis::ComputeTriangleMetrics(ChunkedArray<Triangle>& triangles)
+{
+	PROFILE_SCOPE("MeshAnalysis::ComputeTriangleMetrics");
+	TriangleMetrics metrics;
+	metrics.horizonArea.resize(triangles.size());
+	metrics.perimeter.resize(triangles.size());
+	metrics.area.resize(triangles.size());
+	metrics.sphericalArea.resize(triangles.size());
+
+	Parallel::For(0, triangles.size(), METRICS_BLOCK_SIZE, [&](int begin, int end)
+	{
+		ComputeTriangleMetricsBlock(triangles, nullptr, metrics, begin, end);
+	});
+	return metrics;
+}
+
+void MeshAnalysis::UpdateTriangleMetrics(ChunkedArray<Triangle>& triangles, const std::vector<int>& indices, TriangleMetrics& metrics)
+{
+	PROFILE_SCOPE("MeshAnalysis::UpdateTriangleMetrics");
+	Parallel::For(0, indices.size(), METRICS_BLOCK_SIZE, [&](int begin, int end)
+	{
+		ComputeTriangleMetricsBlock(triangles, indices.data(), metrics, begin, end);
+	});
+}
+
+void MeshAnalysis::ComputeTriangleMetricsBlock(ChunkedArray<Triangle>& triangles, const int* indices, TriangleMetrics& metrics, int begin, int end)
+{
+	// Gather positions and normals of the block into flat arrays: [vertex of the triangle][triangle in the block].
+	int count = end - begin;
+	double px[3][METRICS_BLOCK_SIZE], py[3][METRICS_BLOCK_SIZE], pz[3][METRICS_BLOCK_SIZE];
+	double nx[3][METRICS_BLOCK_SIZE], ny[3][METRICS_BLOCK_SIZE], nz[3][METRICS_BLOCK_SIZE];
+	for (int i = 0; i < count; ++i)
+	{
+		Triangle& t = triangles[indices ? indices[begin + i] : begin + i];
+		for (int j = 0; j < 3; ++j)
+		{
+			Vert* v = t.vertices[j];
+			px[j][i] = v->x;
+			py[j][i] = v->y;
+			pz[j][i] = v->z;
+			nx[j][i] = v->normal.x;
+			ny[j][i] = v->normal.y;
+			nz[j][i] = v->normal.z;
+		}
+	}
+
+	// Write straight into the metrics for a contiguous range; otherwise into the block, to be scattered at the end.
+	double blockHorizonArea[METRICS_BLOCK_SIZE], blockPerimeter[METRICS_BLOCK_SIZE], blockArea[METRICS_BLOCK_SIZE], blockSphericalArea[METRICS_BLOCK_SIZE];
+	double* horizonArea = indices ? blockHorizonArea : &metrics.horizonArea[begin];
+	double* perimeter = indices ? blockPerimeter : &metrics.perimeter[begin];
+	double* area = indices ? blockArea : &metrics.area[begin];
+	double* sphericalArea = indices ? blockSphericalArea : &metrics.sphericalArea[begin];
+
+	int i = 0;
+
+#ifdef FASTMATH_USE_SSE2
+	const __m128d one = _mm_set1_pd(1.0);
+	const __m128d minusOne = _mm_set1_pd(-1.0);
+	auto load = [](double* a, int i) { return _mm_loadu_pd(a + i); };
+	auto add = [](__m128d a, __m128d b) { return _mm_add_pd(a, b); };
+	auto sub = [](__m128d a, __m128d b) { return _mm_sub_pd(a, b); };
+	auto mul = [](__m128d a, __m128d b) { return _mm_mul_pd(a, b); };
+	auto dot = [&](__m128d ax, __m128d ay, __m128d az, __m128d bx, __m128d by, __m128d bz)
+	{
+		return add(add(mul(ax, bx), mul(ay, by)), mul(az, bz));
+	};
+
+	for (; i + 2 <= count; i += 2)
+	{
+		__m128d x0 = load(px[0], i), y0 = load(py[0], i), z0 = load(pz[0], i);
+		__m128d x1 = load(px[1], i), y1 = load(py[1], i), z1 = load(pz[1], i);
+		__m128d x2 = load(px[2], i), y2 = load(py[2], i), z2 = load(pz[2], i);
+
+		// Perimeter:
+		__m128d ax = sub(x1, x0), ay = sub(y1, y0), az = sub(z1, z0);
+		__m128d bx = sub(x2, x1), by = sub(y2, y1), bz = sub(z2, z1);
+		__m128d cx = sub(x0, x2), cy = sub(y0, y2), cz = sub(z0, z2);
+		__m128d lengths = add(add(_mm_sqrt_pd(dot(ax, ay, az, ax, ay, az)), _mm_sqrt_pd(dot(bx, by, bz, bx, by, bz))),
+							  _mm_sqrt_pd(dot(cx, cy, cz, cx, cy, cz)));
+		_mm_storeu_pd(perimeter + i, lengths);
+
+		// Area: half the length of (p1 - p0) x (p0 - p2), which is the same as (p1 - p0) x (p2 - p0) up to sign.
+		__m128d crossX = sub(mul(ay, cz), mul(az, cy));
+		__m128d crossY = sub(mul(az, cx), mul(ax, cz));
+		__m128d crossZ = sub(mul(ax, cy), mul(ay, cx));
+		_mm_storeu_pd(area + i, mul(_mm_set1_pd(0.5), _mm_sqrt_pd(dot(crossX, crossY, crossZ, crossX, crossY, crossZ))));
+
+		// Horizon area from the angles between the normals:
+		__m128d mx0 = load(nx[0], i), my0 = load(ny[0], i), mz0 = load(nz[0], i);
+		__m128d mx1 = load(nx[1], i), my1 = load(ny[1], i), mz1 = load(nz[1], i);
+		__m128d mx2 = load(nx[2], i), my2 = load(ny[2], i), mz2 = load(nz[2], i);
+		__m128d d01 = dot(mx0, my0, mz0, mx1, my1, mz1);
+		__m128d d12 = dot(mx1, my1, mz1, mx2, my2, mz2);
+		__m128d d20 = dot(mx2, my2, mz2, mx0, my0, mz0);
+		__m128d angles = add(add(FastMath::Acos(_mm_min_pd(_mm_max_pd(d01, minusOne), one)),
+								 FastMath::Acos(_mm_min_pd(_mm_max_pd(d12, minusOne), one))),
+							 FastMath::Acos(_mm_min_pd(_mm_max_pd(d20, minusOne), one)));
+		_mm_storeu_pd(horizonArea + i, mul(_mm_set1_pd(2.0), angles));
+
+		// Spherical area (Van Oosterom and Strackee):
+		// tan(E / 2) = |n0 . (n1 x n2)| / (|n0||n1||n2| + (n0 . n1)|n2| + (n1 . n2)|n0| + (n2 . n0)|n1|)
+		__m128d l0 = _mm_sqrt_pd(dot(mx0, my0, mz0, mx0, my0, mz0));
+		__m128d l1 = _mm_sqrt_pd(dot(mx1, my1, mz1, mx1, my1, mz1));
+		__m128d l2 = _mm_sqrt_pd(dot(mx2, my2, mz2, mx2, my2, mz2));
+		__m128d triple = dot(mx0, my0, mz0, sub(mul(my1, mz2), mul(mz1, my2)), sub(mul(mz1, mx2), mul(mx1, mz2)), sub(mul(mx1, my2), mul(my1, mx2)));
+		triple = _mm_andnot_pd(_mm_set1_pd(-0.0), triple);
+		__m128d denominator = add(add(mul(mul(l0, l1), l2), mul(d01, l2)), add(mul(d12, l0), mul(d20, l1)));
+		_mm_storeu_pd(sphericalArea + i, mul(_mm_set1_pd(2.0), FastMath::Atan2(triple, denominator)));
+	}
+#endif
+
+	// Whatever is left over, or everything without SSE2. Same arithmetic as above.
+	for (; i < count; ++i)
+	{
+		glm::dvec3 p0 = glm::dvec3(px[0][i], py[0][i], pz[0][i]);
+		glm::dvec3 p1 = glm::dvec3(px[1][i], py[1][i], pz[1][i]);
+		glm::dvec3 p2 = glm::dvec3(px[2][i], py[2][i], pz[2][i]);
+		glm::dvec3 n0 = glm::dvec3(nx[0][i], ny[0][i], nz[0][i]);
+		glm::dvec3 n1 = glm::dvec3(nx[1][i], ny[1][i], nz[1][i]);
+		glm::dvec3 n2 = glm::dvec3(nx[2][i], ny[2][i], nz[2][i]);
+
+		perimeter[i] = glm::length(p1 - p0) + glm::length(p2 - p1) + glm::length(p0 - p2);
+		area[i] = 0.5 * glm::length(glm::cross(p1 - p0, p2 - p0));
+
+		double d01 = glm::dot(n0, n1);
+		double d12 = glm::dot(n1, n2);
+		double d20 = glm::dot(n2, n0);
+		horizonArea[i] = 2.0 * (FastMath::Acos(glm::clamp(d01, -1.0, 1.0)) + FastMath::Acos(glm::clamp(d12, -1.0, 1.0)) + FastMath::Acos(glm::clamp(d20, -1.0, 1.0)));
+
+		double l0 = glm::length(n0);
+		double l1 = glm::length(n1);
+		double l2 = glm::length(n2);
+		double triple = std::abs(glm::dot(n0, glm::cross(n1, n2)));
+		double denominator = l0 * l1 * l2 + d01 * l2 + d12 * l0 + d20 * l1;
+		sphericalArea[i] = 2.0 * FastMath::Atan2(triple, denominator);
+	}
+
+	if (indices)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			int t = indices[begin + i];
+			metrics.horizonArea[t] = horizonArea[i];
+			metrics.perimeter[t] = perimeter[i];
+			metrics.area[t] = area[i];
+			metrics.sphericalArea[t] = sphericalArea[i];
+		}
+	}
+}
+
 
 float MeshAnalysis::ComputeHorizonMeasure(Vertex& v0, Vertex& v1, Vertex& v2)
 {
@@ -213,114 +369,119 @@ float MeshAnalysis::ComputePerimeter(Triangle& t)
 
 void MeshAnalysis::GetCornerList(Polyhedron* p)
 {
-	std::vector<Triangle>& tlist = p->tlist;
+	PROFILE_SCOPE("MeshAnalysis::GetCornerList");
+	ChunkedArray<Triangle>& tlist = p->tlist;
 	int numTriangles = tlist.size();
-	std::vector<Corner>& corners = p->clist;
+	ChunkedArray<Corner>& corners = p->clist;
 
 	// Analyze one triangle at a time.
-	int cornerIndex = 0;
-	for (int i = 0; i < numTriangles; ++i)
+	// Every triangle only writes its own three corners, so blocks of triangles can be done in parallel.
+	Parallel::For(0, numTriangles, CORNER_GRAIN, [&](int begin, int end)
 	{
-		// Get the triangle and its vertices.
-		Triangle& t = tlist[i];
-		Vert* v1 = t.vertices[0];
-		Vert* v2 = t.vertices[1];
-		Vert* v3 = t.vertices[2];
-
-		// Corners.
-		Corner& c1 = corners[cornerIndex];
-		c1.index = cornerIndex;
-		Corner& c2 = corners[cornerIndex + 1];
-		c2.index = cornerIndex + 1;
-		Corner& c3 = corners[cornerIndex + 2];
-		c3.index = cornerIndex + 2;
-		 
-		// Triangle: c.t.
-		c1.t = &t;
-		c2.t = &t;
-		c3.t = &t;
-
-		// Vertex: c.v.
-		c1.v = v1;
-		c2.v = v2;
-		c3.v = v3;
-
-		// Next: c.n.
-		c1.n = &c2;
-		c2.n = &c3;
-		c3.n = &c1;
-
-		// Previous: c.p.
-		c1.p = &c3;
-		c2.p = &c1;
-		c3.p = &c2;
-
-		// Edge: c.e.
-		for (int j = 0; j < 3; ++j)
+		for (int i = begin; i < end; ++i)
 		{
-			// For each vertex, check to see if that vertex is NOT contained in an edge.
-			// The edge that does not contain the vertex is the edge that we want for c.e.
-			Edge* e = t.edges[j];
-			if (e->Contains(v1) == -1)
-			{
-				c1.e = e;
-			}
-			if (e->Contains(v2) == -1)
-			{
-				c2.e = e;
-			}
-			if (e->Contains(v3) == -1)
+			int cornerIndex = 3 * i;
+
+			// Get the triangle and its vertices.
+			Triangle& t = tlist[i];
+			Vert* v1 = t.vertices[0];
+			Vert* v2 = t.vertices[1];
+			Vert* v3 = t.vertices[2];
+
+			// Corners.
+			Corner& c1 = corners[cornerIndex];
+			c1.index = cornerIndex;
+			Corner& c2 = corners[cornerIndex + 1];
+			c2.index = cornerIndex + 1;
+			Corner& c3 = corners[cornerIndex + 2];
+			c3.index = cornerIndex + 2;
+		 
+			// Triangle: c.t.
+			c1.t = &t;
+			c2.t = &t;
+			c3.t = &t;
+
+			// Vertex: c.v.
+			c1.v = v1;
+			c2.v = v2;
+			c3.v = v3;
+
+			// Next: c.n.
+			c1.n = &c2;
+			c2.n = &c3;
+			c3.n = &c1;
+
+			// Previous: c.p.
+			c1.p = &c3;
+			c2.p = &c1;
+			c3.p = &c2;
+
+			// Edge: c.e.
+			for (int j = 0; j < 3; ++j)
 			{
-				c3.e = e;
+				// For each vertex, check to see if that vertex is NOT contained in an edge.
+				// The edge that does not contain the vertex is the edge that we want for c.e.
+				Edge* e = t.edges[j];
+				if (e->Contains(v1) == -1)
+				{
+					c1.e = e;
+				}
+				if (e->Contains(v2) == -1)
+				{
+					c2.e = e;
+				}
+				if (e->Contains(v3) == -1)
+				{
+					c3.e = e;
+				}
 			}
-		}
-
-		// And now the hard part...
-		// Opposite: c.o.
-		for (int j = 0; j < 3; ++j)
-		{
-			Corner& c = corners[cornerIndex + j];
-
-			// Get the edge of the corner and find the triangle that is not equal to c.t.
-			Edge* e = c.e;
 
-			// If this edge is attached to only one triangle then there is no opposite corner.
-			if (e->numberOfTriangles > 1)
+			// And now the hard part...
+			// Opposite: c.o.
+			for (int j = 0; j < 3; ++j)
 			{
-				// Pick the correct triangle that is NOT equal to the current triangle c.t.	
-				Triangle* s = e->GetOtherTriangle(&t);
+				Corner& c = corners[cornerIndex + j];
+
+				// Get the edge of the corner and find the triangle that is not equal to c.t.
+				Edge* e = c.e;
 
-				// Look through the vertices of the triangle and find the one that is not in the shared edge.
-				for (int k = 0; k < 3; ++k)
+				// If this edge is attached to only one triangle then there is no opposite corner.
+				if (e->numberOfTriangles > 1)
 				{
-					int triangleVertexIndex = k;
-					Vert* w = s->vertices[triangleVertexIndex];
-					if (e->Contains(w) == -1)
+					// Pick the correct triangle that is NOT equal to the current triangle c.t.	
+					Triangle* s = e->GetOtherTriangle(&t);
+
+					// Look through the vertices of the triangle and find the one that is not in the shared edge.
+					for (int k = 0; k < 3; ++k)
 					{
-						// The annoying part.
-						// We need to figure out what the index of the desired corner c.o will be, before it is even initialized.
-						// Since we are creating these corners by iterating through the triangles, we can determine the future index of c.o.
-						// First, each triangle generates three corners.
-						// So if we are looking at the ith triangle, then the desired corner will have index 3i, 3i+1, or 3i+2.
-						int index = 3 * s->index + triangleVertexIndex;
-						c.o = &corners[index];
-						//c.Print();
-						break;
+						int triangleVertexIndex = k;
+						Vert* w = s->vertices[triangleVertexIndex];
+						if (e->Contains(w) == -1)
+						{
+							// The annoying part.
+							// We need to figure out what the index of the desired corner c.o will be, before it is even initialized.
+							// Since we are creating these corners by iterating through the triangles, we can determine the future index of c.o.
+							// First, each triangle generates three corners.
+							// So if we are looking at the ith triangle, then the desired corner will have index 3i, 3i+1, or 3i+2.
+							int index = 3 * s->index + triangleVertexIndex;
+							c.o = &corners[index];
+							//c.Print();
+							break;
+						}
 					}
 				}
-			}
-			else
-			{
-				c.o = NULL;
+				else
+				{
+					c.o = NULL;
+				}
 			}
 		}
-
-		cornerIndex += 3;
-	}
+	});
 }
 
 void MeshAnalysis::GetValenceDeficit(Polyhedron* p)
 {
+	PROFILE_SCOPE("MeshAnalysis::GetValenceDeficit");
 	// We can cycle around a vertex using corners.
 	// Given a corner, check c.p.o.p to get a new corner at the same vertex.
 	// Hop around in this fashion until we get back to where we started.
@@ -330,29 +491,20 @@ void MeshAnalysis::GetValenceDeficit(Polyhedron* p)
 	{
 		GetCornerList(p);
 	}
-	std::vector<Corner>& corners = p->clist;
+	ChunkedArray<Corner>& corners = p->clist;
 
-	for (Corner c : corners)
+	for (Corner& c : corners)
 	{
 		// Valence:
 		// Don't bother computing if the valence of this vertex has already been set.
 		if (c.v->valence == 0)
 		{
-			// Bounce around until we get back to where we started.
-			int index = -1;
-			int valence = 0;
-			Corner* previous = &c;
-			while (index != c.index)
-			{
-				// Valence computation:
-				Corner* adjacent = previous->p->o->p;
-				index = adjacent->index;
-
-				valence++;
-				previous = adjacent;
-			}
+			// A closed fan has as many neighbors as triangles; an open one has one more.
+			// The regular valence is 6 inside the mesh and 4 on its boundary.
+			bool boundary = c.IsBoundary();
+			int valence = c.v->numberOfTriangles + (boundary ? 1 : 0);
 			c.v->valence = valence;
-			int deficit = 6 - valence;
+			int deficit = (boundary ? 4 : 6) - valence;
 			p->valenceDeficit += deficit;
 		}
 	}
@@ -373,7 +525,7 @@ void MeshAnalysis::ComputeAngle(Corner& c)
 	c.angle = angle;
 }
 
-void MeshAnalysis::ComputeAngles(std::vector<Corner>& corners)
+void MeshAnalysis::ComputeAngles(ChunkedArray<Corner>& corners)
 {
 	for (Corner& c : corners)
 	{
@@ -395,13 +547,46 @@ void MeshAnalysis::ComputeAngles(std::vector<Corner>& corners)
 
 void MeshAnalysis::GetAngleDeficit(Polyhedron* p)
 {
-	ComputeAngles(p->clist);
+	PROFILE_SCOPE("MeshAnalysis::GetAngleDeficit");
+	ChunkedArray<Corner>& corners = p->clist;
+	ChunkedArray<Vert>& vlist = p->vlist;
+
+	// Every corner angle, then every vertex total from the corners of its triangles,
+	// which are at 3 * t.index + (position of v in t).
+	Parallel::For(0, corners.size(), CORNER_GRAIN, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			if (corners[i].angle == 0)
+			{
+				ComputeAngle(corners[i]);
+			}
+		}
+	});
+	Parallel::For(0, vlist.size(), CORNER_GRAIN, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Vert& v = vlist[i];
+			double totalAngle = 0.0;
+			for (int j = 0; j < v.numberOfTriangles; ++j)
+			{
+				Triangle* t = v.triangles[j];
+				totalAngle += corners[3 * t->index + t->Contains(&v)].angle;
+			}
+			v.totalAngle = totalAngle;
+		}
+	});
+
+	// The flat angle is 2 pi inside the mesh and pi on its boundary.
 	double totalAngleDeficit = 0;
 	for (int i = 0; i < p->vlist.size(); ++i)
 	{
-		double vertexAngle = p->vlist[i].totalAngle;
+		Vert& v = p->vlist[i];
+		double vertexAngle = v.totalAngle;
 		//std::cout << vertexAngle << std::endl;
-		double angleDeficit = 2 * M_PI - vertexAngle;
+		bool boundary = v.numberOfTriangles > 0 && corners[3 * v.triangles[0]->index + v.triangles[0]->Contains(&v)].IsBoundary();
+		double angleDeficit = (boundary ? M_PI : 2 * M_PI) - vertexAngle;
 		totalAngleDeficit += angleDeficit;
 	}
 	p->angleDeficit = totalAngleDeficit;
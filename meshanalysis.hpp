@@ -4,11 +4,24 @@
 #include <limits>
 #include <algorithm>
 #include "meshcomponent.hpp"
+#include "fastmath.hpp"
+#include "chunkedarray.hpp"
+#include "parallel.hpp"
+#include "profiler.hpp"
 
 // Forward declaration.
 class Polyhedron;
 class MeshComponent;
 
+// Metrics of every triangle of a mesh, computed together by MeshAnalysis::ComputeTriangleMetrics().
+struct TriangleMetrics
+{
+	std::vector<double> horizonArea; // Twice the sum of the angles between the vertex normals.
+	std::vector<double> perimeter;
+	std::vector<double> area;
+	std::vector<double> sphericalArea; // Area of the triangle spanned by the vertex normals on the unit sphere.
+};
+
 // Static class to analyze a Polyhedron object.
 class MeshAnalysis
 {
@@ -18,16 +31,16 @@ public:
 	// Compute the corners of a polyhedron.
 	void static GetCornerList(Polyhedron* p);	
 
-	// Compute the valence deficit of a polyhedron.
+	// Compute the valence deficit of a polyhedron. Boundary vertices are measured against 4 rather than 6.
 	void static GetValenceDeficit(Polyhedron* p);
 
 	// Compute the angle at a single vertex.
 	void static ComputeAngle(Corner& c);
 
 	// Compute all angles of a list of corners. 
-	void static ComputeAngles(std::vector<Corner>& corners);
+	void static ComputeAngles(ChunkedArray<Corner>& corners);
 
-	// Compute angle deficit of a polyhedron.
+	// Compute angle deficit of a polyhedron. Boundary vertices are measured against pi rather than 2 pi.
 	void static GetAngleDeficit(Polyhedron* p);
 
 	// Compute perimeter or area of a single triangle.
@@ -54,12 +67,20 @@ public:
 	static double ComputeApproximateGaussianCurvature(Triangle& t);
 
 	// Get the horizon measure of every triangle.
-	static std::vector<float> GetHorizonMeasures(std::vector<Triangle>& triangles);
-	static std::vector<double> GetHorizonMeasuresDouble(std::vector<Triangle>& triangles);
-	static std::vector<double> GetOriginalHorizonMeasuresDouble(std::vector<Triangle>& triangles);
+	static std::vector<float> GetHorizonMeasures(ChunkedArray<Triangle>& triangles);
+	static std::vector<double> GetHorizonMeasuresDouble(ChunkedArray<Triangle>& triangles);
+	static std::vector<double> GetOriginalHorizonMeasuresDouble(ChunkedArray<Triangle>& triangles);
 
 	// Get the approximate Gaussian curvature of every triangle.
-	static std::vector<double> GetApproximateGaussianCurvatures(std::vector<Triangle>& triangles);
+	static std::vector<double> GetApproximateGaussianCurvatures(ChunkedArray<Triangle>& triangles);
+
+	// Compute every metric of every triangle in one pass, split across threads.
+	// Each block of triangles is copied into flat arrays first, so the arithmetic runs on two triangles at a time
+	// with SSE2 and uses the approximations of FastMath instead of acos() (absolute error at most 2e-8 per angle).
+	static TriangleMetrics ComputeTriangleMetrics(ChunkedArray<Triangle>& triangles);
+
+	// Recompute the metrics of only the given triangles, e.g. DirtyRegion::triangles after an edit.
+	static void UpdateTriangleMetrics(ChunkedArray<Triangle>& triangles, const std::vector<int>& indices, TriangleMetrics& metrics);
 
 private:
 
@@ -67,4 +88,13 @@ private:
 	~MeshAnalysis();
 
 	float static InverseLerp(float start, float end, float v);
+
+	// Triangles per block of ComputeTriangleMetrics().
+	static const int METRICS_BLOCK_SIZE = 256;
+
+	// Corners/vertices per block for the parallel loops of GetCornerList() and GetAngleDeficit().
+	static const int CORNER_GRAIN = 4096;
+
+	// Compute the metrics of triangles [begin, end), or of indices[begin, end) if indices is given.
+	static void ComputeTriangleMetricsBlock(ChunkedArray<Triangle>& triangles, const int* indices, TriangleMetrics& metrics, int begin, int end);
 };
@@ -0,0 +1,472 @@
+#include "meshcache.hpp"
+
+constexpr char MeshCache::MAGIC[8];
+
+bool MeshCache::Save(std::string cachePath, std::string sourcePath, std::string build, Polyhedron* p, TriangleMetrics& metrics)
+{
+	PROFILE_SCOPE("MeshCache::Save");
+	MeshCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.headerSize = sizeof(MeshCacheHeader);
+	if (!GetSourceStamp(sourcePath, header.sourceSize, header.sourceTime))
+	{
+		std::cout << "MESH CACHE: SOURCE " << sourcePath << " NOT FOUND, NOT SAVING." << std::endl;
+		return false;
+	}
+	strncpy(header.build, build.c_str(), sizeof(header.build) - 1);
+
+	header.vertices = p->vlist.size();
+	header.edges = p->elist.size();
+	header.triangles = p->tlist.size();
+	header.vertexTriangles = p->vertexTriangles.size();
+	header.hasMetrics = (metrics.area.size() == p->tlist.size()) ? 1 : 0;
+	if (p->clist.size() != 3 * p->tlist.size())
+	{
+		std::cout << "MESH CACHE: POLYHEDRON IS NOT INITIALIZED, NOT SAVING." << std::endl;
+		return false;
+	}
+	for (int i = 0; i < p->elist.size(); ++i)
+	{
+		header.edgeTriangles += p->elist[i].numberOfTriangles;
+	}
+
+	header.surfaceArea = p->surfaceArea;
+	header.center[0] = p->center.x;
+	header.center[1] = p->center.y;
+	header.center[2] = p->center.z;
+	header.radius = p->radius;
+	header.angleDeficit = p->angleDeficit;
+	header.normalOrientation = p->normalOrientation;
+	header.valenceDeficit = p->valenceDeficit;
+	Layout(header);
+
+	// Write next to the cache and rename, so a cache that is being written is never loaded.
+	// The checksum is taken a block at a time as the chunks go to disk, and the header is rewritten with it at the end.
+	// A block is hashed whole only if no chunk boundary falls inside it: chunks must be a whole number of blocks.
+	static_assert(StreamWriter::DEFAULT_CHUNK_SIZE % CHECKSUM_BLOCK == 0, "StreamWriter chunks must hold whole checksum blocks.");
+	std::string temporaryPath = cachePath + ".tmp";
+	StreamWriter writer(StreamWriter::DEFAULT_CHUNK_SIZE);
+	std::vector<uint64_t> blockHashes((header.fileSize + CHECKSUM_BLOCK - 1) / CHECKSUM_BLOCK);
+	writer.onChunk = [&](uint64_t offset, const char* data, size_t bytes)
+	{
+		// Also true only up to the first Flush(), which comes after the last chunk here.
+		assert(offset % CHECKSUM_BLOCK == 0);
+		for (uint64_t b = 0; b < bytes; b += CHECKSUM_BLOCK)
+		{
+			blockHashes[(offset + b) / CHECKSUM_BLOCK] = HashBlock(data + b, offset + b, std::min(CHECKSUM_BLOCK, bytes - b));
+		}
+	};
+	if (!writer.Open(temporaryPath))
+	{
+		return false;
+	}
+	writer.Write(&header, sizeof(header));
+
+	writer.WriteOrdered(header.vertices, CACHE_GRAIN, [&](int begin, int end, std::vector<char>& out)
+	{
+		out.resize((end - begin) * sizeof(CachedVertex));
+		CachedVertex* vertices = (CachedVertex*)out.data();
+		for (int i = begin; i < end; ++i)
+		{
+			Vert& v = p->vlist[i];
+			CachedVertex& w = vertices[i - begin];
+			w.position[0] = v.x;
+			w.position[1] = v.y;
+			w.position[2] = v.z;
+			w.normal[0] = v.normal.x;
+			w.normal[1] = v.normal.y;
+			w.normal[2] = v.normal.z;
+			w.totalAngle = v.totalAngle;
+			w.valence = v.valence;
+			w.numberOfTriangles = v.numberOfTriangles;
+			w.triangleOffset = v.triangles.data - p->vertexTriangles.data();
+			w.padding = 0;
+		}
+	});
+	writer.Pad(8);
+
+	writer.WriteOrdered(header.vertexTriangles, CACHE_GRAIN, [&](int begin, int end, std::vector<char>& out)
+	{
+		out.resize((end - begin) * sizeof(int32_t));
+		int32_t* vertexTriangles = (int32_t*)out.data();
+		for (int i = begin; i < end; ++i)
+		{
+			vertexTriangles[i - begin] = p->vertexTriangles[i]->index;
+		}
+	});
+	writer.Pad(8);
+
+	writer.WriteOrdered(header.edges, CACHE_GRAIN, [&](int begin, int end, std::vector<char>& out)
+	{
+		out.resize((end - begin) * sizeof(CachedEdge));
+		CachedEdge* edges = (CachedEdge*)out.data();
+		for (int i = begin; i < end; ++i)
+		{
+			Edge& e = p->elist[i];
+			CachedEdge& f = edges[i - begin];
+			f.vertices[0] = e.vertices[0]->index;
+			f.vertices[1] = e.vertices[1]->index;
+			f.numberOfTriangles = e.numberOfTriangles;
+			f.padding = 0;
+			f.length = e.length;
+		}
+	});
+	writer.Pad(8);
+
+	writer.WriteOrdered(header.edges, CACHE_GRAIN, [&](int begin, int end, std::vector<char>& out)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Edge& e = p->elist[i];
+			for (int j = 0; j < e.numberOfTriangles; ++j)
+			{
+				int32_t t = e.triangles[j]->index;
+				out.insert(out.end(), (char*)&t, (char*)&t + sizeof(t));
+			}
+		}
+	});
+	writer.Pad(8);
+
+	writer.WriteOrdered(header.triangles, CACHE_GRAIN, [&](int begin, int end, std::vector<char>& out)
+	{
+		out.resize((end - begin) * sizeof(CachedTriangle));
+		CachedTriangle* triangles = (CachedTriangle*)out.data();
+		for (int i = begin; i < end; ++i)
+		{
+			Triangle& t = p->tlist[i];
+			CachedTriangle& s = triangles[i - begin];
+			for (int j = 0; j < 3; ++j)
+			{
+				s.vertices[j] = t.vertices[j]->index;
+				s.edges[j] = t.edges[j]->index;
+				s.normal[j] = t.normal[j];
+			}
+			s.area = t.area;
+		}
+	});
+	writer.Pad(8);
+
+	writer.WriteOrdered(header.triangles, CACHE_GRAIN, [&](int begin, int end, std::vector<char>& out)
+	{
+		out.resize(3 * (end - begin) * sizeof(int32_t));
+		int32_t* opposites = (int32_t*)out.data();
+		for (int i = 3 * begin; i < 3 * end; ++i)
+		{
+			Corner& c = p->clist[i];
+			opposites[i - 3 * begin] = c.o ? c.o->index : -1;
+		}
+	});
+	writer.Pad(8);
+
+	writer.WriteOrdered(header.triangles, CACHE_GRAIN, [&](int begin, int end, std::vector<char>& out)
+	{
+		out.resize(3 * (end - begin) * sizeof(double));
+		double* angles = (double*)out.data();
+		for (int i = 3 * begin; i < 3 * end; ++i)
+		{
+			angles[i - 3 * begin] = p->clist[i].angle;
+		}
+	});
+	writer.Pad(8);
+
+	if (header.hasMetrics)
+	{
+		size_t bytes = header.triangles * sizeof(double);
+		writer.Write(metrics.horizonArea.data(), bytes);
+		writer.Pad(8);
+		writer.Write(metrics.perimeter.data(), bytes);
+		writer.Pad(8);
+		writer.Write(metrics.area.data(), bytes);
+		writer.Pad(8);
+		writer.Write(metrics.sphericalArea.data(), bytes);
+		writer.Pad(8);
+	}
+
+	// Every block has been hashed once the last chunk is written, and only then can the header be finished.
+	writer.Flush();
+	header.checksum = CombineBlocks(blockHashes);
+	uint64_t written = writer.getSize();
+	writer.Rewrite(0, &header, sizeof(header));
+	bool closed = writer.Close();
+	if (!closed || written != header.fileSize || rename(temporaryPath.c_str(), cachePath.c_str()) != 0)
+	{
+		std::cout << "MESH CACHE: COULD NOT WRITE " << cachePath << "." << std::endl;
+		remove(temporaryPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool MeshCache::Load(std::string cachePath, std::string sourcePath, std::string build, Polyhedron*& p, TriangleMetrics& metrics)
+{
+	PROFILE_SCOPE("MeshCache::Load");
+	int file = open(cachePath.c_str(), O_RDONLY);
+	if (file == -1)
+	{
+		return false;
+	}
+	struct stat status;
+	if (fstat(file, &status) != 0 || status.st_size < (off_t)sizeof(MeshCacheHeader))
+	{
+		close(file);
+		return false;
+	}
+	uint64_t fileSize = status.st_size;
+	void* mapping = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (mapping == MAP_FAILED)
+	{
+		return false;
+	}
+	const char* data = (const char*)mapping;
+
+	// Check everything before touching the contents.
+	MeshCacheHeader header;
+	memcpy(&header, data, sizeof(header));
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+	const char* problem = NULL;
+	if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.headerSize != sizeof(MeshCacheHeader))
+	{
+		problem = "NOT A MESH CACHE";
+	}
+	else if (header.version != VERSION)
+	{
+		problem = "OLD VERSION";
+	}
+	else if (header.fileSize != fileSize)
+	{
+		problem = "WRONG SIZE";
+	}
+	else if (!GetSourceStamp(sourcePath, sourceSize, sourceTime) || header.sourceSize != sourceSize || header.sourceTime != sourceTime)
+	{
+		problem = "SOURCE CHANGED";
+	}
+	else if (strncmp(header.build, build.c_str(), sizeof(header.build) - 1) != 0)
+	{
+		problem = "BUILT DIFFERENTLY";
+	}
+	else
+	{
+		// The layout must follow from the counts, or the sections below could point outside the file.
+		MeshCacheHeader expected = header;
+		Layout(expected);
+		if (memcmp(expected.sections, header.sections, sizeof(header.sections)) != 0 || expected.fileSize != fileSize)
+		{
+			problem = "BAD LAYOUT";
+		}
+		else if (Checksum(data, fileSize) != header.checksum)
+		{
+			problem = "BAD CHECKSUM";
+		}
+	}
+	if (problem)
+	{
+		std::cout << "MESH CACHE " << cachePath << " NOT USED: " << problem << "." << std::endl;
+		munmap(mapping, fileSize);
+		return false;
+	}
+
+	const CachedVertex* vertices = (const CachedVertex*)(data + header.sections[CACHE_VERTICES]);
+	const int32_t* vertexTriangles = (const int32_t*)(data + header.sections[CACHE_VERTEX_TRIANGLES]);
+	const CachedEdge* edges = (const CachedEdge*)(data + header.sections[CACHE_EDGES]);
+	const int32_t* edgeTriangles = (const int32_t*)(data + header.sections[CACHE_EDGE_TRIANGLES]);
+	const CachedTriangle* triangles = (const CachedTriangle*)(data + header.sections[CACHE_TRIANGLES]);
+	const int32_t* opposites = (const int32_t*)(data + header.sections[CACHE_CORNER_OPPOSITES]);
+	const double* angles = (const double*)(data + header.sections[CACHE_CORNER_ANGLES]);
+
+	// Create every element first: the lists never move their elements, so pointers can be filled in afterwards, in parallel.
+	Polyhedron* q = new Polyhedron();
+	q->vlist.assign(header.vertices, Vert());
+	q->elist.assign(header.edges, Edge());
+	q->tlist.assign(header.triangles, Triangle());
+	q->clist.assign(3 * header.triangles, Corner());
+	q->vertexTriangles.resize(header.vertexTriangles);
+
+	Parallel::For(0, header.vertices, CACHE_GRAIN, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			const CachedVertex& w = vertices[i];
+			Vert& v = q->vlist[i];
+			v.index = i;
+			v.x = w.position[0];
+			v.y = w.position[1];
+			v.z = w.position[2];
+			v.normal = glm::dvec3(w.normal[0], w.normal[1], w.normal[2]);
+			v.totalAngle = w.totalAngle;
+			v.valence = w.valence;
+			v.numberOfTriangles = w.numberOfTriangles;
+			v.triangles.data = q->vertexTriangles.data() + w.triangleOffset;
+			v.triangles.count = w.numberOfTriangles;
+		}
+	});
+	Parallel::For(0, header.vertexTriangles, CACHE_GRAIN, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			q->vertexTriangles[i] = &q->tlist[vertexTriangles[i]];
+		}
+	});
+	std::vector<int> edgeOffsets(header.edges);
+	int edgeOffset = 0;
+	for (int i = 0; i < header.edges; ++i)
+	{
+		edgeOffsets[i] = edgeOffset;
+		edgeOffset += edges[i].numberOfTriangles;
+	}
+	Parallel::For(0, header.edges, CACHE_GRAIN, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			const CachedEdge& f = edges[i];
+			Edge& e = q->elist[i];
+			e.index = i;
+			e.vertices[0] = &q->vlist[f.vertices[0]];
+			e.vertices[1] = &q->vlist[f.vertices[1]];
+			e.length = f.length;
+			e.numberOfTriangles = f.numberOfTriangles;
+			e.triangles.resize(f.numberOfTriangles);
+			for (int j = 0; j < f.numberOfTriangles; ++j)
+			{
+				e.triangles[j] = &q->tlist[edgeTriangles[edgeOffsets[i] + j]];
+			}
+		}
+	});
+	Parallel::For(0, header.triangles, CACHE_GRAIN, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			const CachedTriangle& s = triangles[i];
+			Triangle& t = q->tlist[i];
+			t.index = i;
+			for (int j = 0; j < 3; ++j)
+			{
+				t.vertices[j] = &q->vlist[s.vertices[j]];
+				t.edges[j] = &q->elist[s.edges[j]];
+			}
+			t.normal = glm::dvec3(s.normal[0], s.normal[1], s.normal[2]);
+			t.area = s.area;
+
+			// Corner j of a triangle sits at vertex j, opposite to edge j + 1; see MeshAnalysis::GetCornerList().
+			for (int j = 0; j < 3; ++j)
+			{
+				Corner& c = q->clist[3 * i + j];
+				c.index = 3 * i + j;
+				c.v = t.vertices[j];
+				c.e = t.edges[(j + 1) % 3];
+				c.t = &t;
+				c.n = &q->clist[3 * i + (j + 1) % 3];
+				c.p = &q->clist[3 * i + (j + 2) % 3];
+				c.o = (opposites[3 * i + j] == -1) ? NULL : &q->clist[opposites[3 * i + j]];
+				c.angle = angles[3 * i + j];
+			}
+		}
+	});
+
+	q->surfaceArea = header.surfaceArea;
+	q->center = glm::dvec3(header.center[0], header.center[1], header.center[2]);
+	q->radius = header.radius;
+	q->valenceDeficit = header.valenceDeficit;
+	q->angleDeficit = header.angleDeficit;
+	q->normalOrientation = header.normalOrientation;
+
+	if (header.hasMetrics)
+	{
+		const double* horizonAreas = (const double*)(data + header.sections[CACHE_HORIZON_AREAS]);
+		const double* perimeters = (const double*)(data + header.sections[CACHE_PERIMETERS]);
+		const double* areas = (const double*)(data + header.sections[CACHE_AREAS]);
+		const double* sphericalAreas = (const double*)(data + header.sections[CACHE_SPHERICAL_AREAS]);
+		metrics.horizonArea.assign(horizonAreas, horizonAreas + header.triangles);
+		metrics.perimeter.assign(perimeters, perimeters + header.triangles);
+		metrics.area.assign(areas, areas + header.triangles);
+		metrics.sphericalArea.assign(sphericalAreas, sphericalAreas + header.triangles);
+	}
+
+	munmap(mapping, fileSize);
+	p = q;
+	return true;
+}
+
+bool MeshCache::GetSourceStamp(std::string sourcePath, uint64_t& size, int64_t& time)
+{
+	struct stat status;
+	if (stat(sourcePath.c_str(), &status) != 0)
+	{
+		return false;
+	}
+	size = status.st_size;
+	time = (int64_t)status.st_mtim.tv_sec * 1000000000 + status.st_mtim.tv_nsec;
+	return true;
+}
+
+void MeshCache::Layout(MeshCacheHeader& header)
+{
+	uint64_t triangles = header.triangles;
+	uint64_t metrics = header.hasMetrics ? triangles * sizeof(double) : 0;
+	uint64_t sizes[CACHE_SECTIONS] =
+	{
+		header.vertices * sizeof(CachedVertex),
+		header.vertexTriangles * sizeof(int32_t),
+		header.edges * sizeof(CachedEdge),
+		header.edgeTriangles * sizeof(int32_t),
+		triangles * sizeof(CachedTriangle),
+		3 * triangles * sizeof(int32_t),
+		3 * triangles * sizeof(double),
+		metrics,
+		metrics,
+		metrics,
+		metrics
+	};
+
+	// Every section starts on 8 bytes, and so does the end of the file, so the checksum can read whole words.
+	uint64_t offset = sizeof(MeshCacheHeader);
+	for (int i = 0; i < CACHE_SECTIONS; ++i)
+	{
+		header.sections[i] = offset;
+		offset += (sizes[i] + 7) & ~(uint64_t)7;
+	}
+	header.fileSize = offset;
+}
+
+uint64_t MeshCache::HashBlock(const char* data, uint64_t offset, uint64_t bytes)
+{
+	uint64_t checksumWord = offsetof(MeshCacheHeader, checksum) / sizeof(uint64_t);
+	uint64_t first = offset / sizeof(uint64_t);
+	uint64_t words = bytes / sizeof(uint64_t);
+	uint64_t hash = FNV_OFFSET;
+	for (uint64_t i = 0; i < words; ++i)
+	{
+		uint64_t word;
+		memcpy(&word, data + i * sizeof(uint64_t), sizeof(word));
+		hash = (hash ^ (first + i == checksumWord ? 0 : word)) * FNV_PRIME;
+	}
+	return hash;
+}
+
+uint64_t MeshCache::CombineBlocks(const std::vector<uint64_t>& blockHashes)
+{
+	uint64_t hash = FNV_OFFSET;
+	for (int b = 0; b < blockHashes.size(); ++b)
+	{
+		hash = (hash ^ blockHashes[b]) * FNV_PRIME;
+	}
+	return hash;
+}
+
+uint64_t MeshCache::Checksum(const char* data, uint64_t size)
+{
+	int blocks = (size + CHECKSUM_BLOCK - 1) / CHECKSUM_BLOCK;
+	std::vector<uint64_t> blockHashes(blocks);
+	Parallel::For(0, blocks, 1, [&](int begin, int end)
+	{
+		for (int b = begin; b < end; ++b)
+		{
+			uint64_t offset = b * CHECKSUM_BLOCK;
+			blockHashes[b] = HashBlock(data + offset, offset, std::min(CHECKSUM_BLOCK, size - offset));
+		}
+	});
+	return CombineBlocks(blockHashes);
+}
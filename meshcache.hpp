@@ -0,0 +1,158 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <cassert>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "polyhedron.hpp"
+#include "meshanalysis.hpp"
+#include "parallel.hpp"
+#include "streamwriter.hpp"
+#include "profiler.hpp"
+
+// Sections of a mesh cache file, in the order they are stored.
+enum MeshCacheSection
+{
+	CACHE_VERTICES,
+	CACHE_VERTEX_TRIANGLES,
+	CACHE_EDGES,
+	CACHE_EDGE_TRIANGLES,
+	CACHE_TRIANGLES,
+	CACHE_CORNER_OPPOSITES,
+	CACHE_CORNER_ANGLES,
+	CACHE_HORIZON_AREAS,
+	CACHE_PERIMETERS,
+	CACHE_AREAS,
+	CACHE_SPHERICAL_AREAS,
+	CACHE_SECTIONS
+};
+
+// First bytes of a mesh cache file. Every field is 8-byte aligned, so the file can be used straight from memory.
+struct MeshCacheHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize;
+	uint64_t fileSize;
+
+	// FNV-1a of the whole file, computed with this field set to 0.
+	uint64_t checksum;
+
+	// The file the mesh was built from and how, so a stale cache is rebuilt instead of loaded.
+	uint64_t sourceSize;
+	int64_t sourceTime;
+	char build[64];
+
+	int32_t vertices;
+	int32_t edges;
+	int32_t triangles;
+	int32_t vertexTriangles;
+	int32_t edgeTriangles;
+	int32_t hasMetrics;
+
+	// Polyhedron values computed by Initialize():
+	double surfaceArea;
+	double center[3];
+	double radius;
+	double angleDeficit;
+	double normalOrientation;
+	int32_t valenceDeficit;
+	int32_t padding;
+
+	// Byte offset of every section from the start of the file.
+	uint64_t sections[CACHE_SECTIONS];
+};
+
+// Flat records of the mesh elements. Elements refer to each other by index instead of by pointer.
+struct CachedVertex
+{
+	double position[3];
+	double normal[3];
+	double totalAngle;
+	int32_t valence;
+	int32_t numberOfTriangles;
+	int32_t triangleOffset; // Into the vertex triangle section, in the order around the vertex.
+	int32_t padding;
+};
+
+struct CachedEdge
+{
+	int32_t vertices[2];
+	int32_t numberOfTriangles; // The edge triangle section holds the triangles of every edge, one edge after the other.
+	int32_t padding;
+	double length;
+};
+
+struct CachedTriangle
+{
+	int32_t vertices[3];
+	int32_t edges[3];
+	double normal[3];
+	double area;
+};
+
+/** Binary cache of an initialized Polyhedron and its triangle metrics.
+ *
+ * Reading a .ply file and running Initialize() rebuilds the edges, corners, normals and angles every run.
+ * The cache stores all of them as flat arrays of indices, so loading is a memory map, a checksum,
+ * and one parallel pass that turns the indices back into pointers.
+ * Saving streams the sections through a StreamWriter, so it takes little memory besides the mesh.
+ *
+ * A cache is only loaded if it has the current version, matches the size and modification time of the source file,
+ * was built the same way (e.g. the same subdivision), and its checksum is right. Otherwise Load() returns false
+ * and the caller builds the mesh as usual and saves a new cache. */
+class MeshCache
+{
+
+public:
+
+	// Write p (initialized) and its metrics, which may be empty, to cachePath.
+	// Returns false if the mesh cannot be cached or the file cannot be written.
+	static bool Save(std::string cachePath, std::string sourcePath, std::string build, Polyhedron* p, TriangleMetrics& metrics);
+
+	// Read the mesh cached at cachePath into a new, initialized polyhedron.
+	// Returns false, leaving p and metrics alone, if there is no usable cache.
+	static bool Load(std::string cachePath, std::string sourcePath, std::string build, Polyhedron*& p, TriangleMetrics& metrics);
+
+private:
+
+	MeshCache();
+	~MeshCache();
+
+	// Size and modification time of the source file, or false if it does not exist.
+	static bool GetSourceStamp(std::string sourcePath, uint64_t& size, int64_t& time);
+
+	// Offsets of every section for the given header counts, and the size of the whole file.
+	static void Layout(MeshCacheHeader& header);
+
+	// FNV-1a of one block of the file, a word at a time; offset is where the block starts in the file.
+	// The checksum field counts as 0.
+	static uint64_t HashBlock(const char* data, uint64_t offset, uint64_t bytes);
+
+	// FNV-1a over the hashes of the blocks, i.e. the checksum of the file.
+	static uint64_t CombineBlocks(const std::vector<uint64_t>& blockHashes);
+
+	// Checksum of a whole file in memory, hashing its blocks in parallel.
+	static uint64_t Checksum(const char* data, uint64_t size);
+
+	// Bytes per block of the checksum; blocks are hashed in parallel.
+	static const uint64_t CHECKSUM_BLOCK = 1 << 20;
+
+	// Elements per block for the parallel loops.
+	static const int CACHE_GRAIN = 4096;
+
+	static const uint64_t FNV_OFFSET = 14695981039346656037ull;
+	static const uint64_t FNV_PRIME = 1099511628211ull;
+
+	// Bump whenever the layout or the meaning of a cached value changes, so older caches are rebuilt.
+	static const uint32_t VERSION = 3;
+	static constexpr char MAGIC[8] = {'R', 'V', 'M', 'E', 'S', 'H', '\0', '\0'};
+
+};
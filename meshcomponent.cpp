@@ -9,6 +9,7 @@ MeshComponent::MeshComponent(std::vector<Vertex> vertices, std::vector<uint> tri
 	this->vertices = vertices;
 	this->triangles = triangles;
 	this->transform = glm::mat4(1);
+	ComputeBounds();
 }
 
 double MeshComponent::InverseLerp(double start, double end, double v)
@@ -125,6 +126,8 @@ MeshComponent::MeshComponent(Polyhedron *p, std::vector<double>& triangleHorizon
 	this->vertices = vertices;
 	this->triangles = triangles;
 	this->transform = glm::mat4(1);
+	ComputeBounds();
+	CopyBoundingSphere(p);
 }
 
 void MeshComponent::AssignHorizonMeasureColors(std::vector<float>& triangleHorizon)
@@ -285,27 +288,21 @@ MeshComponent::MeshComponent(Polyhedron *p)
 	this->vertices = vertices;
 	this->triangles = triangles;
 	this->transform = glm::mat4(1);
+	ComputeBounds();
+	CopyBoundingSphere(p);
 }
 
-uint MeshComponent::getVBO()
+int MeshComponent::getAllocation()
 {
-	return vboID;
-}
-uint MeshComponent::getVAO()
-{
-	return vaoID;
+	return allocationID;
 }
 uint MeshComponent::getCount()
 {
 	return triangles.size();
 }
-void MeshComponent::setVBO(uint vboID)
-{
-	this->vboID = vboID;
-}
-void MeshComponent::setVAO(uint vaoID)
+void MeshComponent::setAllocation(int allocationID)
 {
-	this->vaoID = vaoID;
+	this->allocationID = allocationID;
 }
 
 std::vector<Vertex>& MeshComponent::getVertices()
@@ -321,4 +318,72 @@ void MeshComponent::CreateModel(std::vector<Vertex> vertices, std::vector<uint>
 {
 	this->vertices = vertices;
 	this->triangles = triangles;
+	ComputeBounds();
+}
+
+void MeshComponent::ComputeBounds()
+{
+	if (vertices.empty())
+	{
+		boundsMin = boundsMax = boundingCenter = glm::vec3(0);
+		boundingRadius = 0.0f;
+		return;
+	}
+
+	boundsMin = vertices[0].getPosition();
+	boundsMax = boundsMin;
+	for (int i = 1; i < vertices.size(); ++i)
+	{
+		glm::vec3 position = vertices[i].getPosition();
+		boundsMin = glm::min(boundsMin, position);
+		boundsMax = glm::max(boundsMax, position);
+	}
+
+	// Same sphere as Polyhedron::ComputeBoundingSphere(): around the center of the box.
+	boundingCenter = 0.5f * (boundsMin + boundsMax);
+	boundingRadius = glm::length(boundsMax - boundingCenter);
+}
+
+void MeshComponent::CopyBoundingSphere(Polyhedron* p)
+{
+	if (p->radius > 0.0)
+	{
+		boundingCenter = glm::vec3(p->center);
+		boundingRadius = (float)p->radius;
+	}
+}
+
+void MeshComponent::GetWorldBounds(glm::vec3& min, glm::vec3& max)
+{
+	// Transform the center, then measure how far the rotated box reaches along each axis.
+	glm::vec3 center = 0.5f * (boundsMin + boundsMax);
+	glm::vec3 extent = 0.5f * (boundsMax - boundsMin);
+	glm::vec3 worldCenter = glm::vec3(transform * glm::vec4(center, 1.0f));
+	glm::vec3 worldExtent;
+	for (int i = 0; i < 3; ++i)
+	{
+		worldExtent[i] = std::abs(transform[0][i]) * extent.x + std::abs(transform[1][i]) * extent.y + std::abs(transform[2][i]) * extent.z;
+	}
+	min = worldCenter - worldExtent;
+	max = worldCenter + worldExtent;
+}
+
+void MeshComponent::GetWorldBoundingSphere(glm::vec3& center, float& radius)
+{
+	center = glm::vec3(transform * glm::vec4(boundingCenter, 1.0f));
+
+	// The radius grows with the largest scale factor of the transform.
+	float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+	radius = boundingRadius * scale;
+}
+
+bool MeshComponent::IsLODVisible(glm::vec3 eye)
+{
+	if (lodLevel < 0)
+	{
+		return true;
+	}
+	glm::vec3 center = glm::vec3(transform * glm::vec4(lodCenter, 1.0f));
+	float distance = glm::length(center - eye);
+	return distance >= lodNear && distance < lodFar;
 }
@@ -13,9 +13,9 @@ class Polyhedron;
 // contains data necessary for rendering:
 // * model vertices.
 // * triangle configuration .
-// * vaoID.
-// * vboID: for the vertex data.
+// * allocation: handle to the mesh's ranges in the shared GPU buffers (see GPUMemory).
 // * model transform.
+// * bounding box and bounding sphere, in model space, for culling.
 class MeshComponent
 {
 public:
@@ -33,11 +33,9 @@ public:
 	void AssignHorizonMeasureColors(std::vector<float>& triangleHorizon);
 
 	// getters/setters:
-	uint getVAO();
-	uint getVBO();
+	int getAllocation();
 	uint getCount();
-	void setVAO(uint vaoID);
-	void setVBO(uint vboID);
+	void setAllocation(int allocationID);
 
 	std::vector<Vertex>& getVertices();
 	std::vector<uint>& getTriangles();
@@ -47,8 +45,36 @@ public:
 	
 	void CreateModel(std::vector<Vertex> vertices, std::vector<uint> triangles);
 
+	// Recompute the model-space bounds from the vertices. Call this after editing vertex positions.
+	void ComputeBounds();
+
+	// Use the bounding sphere the polyhedron already computed, in double precision, if it has one.
+	void CopyBoundingSphere(Polyhedron* p);
+
+	// Bounds after applying the model transform.
+	void GetWorldBounds(glm::vec3& min, glm::vec3& max);
+	void GetWorldBoundingSphere(glm::vec3& center, float& radius);
+
 	glm::mat4 transform;
 
+	// Model-space bounds:
+	glm::vec3 boundsMin = glm::vec3(0);
+	glm::vec3 boundsMax = glm::vec3(0);
+	glm::vec3 boundingCenter = glm::vec3(0);
+	float boundingRadius = 0.0f;
+
+	// Where the values of this mesh's triangles start in each ScalarField field, or -1 to use the vertex colors.
+	int fieldOffset = -1;
+
+	// Level of detail, or -1 for meshes that are always drawn.
+	// A level is drawn while lodCenter is at least lodNear and less than lodFar away from the camera.
+	// All levels of a chunk share one model-space lodCenter, so exactly one of them is drawn at any distance.
+	int lodLevel = -1;
+	float lodNear = 0.0f;
+	float lodFar = 0.0f;
+	glm::vec3 lodCenter = glm::vec3(0);
+	bool IsLODVisible(glm::vec3 eye);
+
 private:
 
 	glm::vec3 InterpolateColor(double min, double mean, double max, double value);
@@ -59,7 +85,6 @@ private:
 	std::vector<uint> triangles;
 
 	// OpenGL rendering data:
-	uint vaoID;
-	uint vboID; // Vertex data VBO.
+	int allocationID = -1; // -1 until Loader::PrepareMesh() is called.
 
 };
@@ -124,14 +124,287 @@ MeshComponent MeshFactory::GetNormalizedSquare(float length, uint numPointsPerSi
 	return MeshComponent(vertices, triangles);
 }
 
+float MeshFactory::GetTerrainHeight(PerlinNoise& noise, float x, float z, float height)
+{
+	// A few octaves of noise: broad valleys plus some surface detail.
+	float amplitude = 1.0f;
+	float frequency = 0.35f;
+	float total = 0.0f;
+	for (int octave = 0; octave < 4; ++octave)
+	{
+		total += amplitude * noise.Noise(frequency * x, 0.5f, frequency * z);
+		amplitude *= 0.5f;
+		frequency *= 2.0f;
+	}
+	return height * total;
+}
 
+MeshComponent MeshFactory::GetTerrainChunk(PerlinNoise& noise, int chunkX, int chunkZ, uint numPointsPerSide, float size, float height)
+{
+	std::vector<Vertex> vertices(numPointsPerSide * numPointsPerSide);
+	std::vector<uint> triangles((numPointsPerSide - 1) * (numPointsPerSide - 1) * 6);
+	int triIndex = 0;
 
+	float spacing = size / (numPointsPerSide - 1.0f);
+	float noWater = -std::numeric_limits<float>::max();
 
+	for (int y = 0; y < numPointsPerSide; ++y)
+	{
+		for (int x = 0; x < numPointsPerSide; ++x)
+		{
+			int vertexIndex = x + y * numPointsPerSide;
 
+			// Sample the noise in world space so neighbouring chunks line up.
+			float localX = x * spacing;
+			float localZ = y * spacing;
+			float h = GetTerrainHeight(noise, chunkX * size + localX, chunkZ * size + localZ, height);
+			vertices[vertexIndex] = GetTerrainVertex(noise, chunkX, chunkZ, size, spacing, height, noWater, glm::vec3(localX, h, localZ));
 
+			// Assemble triangles, counterclockwise when seen from above.
+			if (x != numPointsPerSide - 1 && y != numPointsPerSide - 1)
+			{
+				triangles[triIndex + 0] = vertexIndex;
+				triangles[triIndex + 1] = vertexIndex + numPointsPerSide;
+				triangles[triIndex + 2] = vertexIndex + numPointsPerSide + 1;
+				triangles[triIndex + 3] = vertexIndex;
+				triangles[triIndex + 4] = vertexIndex + numPointsPerSide + 1;
+				triangles[triIndex + 5] = vertexIndex + 1;
+				triIndex += 6;
+			}
+		}
+	}
 
+	MeshComponent chunk(vertices, triangles);
+	chunk.transform = glm::translate(glm::mat4(1), glm::vec3(chunkX * size, 0.0f, chunkZ * size));
+	return chunk;
+}
 
+Vertex MeshFactory::GetTerrainVertex(PerlinNoise& noise, int chunkX, int chunkZ, float size, float spacing, float height, float waterLevel, glm::vec3 position)
+{
+	glm::vec4 low = glm::vec4(0.25f, 0.5f, 0.2f, 1.0f);
+	glm::vec4 high = glm::vec4(0.55f, 0.45f, 0.35f, 1.0f);
+	glm::vec4 water = glm::vec4(0.2f, 0.35f, 0.55f, 1.0f);
 
+	float worldX = chunkX * size + position.x;
+	float worldZ = chunkZ * size + position.z;
+	float h = GetTerrainHeight(noise, worldX, worldZ, height);
+
+	Vertex v;
+	v.setPosition(position.x, position.y, position.z);
+	if (h <= waterLevel)
+	{
+		v.setNormal(glm::vec3(0.0f, 1.0f, 0.0f));
+		v.setColor(water);
+	}
+	else
+	{
+		// Normal from central differences of the height function.
+		float dx = GetTerrainHeight(noise, worldX + spacing, worldZ, height) - GetTerrainHeight(noise, worldX - spacing, worldZ, height);
+		float dz = GetTerrainHeight(noise, worldX, worldZ + spacing, height) - GetTerrainHeight(noise, worldX, worldZ - spacing, height);
+		v.setNormal(glm::normalize(glm::vec3(-dx, 2.0f * spacing, -dz)));
+
+		float percent = glm::clamp(0.5f + 0.5f * h / height, 0.0f, 1.0f);
+		v.setColor(low + percent * (high - low));
+	}
+	v.setTexture(position.x / size, position.z / size);
+	v.setBarycentricCoordinate(glm::vec3(1, 1, 1)); // No wireframe edges on shared vertices.
+	v.setHighlightColor(glm::vec4(0, 0, 0, 1));
+	return v;
+}
+
+Polyhedron* MeshFactory::GetSpherePolyhedron(float length, uint numPointsPerSide)
+{
+	MeshComponent sphere = GetSphereTriangles(length, numPointsPerSide);
+	std::vector<Vertex>& vertices = sphere.getVertices();
+	std::vector<uint>& triangles = sphere.getTriangles();
+
+	// Positions closer than 1e-5 are the same vertex; each keeps the index of its first use.
+	std::map<std::array<long, 3>, int> welded;
+	std::vector<int> positions;
+	std::vector<int> indices;
+	for (int i = 0; i < triangles.size(); ++i)
+	{
+		Vertex& v = vertices[triangles[i]];
+		std::array<long, 3> key = {std::lround(v.x * 1e5), std::lround(v.y * 1e5), std::lround(v.z * 1e5)};
+		std::map<std::array<long, 3>, int>::iterator found = welded.find(key);
+		if (found == welded.end())
+		{
+			found = welded.insert(std::make_pair(key, (int)positions.size())).first;
+			positions.push_back(triangles[i]);
+		}
+		indices.push_back(found->second);
+	}
+
+	int faces = indices.size() / 3;
+	Polyhedron* p = new Polyhedron(positions.size(), 3 * faces / 2, faces);
+	for (int i = 0; i < positions.size(); ++i)
+	{
+		Vertex& vertex = vertices[positions[i]];
+		Vert v(vertex.x, vertex.y, vertex.z);
+		v.index = i;
+		p->vlist.push_back(v);
+	}
+	for (int i = 0; i < faces; ++i)
+	{
+		Triangle t;
+		for (int j = 0; j < 3; ++j)
+		{
+			t.vertices[j] = &p->vlist[indices[3 * i + j]];
+		}
+		t.index = i;
+		p->tlist.push_back(t);
+	}
+
+	Corner c;
+	p->clist.assign(3 * p->tlist.size(), c);
+	return p;
+}
+
+Polyhedron* MeshFactory::GetTerrainPolyhedron(PerlinNoise& noise, int chunkX, int chunkZ, uint numPointsPerSide, float size, float height, float waterLevel)
+{
+	int quads = (numPointsPerSide - 1) * (numPointsPerSide - 1);
+	Polyhedron* p = new Polyhedron(numPointsPerSide * numPointsPerSide, 3 * quads + 2 * (numPointsPerSide - 1), 2 * quads);
+	float spacing = size / (numPointsPerSide - 1.0f);
+
+	for (int y = 0; y < numPointsPerSide; ++y)
+	{
+		for (int x = 0; x < numPointsPerSide; ++x)
+		{
+			float localX = x * spacing;
+			float localZ = y * spacing;
+			float h = GetTerrainHeight(noise, chunkX * size + localX, chunkZ * size + localZ, height);
+			Vert v(localX, std::max(h, waterLevel), localZ);
+			v.index = p->vlist.size();
+			p->vlist.push_back(v);
+		}
+	}
+
+	// Same triangles as GetTerrainChunk().
+	for (int y = 0; y < numPointsPerSide - 1; ++y)
+	{
+		for (int x = 0; x < numPointsPerSide - 1; ++x)
+		{
+			int vertexIndex = x + y * numPointsPerSide;
+			int corners[6] = { vertexIndex, vertexIndex + (int)numPointsPerSide, vertexIndex + (int)numPointsPerSide + 1,
+							   vertexIndex, vertexIndex + (int)numPointsPerSide + 1, vertexIndex + 1 };
+			for (int k = 0; k < 2; ++k)
+			{
+				Triangle t;
+				for (int j = 0; j < 3; ++j)
+				{
+					t.vertices[j] = &p->vlist[corners[3 * k + j]];
+				}
+				t.index = p->tlist.size();
+				p->tlist.push_back(t);
+			}
+		}
+	}
+
+	Corner c;
+	p->clist.assign(3 * p->tlist.size(), c);
+	return p;
+}
+
+std::vector<MeshComponent> MeshFactory::GetTerrainChunkLODs(PerlinNoise& noise, int chunkX, int chunkZ, uint numPointsPerSide, float size, float height, float waterLevel, int levels, double maxError)
+{
+	float spacing = size / (numPointsPerSide - 1.0f);
+	Polyhedron* p = GetTerrainPolyhedron(noise, chunkX, chunkZ, numPointsPerSide, size, height, waterLevel);
+
+	// Triangles that lie completely on the water are water; the shore and everything above it is ground.
+	DecimationSettings settings;
+	settings.lockBoundary = true;
+	settings.maxError = maxError;
+	for (int i = 0; i < p->tlist.size(); ++i)
+	{
+		Triangle& t = p->tlist[i];
+		bool water = t.vertices[0]->y <= waterLevel && t.vertices[1]->y <= waterLevel && t.vertices[2]->y <= waterLevel;
+		settings.triangleMaterials.push_back(water ? TERRAIN_WATER : TERRAIN_GROUND);
+	}
+
+	std::vector<MeshComponent> lods;
+	lods.push_back(GetTerrainMesh(noise, p, chunkX, chunkZ, size, spacing, height, waterLevel));
+	std::vector<DecimatedMesh> chain = Decimation::GetLODChain(p, settings, levels - 1, 0.25);
+	for (int i = 0; i < chain.size(); ++i)
+	{
+		lods.push_back(GetTerrainMesh(noise, chain[i].polyhedron, chunkX, chunkZ, size, spacing, height, waterLevel));
+		delete chain[i].polyhedron;
+	}
+	delete p;
+
+	// Every level is picked by its distance to the center of the finest one. The decimated levels have bounding spheres of their own,
+	// and measuring each from its own center could show two levels of a chunk, or none, near the distance between them.
+	for (int i = 0; i < lods.size(); ++i)
+	{
+		lods[i].lodLevel = i;
+		lods[i].lodCenter = lods[0].boundingCenter;
+	}
+	return lods;
+}
+
+MeshComponent MeshFactory::GetTerrainMesh(PerlinNoise& noise, Polyhedron* p, int chunkX, int chunkZ, float size, float spacing, float height, float waterLevel)
+{
+	std::vector<Vertex> vertices(p->vlist.size());
+	std::vector<uint> triangles(3 * p->tlist.size());
+	for (int i = 0; i < p->vlist.size(); ++i)
+	{
+		Vert& v = p->vlist[i];
+		vertices[i] = GetTerrainVertex(noise, chunkX, chunkZ, size, spacing, height, waterLevel, glm::vec3(v.x, v.y, v.z));
+	}
+	for (int i = 0; i < p->tlist.size(); ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			triangles[3 * i + j] = p->tlist[i].vertices[j]->index;
+		}
+	}
+
+	MeshComponent chunk(vertices, triangles);
+	chunk.transform = glm::translate(glm::mat4(1), glm::vec3(chunkX * size, 0.0f, chunkZ * size));
+	return chunk;
+}
+
+
+
+
+
+
+
+
+
+MeshComponent MeshFactory::GetTriangleMesh(Polyhedron* p, glm::vec4 color)
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint> triangles;
+	vertices.reserve(3 * p->tlist.size());
+	triangles.reserve(3 * p->tlist.size());
+
+	for (int i = 0; i < p->tlist.size(); ++i)
+	{
+		Triangle& t = p->tlist[i];
+		for (int j = 0; j < 3; ++j)
+		{
+			Vertex v;
+			Vert* current = t.vertices[j];
+			v.setPosition((float)current->x, (float)current->y, (float)current->z);
+			v.setColor(color.x, color.y, color.z, color.w);
+			v.setNormal((float)current->normal.x, (float)current->normal.y, (float)current->normal.z);
+			v.setTexture(0, 0);
+			v.setHighlightColor(glm::vec4(0, 0, 0, 1));
+
+			// Barycentric coordinate for wireframe shader.
+			glm::vec3 barycentric = glm::vec3(0);
+			barycentric[j] = 1.0f;
+			v.setBarycentricCoordinate(barycentric);
+
+			triangles.push_back(vertices.size());
+			vertices.push_back(v);
+		}
+	}
+
+	MeshComponent mesh = MeshComponent(vertices, triangles);
+	mesh.CopyBoundingSphere(p);
+	return mesh;
+}
 
 MeshFactory::MeshFactory() {}
 MeshFactory::~MeshFactory() {}
@@ -1,8 +1,15 @@
 #pragma once
 
+#include <map>
+#include <array>
+#include <cmath>
+
 #include "utilities.hpp"
 #include "meshcomponent.hpp"
+#include "perlinnoise.hpp"
+#include "decimation.hpp"
 #include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
 
 // Create meshes.
 class MeshFactory
@@ -16,8 +23,39 @@ public:
 	static std::vector<MeshComponent> GetSphere(float length, uint numPointsPerSide);
 	static MeshComponent GetSphereTriangles(float length, uint numPointsPerSide);
 
+	// The sphere of GetSphereTriangles() as a closed polyhedron: the triangles there have vertices of their own, and the faces
+	// of the cube meet along shared positions, so vertices at the same position are welded. Call Initialize() for the adjacency.
+	static Polyhedron* GetSpherePolyhedron(float length, uint numPointsPerSide);
+
+	// Terrain: a square heightfield chunk of the given side length sampled from Perlin noise.
+	// The chunk's vertices are local to the chunk; its transform places it at (chunkX, chunkZ) in the chunk grid.
+	static MeshComponent GetTerrainChunk(PerlinNoise& noise, int chunkX, int chunkZ, uint numPointsPerSide, float size, float height);
+	static float GetTerrainHeight(PerlinNoise& noise, float x, float z, float height);
+
+	// The same heightfield as a polyhedron, with the ground below waterLevel flattened into water.
+	// Only the vertex and triangle lists are filled in; call Initialize() for the adjacency.
+	static Polyhedron* GetTerrainPolyhedron(PerlinNoise& noise, int chunkX, int chunkZ, uint numPointsPerSide, float size, float height, float waterLevel);
+
+	// Levels of detail of a terrain chunk with water, finest first. Every level after the first has about a quarter of the
+	// triangles of the one before, unless maxError is reached first. Chunk edges and shorelines are kept,
+	// so chunks at different levels still meet without cracks.
+	static std::vector<MeshComponent> GetTerrainChunkLODs(PerlinNoise& noise, int chunkX, int chunkZ, uint numPointsPerSide, float size, float height, float waterLevel, int levels, double maxError);
+
+	// Materials of terrain triangles, for decimation.
+	static constexpr int TERRAIN_GROUND = 0;
+	static constexpr int TERRAIN_WATER = 1;
+
+	// One set of three vertices per triangle of the polyhedron, in tlist order, all in the given color.
+	// Triangle i of the polyhedron is primitive i of the mesh, so per-triangle values can be looked up with gl_PrimitiveID.
+	static MeshComponent GetTriangleMesh(Polyhedron* p, glm::vec4 color);
+
 private:
 
+	// A vertex of a terrain chunk at the given position in the chunk, with the normal and color of the heightfield there.
+	static Vertex GetTerrainVertex(PerlinNoise& noise, int chunkX, int chunkZ, float size, float spacing, float height, float waterLevel, glm::vec3 position);
+
+	// A mesh of a terrain polyhedron, placed at (chunkX, chunkZ).
+	static MeshComponent GetTerrainMesh(PerlinNoise& noise, Polyhedron* p, int chunkX, int chunkZ, float size, float spacing, float height, float waterLevel);
 
 	MeshFactory();
 	~MeshFactory();
@@ -0,0 +1,646 @@
+#include "meshreader.hpp"
+
+bool MeshReader::Read(std::string file, Polyhedron* p, std::ostream& log)
+{
+	PROFILE_SCOPE("MeshReader::Read");
+	// Check to see if the file can be opened.
+	int descriptor = open(file.c_str(), O_RDONLY);
+	struct stat status;
+	if (descriptor == -1 || fstat(descriptor, &status) != 0 || status.st_size == 0)
+	{
+		if (descriptor != -1)
+		{
+			close(descriptor);
+		}
+		log << "FILE " << file << " COULD NOT BE OPENED." << std::endl;
+		return false;
+	}
+	size_t size = status.st_size;
+	void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	close(descriptor);
+	if (mapping == MAP_FAILED)
+	{
+		log << "FILE " << file << " COULD NOT BE OPENED." << std::endl;
+		return false;
+	}
+	madvise(mapping, size, MADV_WILLNEED);
+	const char* begin = (const char*)mapping;
+	const char* end = begin + size;
+
+	bool obj = file.size() >= 4 && file.compare(file.size() - 4, 4, ".obj") == 0;
+	PLYHeader header;
+	const char* body = begin;
+	if (!obj)
+	{
+		body = ReadPLYHeader(begin, end, header, log);
+		if (body == NULL)
+		{
+			munmap(mapping, size);
+			return false;
+		}
+		if (header.binary)
+		{
+			bool read = ReadBinaryPLY(body, end, header, p, file, log);
+			munmap(mapping, size);
+			if (read)
+			{
+				Corner c;
+				p->clist.assign(3 * p->tlist.size(), c);
+			}
+			return read;
+		}
+	}
+	int vertices = header.vertices;
+
+	// First pass: where every chunk's lines and vertices go.
+	std::vector<ParseChunk> chunks = Split(body, end);
+	Parallel::For(0, chunks.size(), 1, [&](int b, int e)
+	{
+		for (int c = b; c < e; ++c)
+		{
+			ParseChunk& chunk = chunks[c];
+			const char* text = chunk.begin;
+			while (text < chunk.end)
+			{
+				const char* newline = (const char*)memchr(text, '\n', chunk.end - text);
+				const char* next = newline ? newline + 1 : chunk.end;
+				if (obj && IsOBJVertex(text, next))
+				{
+					chunk.vertices++;
+				}
+				chunk.lines++;
+				text = next;
+			}
+		}
+	});
+	int lines = 0;
+	int objVertices = 0;
+	for (int c = 0; c < chunks.size(); ++c)
+	{
+		chunks[c].firstLine = lines;
+		chunks[c].firstVertex = objVertices;
+		lines += chunks[c].lines;
+		objVertices += chunks[c].vertices;
+	}
+	if (obj)
+	{
+		vertices = objVertices;
+	}
+	else if (lines < header.vertexLine + vertices || lines < header.faceLine + header.faces)
+	{
+		munmap(mapping, size);
+		log << "ERROR READING VERTEX/FACE INFO OF " << file << "." << std::endl;
+		return false;
+	}
+
+	// Second pass: every vertex goes straight to its place, and every chunk keeps its own triangles.
+	p->vlist.assign(vertices, Vert());
+	Parallel::For(0, chunks.size(), 1, [&](int b, int e)
+	{
+		for (int c = b; c < e; ++c)
+		{
+			if (obj)
+			{
+				ParseOBJChunk(chunks[c], p);
+			}
+			else
+			{
+				ParsePLYChunk(chunks[c], p, header);
+			}
+		}
+	});
+	for (int c = 0; c < chunks.size(); ++c)
+	{
+		if (chunks[c].errorLine != -1)
+		{
+			// Count the header lines too, so the number matches the file.
+			int headerLines = std::count(begin, body, '\n');
+			munmap(mapping, size);
+			log << "ERROR READING LINE " << headerLines + chunks[c].errorLine + 1 << " OF " << file << "." << std::endl;
+			p->vlist.clear();
+			return false;
+		}
+	}
+	munmap(mapping, size);
+
+	JoinTriangles(chunks, p);
+
+	Corner c;
+	p->clist.assign(3 * p->tlist.size(), c);
+	return true;
+}
+
+const char* MeshReader::ReadPLYHeader(const char* begin, const char* end, PLYHeader& header, std::ostream& log)
+{
+	// Check to see if the first line of the file is "ply".
+	if (end - begin < 3 || strncmp(begin, "ply", 3) != 0)
+	{
+		log << "NOT A .PLY FILE." << std::endl;
+		return NULL;
+	}
+
+	// Go through the header to collect the elements, their counts and their properties.
+	struct Element
+	{
+		std::string name;
+		int count;
+		std::vector<PLYProperty> properties;
+	};
+	std::vector<Element> elements;
+	std::string format;
+	bool ended = false;
+	const char* text = begin;
+	while (text < end)
+	{
+		const char* lineEnd = LineEnd(text, end);
+		std::string line(text, lineEnd);
+		text = (lineEnd < end && *lineEnd == '\r') ? lineEnd + 1 : lineEnd;
+		text = (text < end) ? text + 1 : end;
+
+		std::istringstream words(line);
+		std::string word;
+		words >> word;
+		if (word == "format")
+		{
+			words >> format;
+		}
+		else if (word == "element")
+		{
+			Element element;
+			std::string count;
+			words >> element.name >> count;
+			const char* number = count.c_str();
+			if (!ParseNumber(number, number + count.size(), element.count) || element.count < 0)
+			{
+				log << "ERROR READING VERTEX/FACE INFO." << std::endl;
+				return NULL;
+			}
+			elements.push_back(element);
+		}
+		else if (word == "property" && !elements.empty())
+		{
+			PLYProperty property;
+			std::string type;
+			words >> type;
+			if (type == "list")
+			{
+				std::string countType;
+				words >> countType >> type;
+				property.list = true;
+				property.countType = GetType(countType);
+			}
+			property.type = GetType(type);
+			words >> property.name;
+			elements.back().properties.push_back(property);
+		}
+		else if (word == "end_header")
+		{
+			ended = true;
+			break;
+		}
+	}
+	if (!ended)
+	{
+		log << "ERROR READING VERTEX/FACE INFO." << std::endl;
+		return NULL;
+	}
+	if (format != "ascii" && format != "binary_little_endian")
+	{
+		log << "ONLY ASCII AND BINARY LITTLE ENDIAN .PLY FILES CAN BE READ." << std::endl;
+		return NULL;
+	}
+	header.binary = (format == "binary_little_endian");
+
+	// Find the vertices and the faces: by line in an ASCII body, by byte in a binary one.
+	int bodyLine = 0;
+	size_t bodyBytes = 0;
+	bool fixedSize = true;
+	bool foundVertices = false;
+	for (int e = 0; e < elements.size(); ++e)
+	{
+		Element& element = elements[e];
+		if (element.name == "vertex" || element.name == "face")
+		{
+			if (header.binary && !fixedSize)
+			{
+				log << "ERROR READING VERTEX/FACE INFO: ELEMENTS OF VARYING SIZE COME FIRST." << std::endl;
+				return NULL;
+			}
+			if (element.name == "vertex")
+			{
+				header.vertices = element.count;
+				header.vertexLine = bodyLine;
+				header.vertexStart = bodyBytes;
+				header.vertexProperties = element.properties;
+				foundVertices = true;
+			}
+			else
+			{
+				header.faces = element.count;
+				header.faceLine = bodyLine;
+				header.faceStart = bodyBytes;
+				header.faceProperties = element.properties;
+			}
+		}
+		size_t recordSize = 0;
+		for (int i = 0; i < element.properties.size(); ++i)
+		{
+			PLYProperty& property = element.properties[i];
+			if (header.binary && (property.type == PLYType::UNKNOWN || (property.list && property.countType == PLYType::UNKNOWN)))
+			{
+				log << "UNKNOWN TYPE OF PROPERTY " << property.name << "." << std::endl;
+				return NULL;
+			}
+			fixedSize = fixedSize && !property.list;
+			recordSize += GetTypeSize(property.type);
+		}
+		bodyLine += element.count;
+		bodyBytes += (size_t)element.count * recordSize;
+	}
+
+	// x, y and z, which must have a fixed size in a binary vertex; every other vertex property is skipped.
+	for (int i = 0; i < header.vertexProperties.size(); ++i)
+	{
+		const std::string& name = header.vertexProperties[i].name;
+		if (name == "x" || name == "y" || name == "z")
+		{
+			header.propertyIndex[name[0] - 'x'] = i;
+		}
+		if (header.binary && header.vertexProperties[i].list)
+		{
+			log << "ERROR READING VERTEX/FACE INFO: VERTICES OF VARYING SIZE." << std::endl;
+			return NULL;
+		}
+	}
+	if (!foundVertices || header.propertyIndex[0] == -1 || header.propertyIndex[1] == -1 || header.propertyIndex[2] == -1)
+	{
+		log << "ERROR READING VERTEX/FACE INFO." << std::endl;
+		return NULL;
+	}
+	return text;
+}
+
+bool MeshReader::ReadBinaryPLY(const char* body, const char* end, const PLYHeader& header, Polyhedron* p, const std::string& file, std::ostream& log)
+{
+	// Where x, y and z are in a vertex, and how big a vertex is.
+	size_t vertexSize = 0;
+	size_t offset[3];
+	PLYType type[3];
+	for (int i = 0; i < header.vertexProperties.size(); ++i)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			if (header.propertyIndex[k] == i)
+			{
+				offset[k] = vertexSize;
+				type[k] = header.vertexProperties[i].type;
+			}
+		}
+		vertexSize += GetTypeSize(header.vertexProperties[i].type);
+	}
+	if (header.vertexStart + (size_t)header.vertices * vertexSize > (size_t)(end - body) || header.faceStart > (size_t)(end - body))
+	{
+		log << "ERROR READING VERTEX/FACE INFO OF " << file << "." << std::endl;
+		return false;
+	}
+
+	// Every vertex straight into its place.
+	p->vlist.assign(header.vertices, Vert());
+	const char* vertices = body + header.vertexStart;
+	Parallel::For(0, header.vertices, 4096, [&](int b, int e)
+	{
+		for (int i = b; i < e; ++i)
+		{
+			const char* record = vertices + i * vertexSize;
+			Vert& v = p->vlist[i];
+			v.x = GetValue(record + offset[0], type[0]);
+			v.y = GetValue(record + offset[1], type[1]);
+			v.z = GetValue(record + offset[2], type[2]);
+			v.index = i;
+		}
+	});
+
+	// The vertex indices are the list called vertex_indices (or vertex_index); other face properties are skipped.
+	int indexProperty = -1;
+	for (int i = 0; i < header.faceProperties.size(); ++i)
+	{
+		const PLYProperty& property = header.faceProperties[i];
+		if (property.list && (property.name == "vertex_indices" || property.name == "vertex_index"))
+		{
+			indexProperty = i;
+		}
+	}
+	if (header.faces > 0 && indexProperty == -1)
+	{
+		log << "ERROR READING VERTEX/FACE INFO OF " << file << "." << std::endl;
+		return false;
+	}
+
+	// Faces, split into triangles around their first vertex like the ASCII ones.
+	std::vector<ParseChunk> chunks(1);
+	std::vector<int>& triangles = chunks[0].triangles;
+	triangles.reserve(3 * (size_t)header.faces);
+	const char* data = body + header.faceStart;
+	for (int f = 0; f < header.faces; ++f)
+	{
+		for (int i = 0; i < header.faceProperties.size(); ++i)
+		{
+			const PLYProperty& property = header.faceProperties[i];
+			size_t size = GetTypeSize(property.type);
+			size_t countSize = property.list ? GetTypeSize(property.countType) : 0;
+			if ((size_t)(end - data) < countSize)
+			{
+				log << "ERROR READING FACE " << f + 1 << " OF " << file << "." << std::endl;
+				return false;
+			}
+			double count = property.list ? GetValue(data, property.countType) : 1.0;
+			data += countSize;
+			if (count < 0.0 || (size_t)(end - data) < (size_t)count * size || (i == indexProperty && count < 3.0))
+			{
+				log << "ERROR READING FACE " << f + 1 << " OF " << file << "." << std::endl;
+				return false;
+			}
+			if (i != indexProperty)
+			{
+				data += (size_t)count * size;
+				continue;
+			}
+			int index[3];
+			for (int k = 0; k < (int)count; ++k)
+			{
+				int j = std::min(k, 2);
+				double value = GetValue(data, property.type);
+				data += size;
+				if (value < 0.0 || value >= header.vertices)
+				{
+					log << "ERROR READING FACE " << f + 1 << " OF " << file << "." << std::endl;
+					return false;
+				}
+				index[j] = (int)value;
+				if (k >= 2)
+				{
+					triangles.push_back(index[0]);
+					triangles.push_back(index[1]);
+					triangles.push_back(index[2]);
+					index[1] = index[2];
+				}
+			}
+		}
+	}
+
+	JoinTriangles(chunks, p);
+	return true;
+}
+
+PLYType MeshReader::GetType(const std::string& name)
+{
+	if (name == "char" || name == "int8") return PLYType::INT8;
+	if (name == "uchar" || name == "uint8") return PLYType::UINT8;
+	if (name == "short" || name == "int16") return PLYType::INT16;
+	if (name == "ushort" || name == "uint16") return PLYType::UINT16;
+	if (name == "int" || name == "int32") return PLYType::INT32;
+	if (name == "uint" || name == "uint32") return PLYType::UINT32;
+	if (name == "float" || name == "float32") return PLYType::FLOAT32;
+	if (name == "double" || name == "float64") return PLYType::FLOAT64;
+	return PLYType::UNKNOWN;
+}
+
+size_t MeshReader::GetTypeSize(PLYType type)
+{
+	switch (type)
+	{
+		case PLYType::INT8: case PLYType::UINT8: return 1;
+		case PLYType::INT16: case PLYType::UINT16: return 2;
+		case PLYType::INT32: case PLYType::UINT32: case PLYType::FLOAT32: return 4;
+		case PLYType::FLOAT64: return 8;
+		default: return 0;
+	}
+}
+
+double MeshReader::GetValue(const char* data, PLYType type)
+{
+	// Little endian, like the machines this runs on; memcpy because the records are not aligned.
+	switch (type)
+	{
+		case PLYType::INT8: { int8_t value; memcpy(&value, data, 1); return value; }
+		case PLYType::UINT8: { uint8_t value; memcpy(&value, data, 1); return value; }
+		case PLYType::INT16: { int16_t value; memcpy(&value, data, 2); return value; }
+		case PLYType::UINT16: { uint16_t value; memcpy(&value, data, 2); return value; }
+		case PLYType::INT32: { int32_t value; memcpy(&value, data, 4); return value; }
+		case PLYType::UINT32: { uint32_t value; memcpy(&value, data, 4); return value; }
+		case PLYType::FLOAT32: { float value; memcpy(&value, data, 4); return value; }
+		case PLYType::FLOAT64: { double value; memcpy(&value, data, 8); return value; }
+		default: return 0.0;
+	}
+}
+
+std::vector<ParseChunk> MeshReader::Split(const char* begin, const char* end)
+{
+	std::vector<ParseChunk> chunks;
+	const char* text = begin;
+	while (text < end)
+	{
+		ParseChunk chunk;
+		chunk.begin = text;
+		const char* cut = end;
+		if (end - text > PARSE_CHUNK_SIZE)
+		{
+			const char* newline = (const char*)memchr(text + PARSE_CHUNK_SIZE, '\n', end - text - PARSE_CHUNK_SIZE);
+			cut = newline ? newline + 1 : end;
+		}
+		chunk.end = cut;
+		chunks.push_back(chunk);
+		text = cut;
+	}
+	return chunks;
+}
+
+void MeshReader::ParsePLYChunk(ParseChunk& chunk, Polyhedron* p, const PLYHeader& header)
+{
+	int vertices = header.vertices;
+	int faces = header.faces;
+	int vertexLine = header.vertexLine;
+	int faceLine = header.faceLine;
+	const int* propertyIndex = header.propertyIndex;
+	int lastProperty = std::max(propertyIndex[0], std::max(propertyIndex[1], propertyIndex[2]));
+	const char* text = chunk.begin;
+	int line = chunk.firstLine;
+	while (text < chunk.end)
+	{
+		const char* lineEnd = LineEnd(text, chunk.end);
+
+		// Vertex:
+		if (line >= vertexLine && line < vertexLine + vertices)
+		{
+			double position[3];
+			const char* number = text;
+			for (int k = 0; k <= lastProperty; ++k)
+			{
+				double value;
+				if (!ParseNumber(number, lineEnd, value))
+				{
+					chunk.errorLine = line;
+					return;
+				}
+				for (int i = 0; i < 3; ++i)
+				{
+					if (propertyIndex[i] == k)
+					{
+						position[i] = value;
+					}
+				}
+			}
+			Vert& v = p->vlist[line - vertexLine];
+			v.x = position[0];
+			v.y = position[1];
+			v.z = position[2];
+			v.index = line - vertexLine;
+		}
+		// Face, split into triangles around its first vertex:
+		else if (line >= faceLine && line < faceLine + faces)
+		{
+			const char* number = text;
+			int n;
+			int index[3];
+			if (!ParseNumber(number, lineEnd, n) || n < 3)
+			{
+				chunk.errorLine = line;
+				return;
+			}
+			for (int k = 0; k < n; ++k)
+			{
+				int i = std::min(k, 2);
+				if (!ParseNumber(number, lineEnd, index[i]) || index[i] < 0 || index[i] >= vertices)
+				{
+					chunk.errorLine = line;
+					return;
+				}
+				if (k >= 2)
+				{
+					chunk.triangles.push_back(index[0]);
+					chunk.triangles.push_back(index[1]);
+					chunk.triangles.push_back(index[2]);
+					index[1] = index[2];
+				}
+			}
+		}
+
+		text = (lineEnd < chunk.end) ? (const char*)memchr(lineEnd, '\n', chunk.end - lineEnd) : NULL;
+		text = text ? text + 1 : chunk.end;
+		++line;
+	}
+}
+
+void MeshReader::ParseOBJChunk(ParseChunk& chunk, Polyhedron* p)
+{
+	int vertices = p->vlist.size();
+	int vertex = chunk.firstVertex;
+	const char* text = chunk.begin;
+	int line = chunk.firstLine;
+	while (text < chunk.end)
+	{
+		const char* lineEnd = LineEnd(text, chunk.end);
+
+		// Vertex: "v x y z", possibly followed by a weight or a color, which are not used.
+		if (IsOBJVertex(text, lineEnd))
+		{
+			const char* number = text + 1;
+			Vert& v = p->vlist[vertex];
+			if (!ParseNumber(number, lineEnd, v.x) || !ParseNumber(number, lineEnd, v.y) || !ParseNumber(number, lineEnd, v.z))
+			{
+				chunk.errorLine = line;
+				return;
+			}
+			v.index = vertex;
+			vertex++;
+		}
+		// Face: "f a b c ...", where every corner may also be a/t, a/t/n or a//n, and negative indices count back from the last vertex.
+		else if (lineEnd - text > 1 && text[0] == 'f' && (text[1] == ' ' || text[1] == '\t'))
+		{
+			const char* number = text + 1;
+			int index[3];
+			int k = 0;
+			int value;
+			while (ParseNumber(number, lineEnd, value))
+			{
+				int i = std::min(k, 2);
+				index[i] = (value > 0) ? value - 1 : vertex + value;
+				if (value == 0 || index[i] < 0 || index[i] >= vertices)
+				{
+					chunk.errorLine = line;
+					return;
+				}
+				if (k >= 2)
+				{
+					chunk.triangles.push_back(index[0]);
+					chunk.triangles.push_back(index[1]);
+					chunk.triangles.push_back(index[2]);
+					index[1] = index[2];
+				}
+				++k;
+
+				// Skip the texture coordinate and normal indices.
+				while (number < lineEnd && *number != ' ' && *number != '\t')
+				{
+					++number;
+				}
+			}
+			if (k < 3)
+			{
+				chunk.errorLine = line;
+				return;
+			}
+		}
+		// Everything else (comments, normals, texture coordinates, groups, materials) is not needed.
+
+		text = (lineEnd < chunk.end) ? (const char*)memchr(lineEnd, '\n', chunk.end - lineEnd) : NULL;
+		text = text ? text + 1 : chunk.end;
+		++line;
+	}
+}
+
+void MeshReader::JoinTriangles(std::vector<ParseChunk>& chunks, Polyhedron* p)
+{
+	std::vector<int> firstTriangle(chunks.size());
+	int triangles = 0;
+	for (int c = 0; c < chunks.size(); ++c)
+	{
+		firstTriangle[c] = triangles;
+		triangles += chunks[c].triangles.size() / 3;
+	}
+
+	p->tlist.assign(triangles, Triangle());
+	Parallel::For(0, chunks.size(), 1, [&](int b, int e)
+	{
+		for (int c = b; c < e; ++c)
+		{
+			std::vector<int>& indices = chunks[c].triangles;
+			for (int i = 0; i < indices.size() / 3; ++i)
+			{
+				Triangle& t = p->tlist[firstTriangle[c] + i];
+				t.index = firstTriangle[c] + i;
+				for (int j = 0; j < 3; ++j)
+				{
+					t.vertices[j] = &p->vlist[indices[3 * i + j]];
+				}
+			}
+			std::vector<int>().swap(indices);
+		}
+	});
+}
+
+bool MeshReader::IsOBJVertex(const char* text, const char* end)
+{
+	return end - text > 1 && text[0] == 'v' && (text[1] == ' ' || text[1] == '\t');
+}
+
+const char* MeshReader::LineEnd(const char* text, const char* end)
+{
+	const char* newline = (const char*)memchr(text, '\n', end - text);
+	const char* lineEnd = newline ? newline : end;
+	if (lineEnd > text && lineEnd[-1] == '\r')
+	{
+		--lineEnd;
+	}
+	return lineEnd;
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <charconv>
+#include <cstring>
+#include <algorithm>
+#include <sstream>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "polyhedron.hpp"
+#include "parallel.hpp"
+#include "profiler.hpp"
+
+/** Type of a property in a binary .ply file. */
+enum class PLYType
+{
+	INT8,
+	UINT8,
+	INT16,
+	UINT16,
+	INT32,
+	UINT32,
+	FLOAT32,
+	FLOAT64,
+	UNKNOWN
+};
+
+// A property of an element of a .ply file. Lists have the type of their count and the type of their values.
+struct PLYProperty
+{
+	std::string name;
+	PLYType type = PLYType::UNKNOWN;
+	bool list = false;
+	PLYType countType = PLYType::UNKNOWN;
+};
+
+// What the header of a .ply file says about its body.
+struct PLYHeader
+{
+	bool binary = false;
+	int vertices = 0;
+	int faces = 0;
+
+	// ASCII: the line of the body the vertices and the faces start on, and the position of x, y and z among the vertex properties.
+	int vertexLine = 0;
+	int faceLine = 0;
+	int propertyIndex[3] = {-1, -1, -1};
+
+	// Binary: the properties of a vertex and of a face, and the bytes of the body before the vertices and before the faces.
+	// The elements in front of the faces must have a fixed size, which is all this reader needs to find them.
+	std::vector<PLYProperty> vertexProperties;
+	std::vector<PLYProperty> faceProperties;
+	size_t vertexStart = 0;
+	size_t faceStart = 0;
+};
+
+// A piece of the body of a mesh file, always a whole number of lines.
+struct ParseChunk
+{
+	const char* begin;
+	const char* end;
+
+	// Counted by the first pass: lines in the chunk, and OBJ vertex lines.
+	int lines = 0;
+	int vertices = 0;
+
+	// Filled in from the counts: the first line and the first vertex of the chunk in the whole file.
+	int firstLine = 0;
+	int firstVertex = 0;
+
+	// Three vertex indices per triangle, from the second pass. Polygons are split into fans.
+	std::vector<int> triangles;
+
+	// Line of the first error in this chunk, or -1.
+	int errorLine = -1;
+};
+
+/** Static class to read .ply (ASCII or binary_little_endian, as MeshWriter writes them) and ASCII .obj files into a Polyhedron.
+ *
+ * The file is memory mapped and its body cut into chunks of about PARSE_CHUNK_SIZE bytes at line breaks.
+ * A first pass counts the lines (and OBJ vertices) of every chunk, so each chunk knows where its lines and vertices go;
+ * a second pass parses the chunks at the same time, with std::from_chars instead of a std::string per token.
+ * Vertices are written straight into place, and the triangles of the chunks are joined in file order.
+ * Binary .ply vertices have a fixed size and are read in parallel too; faces can have any number of vertices,
+ * so they are read one after the other. */
+class MeshReader
+{
+
+public:
+
+	// Fill the vertex, triangle and corner lists of p from a .ply or, by extension, an .obj file.
+	// Returns false, with the reason printed to log, if the file cannot be read; p is then left without vertices or triangles.
+	static bool Read(std::string file, Polyhedron* p, std::ostream& log = std::cout);
+
+private:
+
+	MeshReader();
+	~MeshReader();
+
+	// Where the vertices and the faces are in the body and what their properties are.
+	// Returns where the body starts, or NULL, with the reason printed to log, if the header cannot be read.
+	static const char* ReadPLYHeader(const char* begin, const char* end, PLYHeader& header, std::ostream& log);
+
+	// Read the body of a binary .ply into p. Returns false, with the reason printed to log, if it is cut short or has bad indices.
+	static bool ReadBinaryPLY(const char* body, const char* end, const PLYHeader& header, Polyhedron* p, const std::string& file, std::ostream& log);
+
+	// Size in bytes and value of a binary property; GetType() is UNKNOWN for a name that is not a .ply type.
+	static PLYType GetType(const std::string& name);
+	static size_t GetTypeSize(PLYType type);
+	static double GetValue(const char* data, PLYType type);
+
+	// Cut [begin, end) into chunks at line breaks.
+	static std::vector<ParseChunk> Split(const char* begin, const char* end);
+
+	// Parse one chunk of the body. PLY lines are vertices or faces by their line number; OBJ lines by their first word.
+	static void ParsePLYChunk(ParseChunk& chunk, Polyhedron* p, const PLYHeader& header);
+	static void ParseOBJChunk(ParseChunk& chunk, Polyhedron* p);
+
+	// Move the triangles of every chunk into p, in order.
+	static void JoinTriangles(std::vector<ParseChunk>& chunks, Polyhedron* p);
+
+	// Skip spaces and parse a number, moving text past it. Returns false if there is no number.
+	template <typename T>
+	static bool ParseNumber(const char*& text, const char* end, T& value)
+	{
+		while (text < end && (*text == ' ' || *text == '\t'))
+		{
+			++text;
+		}
+		if (text < end && *text == '+')
+		{
+			++text;
+		}
+		std::from_chars_result result = std::from_chars(text, end, value);
+		if (result.ec != std::errc())
+		{
+			return false;
+		}
+		text = result.ptr;
+		return true;
+	}
+
+	// Whether the line at text is an OBJ vertex, "v x y z".
+	static bool IsOBJVertex(const char* text, const char* end);
+
+	// End of the line starting at text, not counting a '\r'.
+	static const char* LineEnd(const char* text, const char* end);
+
+	// Bytes per chunk. Big enough that a chunk takes much longer to parse than to hand out.
+	static const size_t PARSE_CHUNK_SIZE = 1 << 20;
+
+};
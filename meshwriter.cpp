@@ -0,0 +1,139 @@
+#include "meshwriter.hpp"
+
+bool MeshWriter::WritePLY(std::string path, Polyhedron* p)
+{
+	PROFILE_SCOPE("MeshWriter::WritePLY");
+	StreamWriter writer;
+	if (!writer.Open(path))
+	{
+		return false;
+	}
+	WriteHeader(writer, p->vlist.size(), p->tlist.size(), false);
+
+	writer.WriteOrdered(p->vlist.size(), WRITER_GRAIN, [&](int begin, int end, std::vector<char>& out)
+	{
+		out.reserve((end - begin) * 6 * sizeof(float));
+		for (int i = begin; i < end; ++i)
+		{
+			Vert& v = p->vlist[i];
+			Append<float>(out, v.x);
+			Append<float>(out, v.y);
+			Append<float>(out, v.z);
+			Append<float>(out, v.normal.x);
+			Append<float>(out, v.normal.y);
+			Append<float>(out, v.normal.z);
+		}
+	});
+	writer.WriteOrdered(p->tlist.size(), WRITER_GRAIN, [&](int begin, int end, std::vector<char>& out)
+	{
+		out.reserve((end - begin) * (1 + 3 * sizeof(int32_t)));
+		for (int i = begin; i < end; ++i)
+		{
+			Triangle& t = p->tlist[i];
+			Append<uint8_t>(out, 3);
+			for (int j = 0; j < 3; ++j)
+			{
+				Append<int32_t>(out, t.vertices[j]->index);
+			}
+		}
+	});
+
+	return writer.Close();
+}
+
+bool MeshWriter::WritePLY(std::string path, MeshComponent& mesh)
+{
+	std::vector<MeshComponent*> meshes = {&mesh};
+	return WritePLY(path, meshes);
+}
+
+bool MeshWriter::WritePLY(std::string path, std::vector<MeshComponent*>& meshes)
+{
+	PROFILE_SCOPE("MeshWriter::WritePLY");
+	uint64_t vertices = 0;
+	uint64_t triangles = 0;
+	for (int m = 0; m < meshes.size(); ++m)
+	{
+		vertices += meshes[m]->getVertices().size();
+		triangles += meshes[m]->getTriangles().size() / 3;
+	}
+
+	StreamWriter writer;
+	if (!writer.Open(path))
+	{
+		return false;
+	}
+	WriteHeader(writer, vertices, triangles, true);
+
+	// All vertices first, mesh after mesh, then the triangles with each mesh's indices moved past the vertices before it.
+	for (int m = 0; m < meshes.size(); ++m)
+	{
+		std::vector<Vertex>& meshVertices = meshes[m]->getVertices();
+		glm::mat4 transform = meshes[m]->transform;
+		glm::mat4 normalTransform = glm::transpose(glm::inverse(transform));
+		writer.WriteOrdered(meshVertices.size(), WRITER_GRAIN, [&](int begin, int end, std::vector<char>& out)
+		{
+			out.reserve((end - begin) * (6 * sizeof(float) + 4));
+			for (int i = begin; i < end; ++i)
+			{
+				Vertex& v = meshVertices[i];
+				glm::vec3 position = glm::vec3(transform * glm::vec4(v.x, v.y, v.z, 1.0f));
+				glm::vec3 normal = glm::vec3(normalTransform * glm::vec4(v.nx, v.ny, v.nz, 0.0f));
+				float length = glm::length(normal);
+				if (length > 0.0f)
+				{
+					normal /= length;
+				}
+				Append<float>(out, position.x);
+				Append<float>(out, position.y);
+				Append<float>(out, position.z);
+				Append<float>(out, normal.x);
+				Append<float>(out, normal.y);
+				Append<float>(out, normal.z);
+				Append<uint8_t>(out, glm::clamp(v.r, 0.0f, 1.0f) * 255.0f + 0.5f);
+				Append<uint8_t>(out, glm::clamp(v.g, 0.0f, 1.0f) * 255.0f + 0.5f);
+				Append<uint8_t>(out, glm::clamp(v.b, 0.0f, 1.0f) * 255.0f + 0.5f);
+				Append<uint8_t>(out, glm::clamp(v.a, 0.0f, 1.0f) * 255.0f + 0.5f);
+			}
+		});
+	}
+
+	uint64_t vertexBase = 0;
+	for (int m = 0; m < meshes.size(); ++m)
+	{
+		std::vector<uint>& meshTriangles = meshes[m]->getTriangles();
+		writer.WriteOrdered(meshTriangles.size() / 3, WRITER_GRAIN, [&](int begin, int end, std::vector<char>& out)
+		{
+			out.reserve((end - begin) * (1 + 3 * sizeof(int32_t)));
+			for (int i = begin; i < end; ++i)
+			{
+				Append<uint8_t>(out, 3);
+				for (int j = 0; j < 3; ++j)
+				{
+					Append<int32_t>(out, vertexBase + meshTriangles[3 * i + j]);
+				}
+			}
+		});
+		vertexBase += meshes[m]->getVertices().size();
+	}
+
+	return writer.Close();
+}
+
+void MeshWriter::WriteHeader(StreamWriter& writer, uint64_t vertices, uint64_t triangles, bool colors)
+{
+	std::string header = "ply\n";
+	header += "format binary_little_endian 1.0\n";
+	header += "comment River-Valley\n";
+	header += "element vertex " + std::to_string(vertices) + "\n";
+	header += "property float x\nproperty float y\nproperty float z\n";
+	header += "property float nx\nproperty float ny\nproperty float nz\n";
+	if (colors)
+	{
+		header += "property uchar red\nproperty uchar green\nproperty uchar blue\nproperty uchar alpha\n";
+	}
+	header += "element face " + std::to_string(triangles) + "\n";
+	header += "property list uchar int vertex_indices\n";
+	header += "end_header\n";
+	writer.Write(header.data(), header.size());
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include "glm/glm.hpp"
+#include "polyhedron.hpp"
+#include "meshcomponent.hpp"
+#include "streamwriter.hpp"
+#include "profiler.hpp"
+
+/** Static class to export meshes as binary .ply files for other tools.
+ *
+ * The files are binary_little_endian with float positions and normals, plus vertex colors for MeshComponents,
+ * and one list of three int indices per face. They are streamed through a StreamWriter, with the records built on all threads,
+ * so exporting takes a few chunks of memory however large the mesh is. */
+class MeshWriter
+{
+
+public:
+
+	// The vertices, vertex normals and triangles of a polyhedron.
+	static bool WritePLY(std::string path, Polyhedron* p);
+
+	// The vertices and triangles of a mesh, moved to world space by its transform.
+	static bool WritePLY(std::string path, MeshComponent& mesh);
+
+	// Several meshes in one file, e.g. every chunk of the terrain, each moved to world space by its own transform.
+	static bool WritePLY(std::string path, std::vector<MeshComponent*>& meshes);
+
+private:
+
+	MeshWriter();
+	~MeshWriter();
+
+	static void WriteHeader(StreamWriter& writer, uint64_t vertices, uint64_t triangles, bool colors);
+
+	// Append one record field to a block of output.
+	template <typename T>
+	static void Append(std::vector<char>& out, T value)
+	{
+		size_t size = out.size();
+		out.resize(size + sizeof(T));
+		memcpy(out.data() + size, &value, sizeof(T));
+	}
+
+	// Records per block of output.
+	static const int WRITER_GRAIN = 16384;
+
+};
@@ -0,0 +1,80 @@
+#include "parallel.hpp"
+
+uint Parallel::threadCount = 0;
+
+void Parallel::For(int begin, int end, int grain, const std::function<void(int, int)>& body)
+{
+	if (end <= begin)
+	{
+		return;
+	}
+	grain = std::max(grain, 1);
+
+	int blocks = (end - begin + grain - 1) / grain;
+	int threads = std::min((int)GetThreadCount(), blocks);
+
+	// Not worth splitting up.
+	if (threads <= 1)
+	{
+		for (int blockBegin = begin; blockBegin < end; blockBegin += grain)
+		{
+			body(blockBegin, std::min(blockBegin + grain, end));
+		}
+		return;
+	}
+
+	// Helpers queued on the pool may only get to run after For() has returned, so the
+	// shared state outlives the call. A helper that finds no blocks left touches nothing else.
+	struct LoopState
+	{
+		std::atomic<int> nextBlock;
+		std::atomic<int> doneBlocks;
+		std::mutex mutex;
+		std::condition_variable done;
+	};
+	std::shared_ptr<LoopState> state = std::make_shared<LoopState>();
+	state->nextBlock = 0;
+	state->doneBlocks = 0;
+
+	const std::function<void(int, int)>* loopBody = &body;
+	auto worker = [state, loopBody, begin, end, grain, blocks]()
+	{
+		int block;
+		while ((block = state->nextBlock.fetch_add(1)) < blocks)
+		{
+			int blockBegin = begin + block * grain;
+			(*loopBody)(blockBegin, std::min(blockBegin + grain, end));
+			if (state->doneBlocks.fetch_add(1) + 1 == blocks)
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->done.notify_all();
+			}
+		}
+	};
+
+	ThreadPool& pool = ThreadPool::GetShared();
+	for (int i = 1; i < threads; ++i)
+	{
+		pool.Submit(worker);
+	}
+
+	// The calling thread works too, so a For() inside a pool task cannot stall waiting for free workers:
+	// it only ever waits on blocks that some thread has already started.
+	worker();
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->done.wait(lock, [&]() { return state->doneBlocks == blocks; });
+}
+
+uint Parallel::GetThreadCount()
+{
+	if (threadCount > 0)
+	{
+		return threadCount;
+	}
+	return ThreadPool::GetShared().getThreadCount() + 1;
+}
+
+void Parallel::SetThreadCount(uint count)
+{
+	threadCount = count;
+}
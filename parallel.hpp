@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <functional>
+#include <algorithm>
+
+#include "utilities.hpp"
+#include "threadpool.hpp"
+
+/** Static class for splitting a loop across threads.
+ *
+ * For() cuts [begin, end) into blocks of grain iterations and hands them out to the threads of the
+ * shared ThreadPool as they finish, so blocks that take longer do not hold up the others.
+ * The calling thread takes blocks as well, and For() returns once every block is done.
+ * For() may be called from inside a pool task. */
+class Parallel
+{
+public:
+
+	/** Call body(blockBegin, blockEnd) for every block of [begin, end).
+	 * Blocks may run at the same time, so body must only write to data owned by its block. */
+	static void For(int begin, int end, int grain, const std::function<void(int, int)>& body);
+
+	/** The number of threads For() uses at most. */
+	static uint GetThreadCount();
+
+	/** Limit the number of threads. 0 means the shared pool plus the calling thread. */
+	static void SetThreadCount(uint count);
+
+private:
+
+	Parallel();
+	~Parallel();
+
+	static uint threadCount;
+};
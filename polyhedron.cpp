@@ -1,14 +1,9 @@
 #include "polyhedron.hpp"
+#include "meshreader.hpp"
 
 
 Polyhedron::Polyhedron()
 {
-	vlist.reserve(40000);
-	elist.reserve(100000);
-	tlist.reserve(40000);
-	
-	Corner c;
-	clist = std::vector<Corner>(3 * tlist.size(), c);
 	center = glm::dvec3(0.0, 0.0, 0.0);
 }
 Polyhedron::Polyhedron(int vertices, int edges, int triangles)
@@ -16,9 +11,8 @@ Polyhedron::Polyhedron(int vertices, int edges, int triangles)
 	vlist.reserve(vertices);
 	elist.reserve(edges);
 	tlist.reserve(triangles);
+	clist.reserve(3 * triangles);
 	
-	Corner c;
-	clist = std::vector<Corner>(3 * tlist.size(), c);
 	center = glm::dvec3(0.0, 0.0, 0.0);
 }
 /*
@@ -44,114 +38,11 @@ Polyhedron::Polyhedron(std::vector<MeshComponent>& meshes)
 */
 Polyhedron::Polyhedron(std::string file)
 {
-	vlist.reserve(40000);
-	elist.reserve(100000);
-	tlist.reserve(40000);
-
-	std::ifstream f(file);
-
-	// Check to see if the file can be opened.
-	if (!f)
-	{
-		std::cout << "FILE COULD NOT BE OPENED." << std::endl;
-		exit(-1);
-	}
-
-	// Store each line of the file in a string.
-	std::string line;
-
-	// Check to see if the first line of the file is "ply".
-	std::getline(f, line);
-	if (line.substr(0, 3) != "ply")
+	// Read the vertices and triangles of a .ply or .obj file, in parallel.
+	if (!MeshReader::Read(file, this))
 	{
-		std::cout << "NOT A .PLY FILE. " << std::endl;
 		exit(-1);
 	}
-
-	// Go through the header to figure out how many vertices and triangles there are.
-	int numberOfVertices;
-	int numberOfTriangles;
-	while (f && line.substr(0, 10) != "end_header")
-	{
-		std::getline(f, line);
-		
-		// Look for the word "element":
-		std::string word = line.substr(0, line.find(" "));
-		if (word == "element")
-		{
-			line.erase(0, line.find(" ") + 1);
-			
-			// Now decide whether or not this is vertex or triangle info.
-			word = line.substr(0, line.find(" "));
-			if (word == "vertex")
-			{
-				line.erase(0, line.find(" ") + 1);
-				numberOfVertices = std::stoi(line);
-			}
-			else if (word == "face")
-			{
-				line.erase(0, line.find(" ") + 1);
-				numberOfTriangles = std::stoi(line);
-			}
-			else
-			{
-				std::cout << "ERROR READING VERTEX/FACE INFO." << std::endl;
-				exit(-1);
-			}
-		}
-	}
-
-	// Now that we know how many vertices/faces there are, we can build up the lists.
-	// The file is currently sitting at the line "end_header". 
-	int count = 0;
-	std::getline(f, line);
-	while (f && line != "")
-	{
-		// Vertex:
-		if (count < numberOfVertices)
-		{
-			Vert v;
-			glm::vec3 position;
-			for (int i = 0; i < 3; ++i)
-			{
-				std::string word = line.substr(0, line.find(" "));
-				position[i] = std::stof(word);
-				line.erase(0, line.find(" ") + 1);
-			}
-			v.x = position.x;
-			v.y = position.y;
-			v.z = position.z;
-			v.index = vlist.size();
-			vlist.push_back(v);
-		}
-		// Triangle:
-		else
-		{
-			// Check that the first word is 3:
-			std::string word = line.substr(0, line.find(" "));
-			if (std::stoi(word) != 3)
-			{
-				std::cout << "ERROR: NOT A TRIANGLE MESH." << std::endl;
-			}
-			line.erase(0, line.find(" ") + 1);
-		
-			// Continue parsing:
-			Triangle t;	
-			for (int i = 0; i < 3; ++i)
-			{
-				std::string word = line.substr(0, line.find(" "));
-				t.vertices[i] = &vlist[std::stoi(word)];
-				line.erase(0, line.find(" ") + 1);
-			}
-			t.index = tlist.size();
-			tlist.push_back(t);
-		}
-		++count;
-		std::getline(f, line);
-	}
-
-	Corner c;
-	clist = std::vector<Corner>(3 * tlist.size(), c);
 	center = glm::dvec3(0.0, 0.0, 0.0);
 }
 
@@ -200,50 +91,65 @@ Polyhedron& Polyhedron::operator=(Polyhedron&& p)
 */
 
 
-void Polyhedron::Initialize()
+void Polyhedron::Initialize(std::ostream* log)
 {
-	std::cout << std::endl;
-	std::cout << "***** Initializing Polyhedron *****" << std::endl;
-	std::cout << "***** Connecting vertices to triangles ***** " << std::endl;
-	ConnectVerticesToTriangles();
+	PROFILE_SCOPE("Polyhedron::Initialize");
 
-	std::cout << "***** Creating edges ***** " << std::endl;
-	CreateEdges();
-	std::cout << "Polyhedron has " << vlist.size() << " vertices, " << elist.size() << " edges, and " << tlist.size() << " triangles. " << std::endl;
+	// The phases as a dependency graph: independent phases run side by side on the shared thread pool,
+	// and most phases split their own loop with Parallel::For().
+	TaskGraph graph;
 
-	std::cout << "***** Ordering pointers ***** " << std::endl;
-	for (int i = 0; i < vlist.size(); ++i)
+	int connect = graph.AddTask("Connect vertices", [this]() { ConnectVerticesToTriangles(); });
+	int edges = graph.AddTask("Create edges", [this]() { CreateEdges(); }, {connect});
+	int bounds = graph.AddTask("Bounding sphere", [this]() { ComputeBoundingSphere(); });
+
+	int order = graph.AddTask("Order pointers", [this]()
 	{
-		OrderVertexToTrianglePointers(vlist[i]);
-	}
+		Parallel::For(0, vlist.size(), INITIALIZE_GRAIN, [this](int begin, int end)
+		{
+			for (int i = begin; i < end; ++i)
+			{
+				OrderVertexToTrianglePointers(vlist[i]);
+			}
+		});
+	}, {edges});
 
-	std::cout << "***** Computing edge lengths ***** " << std::endl;
-	for (int i = 0; i < elist.size(); ++i)
+	int lengths = graph.AddTask("Edge lengths", [this]()
 	{
-		elist[i].ComputeLength();
+		Parallel::For(0, elist.size(), INITIALIZE_GRAIN, [this](int begin, int end)
+		{
+			for (int i = begin; i < end; ++i)
+			{
+				elist[i].ComputeLength();
+			}
+		});
+	}, {edges});
+
+	int corners = graph.AddTask("Corner list", [this]() { MeshAnalysis::GetCornerList(this); }, {edges});
+	int normals = graph.AddTask("Normals and areas", [this]() { ComputeNormalsAndArea(); }, {lengths, bounds});
+	graph.AddTask("Interpolate normals", [this]() { InterpolateNormals(); }, {normals, order});
+	graph.AddTask("Valence deficit", [this]() { MeshAnalysis::GetValenceDeficit(this); }, {corners});
+	graph.AddTask("Angle deficit", [this]() { MeshAnalysis::GetAngleDeficit(this); }, {corners, order});
+
+	graph.Run();
+	initializeTimings.clear();
+	for (int i = 0; i < graph.getTaskCount(); ++i)
+	{
+		initializeTimings.push_back({graph.getName(i), graph.getMilliseconds(i)});
 	}
+	initializeTimings.push_back({"Total", graph.getTotalMilliseconds()});
 
-	std::cout << "***** Computing bounding sphere ***** " << std::endl;
-	ComputeBoundingSphere();
-
-	std::cout << "***** Computing normals and areas ***** " << std::endl;
-	ComputeNormalsAndArea();
-
-	std::cout << "***** Interpolating normals ***** " << std::endl;
-	InterpolateNormals();
-
-	std::cout << "***** Constructing corner list *****" << std::endl;
-	MeshAnalysis::GetCornerList(this);
-
-	std::cout << "***** Computing valence deficit *****" << std::endl;
-	MeshAnalysis::GetValenceDeficit(this);
-	std::cout << "Valence deficit is " << valenceDeficit << std::endl;
-
-	std::cout << "***** Computing angle deficit *****" << std::endl;
-	MeshAnalysis::GetAngleDeficit(this);
-	std::cout << "Angle deficit is " << angleDeficit << std::endl;
-
-	std::cout << std::endl;
+	if (log == nullptr)
+	{
+		return;
+	}
+	*log << std::endl;
+	*log << "***** Initializing Polyhedron *****" << std::endl;
+	*log << "Polyhedron has " << vlist.size() << " vertices, " << elist.size() << " edges, and " << tlist.size() << " triangles. " << std::endl;
+	*log << "Valence deficit is " << valenceDeficit << std::endl;
+	*log << "Angle deficit is " << angleDeficit << std::endl;
+	graph.PrintTimings(*log);
+	*log << std::endl;
 }
 
 
@@ -251,6 +157,30 @@ void Polyhedron::Initialize()
 
 void Polyhedron::ConnectVerticesToTriangles()
 {
+	// First count the triangles of each vertex.
+	for (int i = 0; i < vlist.size(); ++i)
+	{
+		vlist[i].numberOfTriangles = 0;
+	}
+	for (int i = 0; i < tlist.size(); ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			tlist[i].vertices[j]->numberOfTriangles++;
+		}
+	}
+
+	// Then give each vertex its range of the array, one after the other.
+	vertexTriangles.assign(3 * tlist.size(), NULL);
+	int start = 0;
+	for (int i = 0; i < vlist.size(); ++i)
+	{
+		Vert& v = vlist[i];
+		v.triangles.data = vertexTriangles.data() + start;
+		v.triangles.count = 0;
+		start += v.numberOfTriangles;
+	}
+
 	// Go through the triangles:
 	for (int i = 0; i < tlist.size(); ++i)
 	{
@@ -260,8 +190,7 @@ void Polyhedron::ConnectVerticesToTriangles()
 		for (int j = 0; j < 3; ++j)
 		{
 			Vert* v = t->vertices[j];
-			v->triangles.push_back(t);
-			v->numberOfTriangles++;
+			v->triangles[v->triangles.count++] = t;
 		}
 	}
 }
@@ -349,83 +278,80 @@ void Polyhedron::CreateEdges()
 }
 
 
-void Polyhedron::OrderVertexToTrianglePointers(Vert v)
+void Polyhedron::OrderVertexToTrianglePointers(Vert& v)
 {
-	// Start at the 0th triangle.
-	Triangle* t = v.triangles[0];
-	Triangle* next;
+	if (v.numberOfTriangles == 0)
+	{
+		return;
+	}
+
+	// Edge k of a triangle runs from its vertex k to vertex k + 1. With v at k, the triangle across edge k
+	// is the previous one around v (clockwise), and the triangle across edge k + 2 is the next one (counterclockwise).
 
-	// Go backwards (clockwise) around triangles around a vertex to find the boundary.
-	int k = -1;
-	for (int i = 1; i <= v.numberOfTriangles; ++i)
+	// Go backwards from the 0th triangle to find the boundary. A closed fan has none; any triangle can start it then.
+	Triangle* first = v.triangles[0];
+	Triangle* t = first;
+	for (int i = 1; i < v.numberOfTriangles; ++i)
 	{
-		// First, get the index of v in t.
-		k = t->Contains(&v);
+		int k = t->Contains(&v);
 		if (k == -1)
 		{
 			break;
 		}
-
-		// The corresponding face is the previous one around v.
-		Edge* e = t->edges[k];	
-
-		next = e->GetOtherTriangle(t);
-
-		// If this is a boundary:
-		if (next == NULL)
+		Triangle* previous = t->edges[k]->GetOtherTriangle(t);
+		if (previous == NULL || previous == first)
 		{
-			// Find a reference to t in v.
-			for (int j = 0; j < v.numberOfTriangles; ++j)
-			{
-				if (v.triangles[j] == t)
-				{
-					v.triangles[j] = v.triangles[0];
-					v.triangles[0] = t;
-					break;
-				}
-			}
+			break;
 		}
-		else
+		t = previous;
+	}
+
+	// Move the first triangle of the fan to the front.
+	for (int j = 0; j < v.numberOfTriangles; ++j)
+	{
+		if (v.triangles[j] == t)
 		{
-			t = next;
+			v.triangles[j] = v.triangles[0];
+			v.triangles[0] = t;
+			break;
 		}
 	}
 
-	// Now walk around in the forward direction and place them in order.
-	t = v.triangles[0];
-	int count = 0;
-
-	for (int i = 0; i < v.numberOfTriangles; ++i)
+	// Now walk around in the forward direction and place each triangle after the one before it.
+	for (int i = 0; i + 1 < v.numberOfTriangles; ++i)
 	{
-		// Find reference to v in t.
-		k = t->Contains(&v);
+		int k = t->Contains(&v);
 		if (k == -1)
 		{
 			break;
 		}
-		 // The corresponding face is the next one around v.
-		 Edge* e = t->edges[k];
-		 next = e->GetOtherTriangle(t);
-
-		 // Break if we reached a boundary;
-		 if (next == NULL)
-		 {
-			 break;
-		 }
-
-		 // Swap the next face into its proper place in the face list.
-		 for (int j = 0; j < v.numberOfTriangles; ++j)
-		 {
+		Triangle* next = t->edges[(k + 2) % 3]->GetOtherTriangle(t);
+
+		// Break if we reached a boundary.
+		if (next == NULL)
+		{
+			break;
+		}
+
+		// Swap the next face into its proper place in the face list. Only the faces not placed yet are searched,
+		// so a fan that is not a simple disk (e.g. a non-manifold vertex) stops here instead of going around again.
+		bool found = false;
+		for (int j = i + 1; j < v.numberOfTriangles; ++j)
+		{
 			if (v.triangles[j] == next)
 			{
-				v.triangles[j] = v.triangles[i];
-				v.triangles[i] = next;
+				v.triangles[j] = v.triangles[i + 1];
+				v.triangles[i + 1] = next;
+				found = true;
 				break;
 			}
-		 }
-		 t = next;
+		}
+		if (!found)
+		{
+			break;
+		}
+		t = next;
 	}
-	
 }
 
 void Polyhedron::ComputeBoundingSphere()
@@ -453,44 +379,218 @@ void Polyhedron::ComputeBoundingSphere()
 
 void Polyhedron::ComputeNormalsAndArea()
 {
-	double signedVolume = 0.0;
+	// Sums are kept per block and added up in block order afterwards, so the result does not depend on the threads.
+	int blocks = (tlist.size() + INITIALIZE_GRAIN - 1) / INITIALIZE_GRAIN;
+	std::vector<double> blockArea(blocks, 0.0);
+	std::vector<double> blockVolume(blocks, 0.0);
 
 	// Go through the triangle list and call the method on each triangle.
-	for (int i = 0; i < tlist.size(); ++i)
+	Parallel::For(0, tlist.size(), INITIALIZE_GRAIN, [&](int begin, int end)
 	{
-		Triangle& t = tlist[i];
+		double area = 0.0;
+		double volume = 0.0;
+		for (int i = begin; i < end; ++i)
+		{
+			Triangle& t = tlist[i];
 
-		// Compute the normal and area of this triangle.
-		t.ComputeNormalAndArea();
+			// Compute the normal and area of this triangle.
+			t.ComputeNormalAndArea();
 
-		// Add to the total surface area.
-		surfaceArea += t.area;
+			// Add to the total surface area.
+			area += t.area;
 
-		glm::dvec3 first(t.vertices[0]->x, t.vertices[0]->y, t.vertices[0]->z);
-		signedVolume += glm::dot(center - first, t.normal) * t.area;
+			glm::dvec3 first(t.vertices[0]->x, t.vertices[0]->y, t.vertices[0]->z);
+			volume += glm::dot(center - first, t.normal) * t.area;
+		}
+		blockArea[begin / INITIALIZE_GRAIN] = area;
+		blockVolume[begin / INITIALIZE_GRAIN] = volume;
+	});
+
+	double signedVolume = 0.0;
+	for (int i = 0; i < blocks; ++i)
+	{
+		surfaceArea += blockArea[i];
+		signedVolume += blockVolume[i];
 	}
 
 	// Now orient the normals in the triangles:
+	normalOrientation = (signedVolume > 0) ? -1.0 : 1.0;
 	if (signedVolume > 0)
 	{
-		for (int i = 0; i < tlist.size(); ++i)
+		Parallel::For(0, tlist.size(), INITIALIZE_GRAIN, [this](int begin, int end)
 		{
-			tlist[i].normal *= -1.0;
-		}
+			for (int i = begin; i < end; ++i)
+			{
+				tlist[i].normal *= -1.0;
+			}
+		});
 	}
 }
 
 void Polyhedron::InterpolateNormals()
 {
-	for (int i = 0; i < vlist.size(); ++i)
+	Parallel::For(0, vlist.size(), INITIALIZE_GRAIN, [this](int begin, int end)
 	{
-		Vert& v = vlist[i];
+		for (int i = begin; i < end; ++i)
+		{
+			Vert& v = vlist[i];
+			for (int j = 0; j < v.numberOfTriangles; ++j)
+			{
+				v.normal += v.triangles[j]->normal;
+			}
+			v.normal = glm::normalize(v.normal);
+		}
+	});
+}
+
+void Polyhedron::MarkDirty(int vertex)
+{
+	if (isDirty.size() != vlist.size())
+	{
+		isDirty.assign(vlist.size(), false);
+	}
+	if (!isDirty[vertex])
+	{
+		isDirty[vertex] = true;
+		dirtyVertices.push_back(vertex);
+	}
+}
+
+bool Polyhedron::HasDirtyVertices()
+{
+	return !dirtyVertices.empty();
+}
+
+void Polyhedron::UpdateDirtyRegion(DirtyRegion& region)
+{
+	PROFILE_SCOPE("Polyhedron::UpdateDirtyRegion");
+	region.vertices.clear();
+	region.triangles.clear();
+	if (dirtyVertices.empty())
+	{
+		return;
+	}
+
+	// Marks so that nothing is visited twice.
+	std::vector<bool> triangleMarked(tlist.size(), false);
+	std::vector<bool> vertexMarked(vlist.size(), false);
+	std::vector<bool> edgeMarked(elist.size(), false);
+
+	// 1) Triangles touching a moved vertex.
+	std::vector<int> moved;
+	for (int i = 0; i < dirtyVertices.size(); ++i)
+	{
+		Vert& v = vlist[dirtyVertices[i]];
+		for (int j = 0; j < v.numberOfTriangles; ++j)
+		{
+			int t = v.triangles[j]->index;
+			if (!triangleMarked[t])
+			{
+				triangleMarked[t] = true;
+				moved.push_back(t);
+			}
+		}
+	}
+
+	// 2) Their edge lengths, then their normals and areas.
+	for (int i = 0; i < moved.size(); ++i)
+	{
+		Triangle& t = tlist[moved[i]];
+		for (int j = 0; j < 3; ++j)
+		{
+			Edge* e = t.edges[j];
+			if (!edgeMarked[e->index])
+			{
+				edgeMarked[e->index] = true;
+				e->ComputeLength();
+			}
+		}
+	}
+	for (int i = 0; i < moved.size(); ++i)
+	{
+		Triangle& t = tlist[moved[i]];
+		surfaceArea -= t.area;
+		t.ComputeNormalAndArea();
+		t.normal *= normalOrientation;
+		surfaceArea += t.area;
+	}
+
+	// 3) Corner angles of those triangles. Corners are laid out three per triangle by GetCornerList().
+	if (clist.size() == 3 * tlist.size())
+	{
+		for (int i = 0; i < moved.size(); ++i)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				Corner& c = clist[3 * moved[i] + j];
+				c.v->totalAngle -= c.angle;
+				angleDeficit += c.angle;
+				MeshAnalysis::ComputeAngle(c);
+				c.v->totalAngle += c.angle;
+				angleDeficit -= c.angle;
+			}
+		}
+	}
+
+	// 4) Every vertex of those triangles has a new normal: the one-rings of the moved vertices.
+	for (int i = 0; i < moved.size(); ++i)
+	{
+		Triangle& t = tlist[moved[i]];
+		for (int j = 0; j < 3; ++j)
+		{
+			Vert* v = t.vertices[j];
+			if (!vertexMarked[v->index])
+			{
+				vertexMarked[v->index] = true;
+				region.vertices.push_back(v->index);
+			}
+		}
+	}
+	for (int i = 0; i < region.vertices.size(); ++i)
+	{
+		Vert& v = vlist[region.vertices[i]];
+		v.normal = glm::dvec3(0);
 		for (int j = 0; j < v.numberOfTriangles; ++j)
 		{
 			v.normal += v.triangles[j]->normal;
 		}
 		v.normal = glm::normalize(v.normal);
 	}
+
+	// 5) Metrics depend on vertex normals, so they are stale on every triangle around a changed normal.
+	region.triangles = moved;
+	for (int i = 0; i < region.vertices.size(); ++i)
+	{
+		Vert& v = vlist[region.vertices[i]];
+		for (int j = 0; j < v.numberOfTriangles; ++j)
+		{
+			int t = v.triangles[j]->index;
+			if (!triangleMarked[t])
+			{
+				triangleMarked[t] = true;
+				region.triangles.push_back(t);
+			}
+		}
+	}
+	std::sort(region.vertices.begin(), region.vertices.end());
+	std::sort(region.triangles.begin(), region.triangles.end());
+
+	// The bounding sphere only needs to grow if a vertex left it.
+	for (int i = 0; i < dirtyVertices.size(); ++i)
+	{
+		Vert& v = vlist[dirtyVertices[i]];
+		if (glm::length(glm::dvec3(v.x, v.y, v.z) - center) > radius)
+		{
+			ComputeBoundingSphere();
+			break;
+		}
+	}
+
+	for (int i = 0; i < dirtyVertices.size(); ++i)
+	{
+		isDirty[dirtyVertices[i]] = false;
+	}
+	dirtyVertices.clear();
 }
 
 void Polyhedron::PrintVertices()
@@ -2,8 +2,25 @@
 
 #include <fstream>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <utility>
 #include "geometry.hpp"
+#include "chunkedarray.hpp"
 #include "meshanalysis.hpp"
+#include "parallel.hpp"
+#include "taskgraph.hpp"
+#include "profiler.hpp"
+
+// What Polyhedron::UpdateDirtyRegion() recomputed.
+struct DirtyRegion
+{
+	// Vertices whose position or normal changed.
+	std::vector<int> vertices;
+
+	// Triangles with a moved vertex or a changed vertex normal, i.e. the ones whose metrics are stale.
+	std::vector<int> triangles;
+};
 
 // Mesh class with adjacency information through vertices, edges, and triangles.
 class Polyhedron
@@ -14,7 +31,8 @@ public:
 	Polyhedron();
 	Polyhedron(int vertices, int edges, int triangles);
 
-	// Create a polyhedron from reading in a .ply file.
+	// Create a polyhedron from reading in a .ply or .obj file. Exits if the file cannot be read;
+	// use MeshReader::Read() on an empty polyhedron to handle the error instead.
 	Polyhedron(std::string file);
 	//Polyhedron(std::vector<MeshComponent>& meshes);
 	~Polyhedron();
@@ -26,7 +44,17 @@ public:
 
 
 	// Do all of the operations to prepare this mesh.
-	void Initialize();
+	// Independent phases run in parallel. The sizes, deficits and the time taken by each phase are printed to log at the end,
+	// or not at all if log is nullptr.
+	void Initialize(std::ostream* log = &std::cout);
+
+	// Dirty-region updates after moving vertices, e.g. by smoothing or sculpting:
+	// Call MarkDirty() for every vertex that moved, then UpdateDirtyRegion() to recompute only the edge lengths,
+	// triangle normals and areas, corner angles and vertex normals around them.
+	// The topology must not have changed since Initialize().
+	void MarkDirty(int vertex);
+	bool HasDirtyVertices();
+	void UpdateDirtyRegion(DirtyRegion& region);
 
 	// Info dump:
 	void PrintVertices();
@@ -50,15 +78,29 @@ public:
 	int valenceDeficit = 0;
 	double angleDeficit = 0.0;
 
-	// Geometry lists:
-	std::vector<Vert> vlist;
-	std::vector<Edge> elist;
-	std::vector<Triangle> tlist;
-	std::vector<Corner> clist;
+	// Name and milliseconds of every phase of the last Initialize(), in the order they were added.
+	std::vector<std::pair<std::string, double>> initializeTimings;
+
+	// Sign that ComputeNormalsAndArea() applied to every face normal so that they point outward: 1 or -1.
+	double normalOrientation = 1.0;
+
+	// Geometry lists.
+	// Elements point at each other, so these are chunked: adding elements never moves the existing ones.
+	ChunkedArray<Vert> vlist;
+	ChunkedArray<Edge> elist;
+	ChunkedArray<Triangle> tlist;
+	ChunkedArray<Corner> clist;
 
 private:
 
-	// Create pointers from vertices to their triangles.
+	// The cache writes and restores the adjacency arrays directly, and the memory report measures them.
+	friend class MeshCache;
+	friend class MemoryReport;
+
+	// Triangles of every vertex, one vertex after the other. Vert::triangles are spans into this array.
+	std::vector<Triangle*> vertexTriangles;
+
+	// Create pointers from vertices to their triangles, stored contiguously in vertexTriangles.
 	void ConnectVerticesToTriangles();
 
 	// Create an edge between two vertices and add it to elist.
@@ -67,8 +109,8 @@ private:
 	// Create all edges, triangle by triangle.
 	void CreateEdges();
 
-	// Order the triangles around a vertex counterclockwise.
-	void OrderVertexToTrianglePointers(Vert v);
+	// Order the triangles around a vertex counterclockwise, starting at the boundary if the vertex is on one.
+	void OrderVertexToTrianglePointers(Vert& v);
 
 	// Compute the radius and center of a sphere that bounds the mesh.
 	void ComputeBoundingSphere();
@@ -79,4 +121,11 @@ private:
 	// Interpolate normals to the vertices.
 	void InterpolateNormals();
 
+	// Iterations per block for the parallel loops of Initialize().
+	static const int INITIALIZE_GRAIN = 4096;
+
+	// Vertices moved since the last UpdateDirtyRegion().
+	std::vector<int> dirtyVertices;
+	std::vector<bool> isDirty;
+
 };
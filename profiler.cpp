@@ -0,0 +1,109 @@
+#include "profiler.hpp"
+
+std::mutex Profiler::mutex;
+std::vector<std::unique_ptr<ProfileThreadBuffer>> Profiler::buffers;
+std::unordered_set<std::string> Profiler::names;
+const std::chrono::steady_clock::time_point Profiler::startTime = std::chrono::steady_clock::now();
+
+void Profiler::Record(const char* name, int64_t start, int64_t end)
+{
+	ProfileThreadBuffer* buffer = GetThreadBuffer();
+	if (buffer->events.size() >= MAX_EVENTS_PER_THREAD)
+	{
+		buffer->dropped++;
+		return;
+	}
+	buffer->events.push_back({name, start, end - start});
+}
+
+int64_t Profiler::Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+const char* Profiler::Intern(const std::string& name)
+{
+	// Elements of an unordered_set never move, so the pointer stays valid.
+	std::lock_guard<std::mutex> lock(mutex);
+	return names.insert(name).first->c_str();
+}
+
+ProfileThreadBuffer* Profiler::GetThreadBuffer()
+{
+	// The buffer is owned by the profiler rather than the thread, so it outlives threads that have finished.
+	thread_local ProfileThreadBuffer* buffer = NULL;
+	if (buffer == NULL)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		buffers.push_back(std::unique_ptr<ProfileThreadBuffer>(new ProfileThreadBuffer()));
+		buffer = buffers.back().get();
+		buffer->id = buffers.size();
+		buffer->worker = ThreadPool::IsWorkerThread();
+		buffer->events.reserve(4096);
+	}
+	return buffer;
+}
+
+bool Profiler::WriteTrace(const std::string& path)
+{
+	if (!IsEnabled())
+	{
+		std::cout << "THE PROFILER IS COMPILED OUT; BUILD WITH -DENABLE_PROFILER TO RECORD A TRACE." << std::endl;
+		return false;
+	}
+
+	std::ofstream file(path);
+	if (!file)
+	{
+		std::cout << "COULD NOT WRITE TRACE " << path << "." << std::endl;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	size_t events = 0;
+	file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+	for (int i = 0; i < buffers.size(); ++i)
+	{
+		ProfileThreadBuffer& buffer = *buffers[i];
+		std::string thread = buffer.worker ? "Worker " + std::to_string(buffer.id) : "Thread " + std::to_string(buffer.id);
+		file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer.id << ", \"args\": {\"name\": \"" << thread << "\"}}";
+
+		// Chrome traces are in microseconds; three decimals keep the nanoseconds.
+		char line[512];
+		for (int k = 0; k < buffer.events.size(); ++k)
+		{
+			ProfileEvent& event = buffer.events[k];
+			snprintf(line, sizeof(line), ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+				event.name, buffer.id, event.start / 1000.0, event.duration / 1000.0);
+			file << line;
+		}
+		file << ((i + 1 < buffers.size()) ? ",\n" : "\n");
+		events += buffer.events.size();
+		if (buffer.dropped > 0)
+		{
+			std::cout << "Profiler dropped " << buffer.dropped << " zones of thread " << buffer.id << "." << std::endl;
+		}
+	}
+	file << "]}\n";
+	std::cout << "Wrote " << events << " zones to " << path << "." << std::endl;
+	return true;
+}
+
+void Profiler::Clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (int i = 0; i < buffers.size(); ++i)
+	{
+		buffers[i]->events.clear();
+		buffers[i]->dropped = 0;
+	}
+}
+
+bool Profiler::IsEnabled()
+{
+#ifdef ENABLE_PROFILER
+	return true;
+#else
+	return false;
+#endif
+}
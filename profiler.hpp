@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <unordered_set>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+
+#include "utilities.hpp"
+#include "threadpool.hpp"
+
+/** Scoped profiling zones, written out as a Chrome trace (chrome://tracing or ui.perfetto.dev).
+ *
+ * PROFILE_SCOPE("name") records the time from that line to the end of the enclosing scope.
+ * Zones nest, and the trace viewer stacks them by thread.
+ *
+ * Every thread appends its zones to a buffer of its own, so recording takes no lock:
+ * two clock reads and a store. The buffers are only read by WriteTrace().
+ *
+ * Zones are compiled out unless ENABLE_PROFILER is defined (make CPPFLAGS=-DENABLE_PROFILER),
+ * so release builds pay nothing. */
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_CONCATENATE_(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_(a, b)
+#define PROFILE_SCOPE(name) ProfileZone PROFILE_CONCATENATE(profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#endif
+
+// One finished zone.
+struct ProfileEvent
+{
+	const char* name; // Must outlive the profiler: a string literal, __func__ or Profiler::Intern().
+	int64_t start; // Nanoseconds since the profiler started.
+	int64_t duration;
+};
+
+// The zones of one thread. Only that thread appends to it.
+struct ProfileThreadBuffer
+{
+	int id;
+	bool worker;
+	std::vector<ProfileEvent> events;
+	uint64_t dropped = 0;
+};
+
+/** Static class holding the buffers of every thread that recorded a zone. */
+class Profiler
+{
+
+public:
+
+	// Add a finished zone to the buffer of the calling thread.
+	static void Record(const char* name, int64_t start, int64_t end);
+
+	// Nanoseconds since the profiler started.
+	static int64_t Now();
+
+	// A copy of name that lives as long as the program, for zone names that are built at run time.
+	static const char* Intern(const std::string& name);
+
+	// Write every zone recorded so far as Chrome trace JSON. Returns false if the file cannot be written.
+	// Zones that are still open are not written. Call it while no other thread is recording, e.g. between frames.
+	static bool WriteTrace(const std::string& path);
+
+	// Forget every zone recorded so far.
+	static void Clear();
+
+	// Whether PROFILE_SCOPE records anything in this build.
+	static bool IsEnabled();
+
+private:
+
+	Profiler();
+	~Profiler();
+
+	static ProfileThreadBuffer* GetThreadBuffer();
+
+	static std::mutex mutex;
+	static std::vector<std::unique_ptr<ProfileThreadBuffer>> buffers;
+	static std::unordered_set<std::string> names;
+	static const std::chrono::steady_clock::time_point startTime;
+
+	// Zones kept per thread, so a long session cannot use up the memory; later zones are counted and dropped.
+	static const size_t MAX_EVENTS_PER_THREAD = 1 << 20;
+
+};
+
+/** Records the time between its construction and destruction. Use PROFILE_SCOPE rather than this directly. */
+class ProfileZone
+{
+
+public:
+
+	ProfileZone(const char* name) : name(name), start(Profiler::Now()) {}
+	~ProfileZone() { Profiler::Record(name, start, Profiler::Now()); }
+
+private:
+
+	const char* name;
+	int64_t start;
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+
+};
@@ -0,0 +1,587 @@
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <functional>
+#include <unistd.h>
+
+#include "polyhedron.hpp"
+#include "subdivision.hpp"
+#include "smoothing.hpp"
+#include "meshanalysis.hpp"
+#include "meshfactory.hpp"
+#include "perlinnoise.hpp"
+#include "parallel.hpp"
+
+/** Regression tests of the mesh algorithms, without a window or an OpenGL context.
+ *
+ * Every algorithm runs on fixed inputs: the bunny (if it is there), a sphere from MeshFactory and a chunk of generated terrain.
+ * What comes out is reduced to a few numbers per stage (element counts, which must match exactly, and sums and moments of
+ * positions and metrics, which must match within a relative tolerance) and compared to the golden values in regress.golden.
+ * The numbers do not depend on the order of the elements, so an optimization may reorder them freely.
+ *
+ * The triangles around every vertex of every initialized polyhedron must also be in fan order; this needs no golden values.
+ * The terrain has open fans along its edges and at its corners, so both kinds are checked.
+ *
+ * Every stage is also timed, and the fastest of its runs is compared to a baseline of the same machine.
+ * A stage fails when it is more than the threshold slower than the baseline. Without a baseline only the times are printed.
+ *
+ * Usage: regress [options]
+ *	-u				Write the golden values from this run instead of checking them. Only do this after checking the change is right.
+ *	-b				Write the timing baseline from this run.
+ *	-t threshold	Allowed slowdown against the baseline, as a fraction (default 0.25).
+ *	-r runs			Runs of every stage; the fastest counts (default 3).
+ *	-j threads		Threads to use (default: all).
+ *	-m file			The bunny, or any other .ply (default ./tempmodels/bunny.ply). Skipped if it cannot be found.
+ *	-g file			Golden values (default ./regress.golden).
+ *	-p file			Timing baseline (default ./regress.baseline).
+ *
+ * Returns 0 if every value and time passed. */
+
+struct RegressOptions
+{
+	bool updateGolden = false;
+	bool updateBaseline = false;
+	double threshold = 0.25;
+	int runs = 3;
+	std::string modelPath = "./tempmodels/bunny.ply";
+	std::string goldenPath = "./regress.golden";
+	std::string baselinePath = "./regress.baseline";
+};
+
+// One number computed by a stage. Exact values are counts; the others are compared within a tolerance.
+struct RegressValue
+{
+	std::string name;
+	double value;
+	bool exact;
+};
+
+// Fastest run of one stage, in milliseconds.
+struct RegressTiming
+{
+	std::string name;
+	double milliseconds;
+};
+
+// Fans of one stage: all of them, the open ones, and the ones out of order.
+struct RegressFans
+{
+	std::string name;
+	int fans;
+	int open;
+	int wrong;
+};
+
+// A fixed input: makes a new, uninitialized polyhedron every time it is called.
+struct RegressCase
+{
+	std::string name;
+	std::function<Polyhedron*()> make;
+};
+
+// Values closer than this, relative to their size, are the same. Allows for a different order of floating point sums,
+// and for the compiler vectorizing or fusing the arithmetic differently: the spherical areas of nearly flat terrain triangles
+// are small differences of large numbers, and move by about 2e-6 between -O0 and -O3 -march=native.
+const double RELATIVE_TOLERANCE = 1e-5;
+const double ABSOLUTE_TOLERANCE = 1e-9;
+
+// Slowdowns smaller than this are noise, whatever the threshold.
+const double MINIMUM_REGRESSION_MS = 0.5;
+
+std::vector<RegressValue> values;
+std::vector<RegressTiming> timings;
+std::vector<RegressFans> fans;
+
+void AddValue(const std::string& name, double value, bool exact = false)
+{
+	values.push_back({name, value, exact});
+}
+
+// Check that the triangles of every vertex are in fan order: counterclockwise, each across edge k + 2 (with the vertex at k)
+// of the one before it. A closed fan gets back to its first triangle; an open one starts and ends at the boundary.
+void CheckFans(const std::string& stage, Polyhedron* p)
+{
+	RegressFans result = {stage, 0, 0, 0};
+	for (int i = 0; i < p->vlist.size(); ++i)
+	{
+		Vert& v = p->vlist[i];
+		if (v.numberOfTriangles == 0)
+		{
+			continue;
+		}
+		bool inOrder = true;
+		for (int j = 0; j + 1 < v.numberOfTriangles && inOrder; ++j)
+		{
+			Triangle* t = v.triangles[j];
+			int k = t->Contains(&v);
+			inOrder = k != -1 && t->edges[(k + 2) % 3]->GetOtherTriangle(t) == v.triangles[j + 1];
+		}
+		Triangle* first = v.triangles[0];
+		Triangle* last = v.triangles[v.numberOfTriangles - 1];
+		int k = first->Contains(&v);
+		int l = last->Contains(&v);
+		Triangle* previous = (k == -1) ? NULL : first->edges[k]->GetOtherTriangle(first);
+		Triangle* next = (l == -1) ? NULL : last->edges[(l + 2) % 3]->GetOtherTriangle(last);
+		bool open = previous == NULL && next == NULL;
+		bool closed = previous == last && next == first;
+		result.fans++;
+		result.open += open ? 1 : 0;
+		result.wrong += (inOrder && k != -1 && l != -1 && (open || closed)) ? 0 : 1;
+	}
+	fans.push_back(result);
+}
+
+// Report the fans out of order. Returns the number of stages that had any.
+int CheckFanOrder()
+{
+	int failed = 0;
+	int total = 0;
+	int open = 0;
+	for (int i = 0; i < fans.size(); ++i)
+	{
+		if (fans[i].wrong > 0)
+		{
+			std::cout << "FAILED " << fans[i].name << ": " << fans[i].wrong << " of " << fans[i].fans << " fans out of order." << std::endl;
+			failed++;
+		}
+		total += fans[i].fans;
+		open += fans[i].open;
+	}
+	std::cout << fans.size() - failed << " of " << fans.size() << " stages have every fan in order (" << total << " fans, " << open << " of them open)." << std::endl;
+	return failed;
+}
+
+// Counts, deficits and surface area of an initialized polyhedron, and the order of its fans.
+void AddTopology(const std::string& stage, Polyhedron* p)
+{
+	CheckFans(stage, p);
+	AddValue(stage + "/vertices", p->vlist.size(), true);
+	AddValue(stage + "/edges", p->elist.size(), true);
+	AddValue(stage + "/triangles", p->tlist.size(), true);
+	AddValue(stage + "/valence deficit", p->valenceDeficit, true);
+	AddValue(stage + "/angle deficit", p->angleDeficit);
+	AddValue(stage + "/surface area", p->surfaceArea);
+}
+
+// Sums and second moments of the vertex positions and normals. They change if any vertex moves.
+void AddPositions(const std::string& stage, Polyhedron* p)
+{
+	glm::dvec3 sum(0.0);
+	glm::dvec3 squares(0.0);
+	glm::dvec3 normals(0.0);
+	for (int i = 0; i < p->vlist.size(); ++i)
+	{
+		Vert& v = p->vlist[i];
+		glm::dvec3 position(v.x, v.y, v.z);
+		sum += position;
+		squares += position * position;
+		normals += glm::dvec3(std::abs(v.normal.x), std::abs(v.normal.y), std::abs(v.normal.z));
+	}
+	const char* axes[] = {"x", "y", "z"};
+	for (int k = 0; k < 3; ++k)
+	{
+		AddValue(stage + "/sum " + axes[k], sum[k]);
+		AddValue(stage + "/sum " + axes[k] + "^2", squares[k]);
+		AddValue(stage + "/sum |n" + axes[k] + "|", normals[k]);
+	}
+}
+
+void AddSum(const std::string& name, const std::vector<double>& v)
+{
+	double sum = 0.0;
+	double squares = 0.0;
+	for (int i = 0; i < v.size(); ++i)
+	{
+		sum += v[i];
+		squares += v[i] * v[i];
+	}
+	AddValue(name + " sum", sum);
+	AddValue(name + " sum^2", squares);
+}
+
+// Run a stage the given number of times and keep the fastest. The values are taken from the last run.
+void Time(const std::string& name, int runs, std::function<void()> body)
+{
+	double fastest = -1.0;
+	for (int i = 0; i < runs; ++i)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		body();
+		double milliseconds = Milliseconds(start);
+		fastest = (fastest < 0.0) ? milliseconds : std::min(fastest, milliseconds);
+	}
+	timings.push_back({name, fastest});
+}
+
+void RunCase(const RegressCase& c, const RegressOptions& options)
+{
+	Polyhedron* p = NULL;
+
+	// Initialize(). The input is made again every run, outside the timing.
+	std::vector<Polyhedron*> inputs;
+	for (int i = 0; i < options.runs; ++i)
+	{
+		inputs.push_back(c.make());
+	}
+	int run = 0;
+	Time(c.name + "/initialize", options.runs, [&]() { inputs[run++]->Initialize(nullptr); });
+	for (int i = 0; i + 1 < inputs.size(); ++i)
+	{
+		delete(inputs[i]);
+	}
+	p = inputs.back();
+	AddTopology(c.name + "/initialize", p);
+	AddPositions(c.name + "/initialize", p);
+
+	// Metrics of every triangle:
+	TriangleMetrics metrics;
+	std::vector<double> curvatures;
+	std::vector<double> horizons;
+	Time(c.name + "/metrics", options.runs, [&]()
+	{
+		metrics = MeshAnalysis::ComputeTriangleMetrics(p->tlist);
+		curvatures = MeshAnalysis::GetApproximateGaussianCurvatures(p->tlist);
+		horizons = MeshAnalysis::GetHorizonMeasuresDouble(p->tlist);
+	});
+	AddSum(c.name + "/metrics/area", metrics.area);
+	AddSum(c.name + "/metrics/perimeter", metrics.perimeter);
+	AddSum(c.name + "/metrics/horizon area", metrics.horizonArea);
+	AddSum(c.name + "/metrics/spherical area", metrics.sphericalArea);
+	AddSum(c.name + "/metrics/gaussian curvature", curvatures);
+	AddSum(c.name + "/metrics/horizon measure", horizons);
+
+	// A few smoothing steps with every weight, each on a fresh copy, with the update of what moved:
+	const char* names[] = {"uniform", "cord", "cord-static", "mean-curvature", "mean-curvature-static", "mean-value", "mean-value-static"};
+	const Weight weights[] = {Weight::UNIFORM, Weight::CORD_DYNAMIC, Weight::CORD_STATIC, Weight::MEAN_CURVATURE_DYNAMIC,
+		Weight::MEAN_CURVATURE_STATIC, Weight::MEAN_VALUE_DYNAMIC, Weight::MEAN_VALUE_STATIC};
+	for (int w = 0; w < 7; ++w)
+	{
+		std::string stage = c.name + "/smooth/" + names[w];
+		Polyhedron* s = NULL;
+		double fastest = -1.0;
+		for (int i = 0; i < options.runs; ++i)
+		{
+			delete(s);
+			s = c.make();
+			s->Initialize(nullptr);
+			auto start = std::chrono::high_resolution_clock::now();
+			for (int k = 0; k < 3; ++k)
+			{
+				Smoothing::SmoothMesh(s, 0.1, weights[w]);
+				DirtyRegion region;
+				s->UpdateDirtyRegion(region);
+			}
+			double milliseconds = Milliseconds(start);
+			fastest = (fastest < 0.0) ? milliseconds : std::min(fastest, milliseconds);
+		}
+		timings.push_back({stage, fastest});
+		AddValue(stage + "/surface area", s->surfaceArea);
+		AddPositions(stage, s);
+		delete(s);
+	}
+
+	// One level of Loop subdivision everywhere, and one only where the curvature is above the median:
+	Polyhedron* q = NULL;
+	Time(c.name + "/loop", options.runs, [&]()
+	{
+		delete(q);
+		q = Subdivision::LoopSubdivisionHeap(p);
+		q->Initialize(nullptr);
+	});
+	AddTopology(c.name + "/loop", q);
+	AddPositions(c.name + "/loop", q);
+	delete(q);
+	q = NULL;
+
+	std::vector<double> sorted = curvatures;
+	std::sort(sorted.begin(), sorted.end());
+	double median = sorted.empty() ? 0.0 : sorted[sorted.size() / 2];
+	Time(c.name + "/adaptive loop", options.runs, [&]()
+	{
+		delete(q);
+		q = Subdivision::AdaptiveLoopSubdivision(p, curvatures, median);
+		q->Initialize(nullptr);
+	});
+	AddTopology(c.name + "/adaptive loop", q);
+	AddPositions(c.name + "/adaptive loop", q);
+	delete(q);
+	delete(p);
+}
+
+// Golden values: "name = value" for exact values, "name ~ value" for the others.
+bool ReadGolden(const std::string& path, std::map<std::string, RegressValue>& golden)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		return false;
+	}
+	std::string line;
+	while (std::getline(file, line))
+	{
+		size_t separator = line.find_last_of("=~");
+		if (line.empty() || line[0] == '#' || separator == std::string::npos || separator < 1)
+		{
+			continue;
+		}
+		RegressValue value;
+		value.name = line.substr(0, separator - 1);
+		value.exact = (line[separator] == '=');
+		value.value = std::atof(line.c_str() + separator + 1);
+		golden[value.name] = value;
+	}
+	return true;
+}
+
+bool WriteGolden(const std::string& path)
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		std::cout << "COULD NOT WRITE " << path << "." << std::endl;
+		return false;
+	}
+	file << "# Golden values of regress. Write them again with regress -u, only after checking that the change is right.\n";
+	file << std::setprecision(17);
+	for (int i = 0; i < values.size(); ++i)
+	{
+		file << values[i].name << (values[i].exact ? " = " : " ~ ") << values[i].value << "\n";
+	}
+	std::cout << "Wrote " << values.size() << " golden values to " << path << "." << std::endl;
+	return true;
+}
+
+bool ReadBaseline(const std::string& path, std::map<std::string, double>& baseline)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		return false;
+	}
+	std::string line;
+	while (std::getline(file, line))
+	{
+		// The time is the last word; names have spaces in them.
+		size_t space = line.find_last_of(' ');
+		if (line.empty() || line[0] == '#' || space == std::string::npos)
+		{
+			continue;
+		}
+		baseline[line.substr(0, space)] = std::atof(line.c_str() + space + 1);
+	}
+	return true;
+}
+
+bool WriteBaseline(const std::string& path)
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		std::cout << "COULD NOT WRITE " << path << "." << std::endl;
+		return false;
+	}
+	file << "# Fastest time of every stage of regress, in milliseconds, on one machine. Write it again with regress -b.\n";
+	file << std::setprecision(6);
+	for (int i = 0; i < timings.size(); ++i)
+	{
+		file << timings[i].name << " " << timings[i].milliseconds << "\n";
+	}
+	std::cout << "Wrote " << timings.size() << " baseline times to " << path << "." << std::endl;
+	return true;
+}
+
+// Compare every value to its golden value. Returns the number of failures.
+int CheckValues(const RegressOptions& options, const std::vector<std::string>& cases)
+{
+	std::map<std::string, RegressValue> golden;
+	if (!ReadGolden(options.goldenPath, golden))
+	{
+		std::cout << "NO GOLDEN VALUES IN " << options.goldenPath << "; RUN regress -u TO WRITE THEM." << std::endl;
+		return 1;
+	}
+
+	// A case without any golden values, e.g. the bunny when the goldens were written without it, is only reported.
+	std::map<std::string, bool> hasGolden;
+	for (std::map<std::string, RegressValue>::iterator i = golden.begin(); i != golden.end(); ++i)
+	{
+		hasGolden[i->first.substr(0, i->first.find('/'))] = true;
+	}
+	for (int i = 0; i < cases.size(); ++i)
+	{
+		if (!hasGolden.count(cases[i]))
+		{
+			std::cout << "No golden values for " << cases[i] << " in " << options.goldenPath << "; run regress -u to add them." << std::endl;
+		}
+	}
+
+	int failed = 0;
+	int checked = 0;
+	std::map<std::string, bool> seen;
+	for (int i = 0; i < values.size(); ++i)
+	{
+		RegressValue& value = values[i];
+		seen[value.name] = true;
+		if (!hasGolden.count(value.name.substr(0, value.name.find('/'))))
+		{
+			continue;
+		}
+		checked++;
+		std::map<std::string, RegressValue>::iterator expected = golden.find(value.name);
+		if (expected == golden.end())
+		{
+			std::cout << "FAILED " << value.name << ": no golden value." << std::endl;
+			failed++;
+			continue;
+		}
+		double difference = std::abs(value.value - expected->second.value);
+		double tolerance = value.exact ? 0.0 : ABSOLUTE_TOLERANCE + RELATIVE_TOLERANCE * std::max(std::abs(value.value), std::abs(expected->second.value));
+		if (difference > tolerance || std::isnan(value.value))
+		{
+			std::cout << std::setprecision(12) << "FAILED " << value.name << ": " << value.value << ", expected " << expected->second.value << "." << std::endl;
+			failed++;
+		}
+	}
+
+	// Golden values of the cases that ran must all have been computed again.
+	for (std::map<std::string, RegressValue>::iterator i = golden.begin(); i != golden.end(); ++i)
+	{
+		std::string name = i->first.substr(0, i->first.find('/'));
+		if (std::find(cases.begin(), cases.end(), name) != cases.end() && !seen.count(i->first))
+		{
+			std::cout << "FAILED " << i->first << ": not computed any more." << std::endl;
+			failed++;
+		}
+	}
+	std::cout << checked - failed << " of " << checked << " values match " << options.goldenPath << "." << std::endl;
+	return failed;
+}
+
+// Compare every time to the baseline. Returns the number of stages that got slower than the threshold allows.
+int CheckTimings(const RegressOptions& options)
+{
+	std::map<std::string, double> baseline;
+	bool hasBaseline = ReadBaseline(options.baselinePath, baseline);
+
+	int failed = 0;
+	char line[256];
+	for (int i = 0; i < timings.size(); ++i)
+	{
+		RegressTiming& timing = timings[i];
+		std::map<std::string, double>::iterator expected = baseline.find(timing.name);
+		if (expected == baseline.end())
+		{
+			snprintf(line, sizeof(line), "  %-44s %10.3f ms", timing.name.c_str(), timing.milliseconds);
+			std::cout << line << std::endl;
+			continue;
+		}
+		double change = (expected->second > 0.0) ? timing.milliseconds / expected->second - 1.0 : 0.0;
+		bool slower = change > options.threshold && timing.milliseconds - expected->second > MINIMUM_REGRESSION_MS;
+		snprintf(line, sizeof(line), "%s %-44s %10.3f ms, baseline %10.3f ms (%+.1f%%)", slower ? "SLOWER" : "      ",
+			timing.name.c_str(), timing.milliseconds, expected->second, 100.0 * change);
+		std::cout << line << std::endl;
+		failed += slower ? 1 : 0;
+	}
+	if (!hasBaseline)
+	{
+		std::cout << "No timing baseline in " << options.baselinePath << "; run regress -b on this machine to write one." << std::endl;
+	}
+	else
+	{
+		std::cout << timings.size() - failed << " of " << timings.size() << " stages within " << 100.0 * options.threshold << "% of " << options.baselinePath << "." << std::endl;
+	}
+	return failed;
+}
+
+void PrintUsage()
+{
+	std::cout << "Usage: regress [-u] [-b] [-t threshold] [-r runs] [-j threads] [-m model.ply] [-g golden] [-p baseline]" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	RegressOptions options;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		if (argument == "-u")
+		{
+			options.updateGolden = true;
+			continue;
+		}
+		if (argument == "-b")
+		{
+			options.updateBaseline = true;
+			continue;
+		}
+		if (argument.size() != 2 || argument[0] != '-' || i + 1 >= argc)
+		{
+			PrintUsage();
+			return -1;
+		}
+		std::string value = argv[++i];
+		switch (argument[1])
+		{
+			case 't': options.threshold = std::atof(value.c_str()); break;
+			case 'r': options.runs = std::max(1, std::atoi(value.c_str())); break;
+			case 'j': Parallel::SetThreadCount(std::atoi(value.c_str())); break;
+			case 'm': options.modelPath = value; break;
+			case 'g': options.goldenPath = value; break;
+			case 'p': options.baselinePath = value; break;
+			default:
+				PrintUsage();
+				return -1;
+		}
+	}
+
+	// The inputs. Only the bunny comes from outside the program.
+	std::vector<RegressCase> cases;
+	if (access(options.modelPath.c_str(), R_OK) == 0)
+	{
+		std::string modelPath = options.modelPath;
+		cases.push_back({"bunny", [modelPath]() { return new Polyhedron(modelPath); }});
+	}
+	else
+	{
+		std::cout << "Skipping the bunny: " << options.modelPath << " cannot be read." << std::endl;
+	}
+	cases.push_back({"sphere", []() { return MeshFactory::GetSpherePolyhedron(1.0f, 24); }});
+	PerlinNoise noise;
+	cases.push_back({"terrain", [&noise]() { return MeshFactory::GetTerrainPolyhedron(noise, 1, -2, 65, 1.0f, 0.6f, -0.15f); }});
+
+	std::vector<std::string> caseNames;
+	for (int i = 0; i < cases.size(); ++i)
+	{
+		std::cerr << "Running " << cases[i].name << "..." << std::endl;
+		RunCase(cases[i], options);
+		caseNames.push_back(cases[i].name);
+	}
+
+	int failed = 0;
+	if (options.updateGolden)
+	{
+		failed += WriteGolden(options.goldenPath) ? 0 : 1;
+	}
+	else
+	{
+		failed += CheckValues(options, caseNames);
+	}
+	failed += CheckFanOrder();
+	if (options.updateBaseline)
+	{
+		failed += WriteBaseline(options.baselinePath) ? 0 : 1;
+	}
+	else
+	{
+		failed += CheckTimings(options);
+	}
+
+	std::cout << ((failed == 0) ? "PASSED" : "FAILED") << std::endl;
+	return (failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+#include "scalarfield.hpp"
+
+ScalarField::ScalarField() {}
+ScalarField::~ScalarField() {}
+
+int ScalarField::AddField(const std::string& name, const std::vector<double>& values)
+{
+	ScalarFieldRange field;
+	field.name = name;
+	field.offset = this->values.size();
+	field.count = values.size();
+
+	// Range and mean in one pass.
+	double sum = 0.0;
+	double min = std::numeric_limits<double>::max();
+	double max = -std::numeric_limits<double>::max();
+	for (int i = 0; i < values.size(); ++i)
+	{
+		double x = values[i];
+		sum += x;
+		if (x < min)
+			min = x;
+		if (x > max)
+			max = x;
+		this->values.push_back((float)x);
+	}
+	if (!values.empty())
+	{
+		field.min = (float)min;
+		field.mean = (float)(sum / (double)values.size());
+		field.max = (float)max;
+	}
+
+	fields.push_back(field);
+	return fields.size() - 1;
+}
+
+void ScalarField::Upload()
+{
+	if (bufferID == 0)
+	{
+		glGenBuffers(1, &bufferID);
+		glGenTextures(1, &textureID);
+	}
+
+	glBindBuffer(GL_TEXTURE_BUFFER, bufferID);
+	glBufferData(GL_TEXTURE_BUFFER, values.size() * sizeof(float), values.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glBindTexture(GL_TEXTURE_BUFFER, textureID);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, bufferID);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void ScalarField::UpdateValues(int field, const std::vector<int>& indices, const std::vector<double>& values)
+{
+	if (indices.empty())
+	{
+		return;
+	}
+	uint offset = fields[field].offset;
+	for (int i = 0; i < indices.size(); ++i)
+	{
+		this->values[offset + indices[i]] = (float)values[i];
+	}
+
+	// Indices are sorted, so consecutive ones can go up together.
+	glBindBuffer(GL_TEXTURE_BUFFER, bufferID);
+	int first = 0;
+	for (int i = 1; i <= indices.size(); ++i)
+	{
+		if (i < indices.size() && indices[i] == indices[i - 1] + 1)
+		{
+			continue;
+		}
+		uint start = offset + indices[first];
+		uint count = indices[i - 1] - indices[first] + 1;
+		glBufferSubData(GL_TEXTURE_BUFFER, start * sizeof(float), count * sizeof(float), &this->values[start]);
+		first = i;
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ScalarField::Bind(int unit)
+{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_BUFFER, textureID);
+}
+
+void ScalarField::SetRange(int field, float min, float mean, float max)
+{
+	fields[field].min = min;
+	fields[field].mean = mean;
+	fields[field].max = max;
+}
+
+void ScalarField::CleanUp()
+{
+	glDeleteTextures(1, &textureID);
+	glDeleteBuffers(1, &bufferID);
+	textureID = 0;
+	bufferID = 0;
+	values.clear();
+	fields.clear();
+}
+
+ScalarFieldRange& ScalarField::getField(int field)
+{
+	return fields[field];
+}
+int ScalarField::getFieldCount()
+{
+	return fields.size();
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+#include <string>
+#include <limits>
+#include <iostream>
+#include "glm/glm.hpp"
+
+#include "utilities.hpp"
+
+/** One scalar per triangle, e.g. a horizon measure, plus the range used to colormap it. */
+struct ScalarFieldRange
+{
+	std::string name;
+	uint offset = 0; // First value in the buffer.
+	uint count = 0;
+	float min = 0.0f;
+	float mean = 0.0f;
+	float max = 0.0f;
+};
+
+/** Per-triangle scalar fields in a buffer texture, colormapped by basic.shader.
+ *
+ * Every field is uploaded once. The shader reads the value of a triangle with
+ * texelFetch(uScalarField, base + offset of the mesh + gl_PrimitiveID), so switching which field is shown,
+ * or changing the range it is mapped over, only changes a few uniforms instead of the vertex colors. */
+class ScalarField
+{
+public:
+
+	ScalarField();
+	~ScalarField();
+
+	/** Add a field and compute its min, mean and max. Returns its index.
+	 * Fields are only sent to the GPU by Upload(). */
+	int AddField(const std::string& name, const std::vector<double>& values);
+
+	/** Upload every field. Needs an OpenGL context. */
+	void Upload();
+
+	/** Bind the buffer texture for sampling. */
+	void Bind(int unit);
+
+	/** Set value i of the field to values[k] for each k with indices[k] = i, and upload only those values.
+	 * Indices must be sorted; consecutive ones are uploaded together.
+	 * The range is left alone so colors stay comparable while editing; use SetRange() to rescale. */
+	void UpdateValues(int field, const std::vector<int>& indices, const std::vector<double>& values);
+
+	/** Override the range a field is mapped over. */
+	void SetRange(int field, float min, float mean, float max);
+
+	/** Release all resources. */
+	void CleanUp();
+
+	// getters:
+	ScalarFieldRange& getField(int field);
+	int getFieldCount();
+
+	/** Texture unit that BasicShader samples the fields from. */
+	static const int TEXTURE_UNIT = 5;
+
+private:
+
+	uint bufferID = 0;
+	uint textureID = 0;
+
+	std::vector<float> values;
+	std::vector<ScalarFieldRange> fields;
+
+};
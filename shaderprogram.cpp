@@ -1,5 +1,7 @@
 #include "shaderprogram.hpp"
 
+constexpr char ShaderProgram::BINARY_MAGIC[8];
+
 ShaderProgram::ShaderProgram() {}
 ShaderProgram::~ShaderProgram() {}
 
@@ -17,20 +19,52 @@ void ShaderProgram::Stop()
 void ShaderProgram::CleanUp()
 {
 	Stop();
-	glDetachShader(programID, vertexShaderID);
-	glDetachShader(programID, geometryShaderID);
-	glDetachShader(programID, fragmentShaderID);
-	glDeleteShader(vertexShaderID);
-	glDeleteShader(geometryShaderID);
-	glDeleteShader(fragmentShaderID);
+	uint shaders[3] = {vertexShaderID, geometryShaderID, fragmentShaderID};
+	for (int i = 0; i < 3; ++i)
+	{
+		if (shaders[i] != 0)
+		{
+			glDetachShader(programID, shaders[i]);
+			glDeleteShader(shaders[i]);
+		}
+	}
 	glDeleteProgram(programID);
 }
 
 
 void ShaderProgram::PrepareShader(const std::string& file)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// read the whole file; its hash says whether the cached binary is still good.
+	std::ifstream stream(file, std::ios::binary);
+	if (!stream)
+	{
+		std::cout << "COULD NOT OPEN SHADER " << file << "." << std::endl;
+	}
+	std::stringstream text;
+	text << stream.rdbuf();
+	uint64_t sourceHash = Hash(text.str());
+	std::string cachePath = file + ".bin";
+
+	bool cached = LoadProgramBinary(cachePath, sourceHash);
+	if (!cached)
+	{
+		CompileProgram(text.str());
+		SaveProgramBinary(cachePath, sourceHash);
+	}
+
+	// evaluate uniform variables. Block bindings are not part of a program binary, so this is needed either way.
+	GetAllUniformLocations();
+
+	std::chrono::duration<double, std::milli> time = std::chrono::high_resolution_clock::now() - start;
+	std::cout << (cached ? "Loaded shader " : "Compiled shader ") << file << " in " << time.count() << " ms." << std::endl;
+}
+
+void ShaderProgram::CompileProgram(const std::string& text)
 {
 	// parse the code in the given source file.
-	ShaderProgramSource shaders = ParseShader(file);	
+	ShaderProgramSource shaders = ParseShader(text);
 
 	// load up the two (or more) shaders to the GPU.
 	LoadShader(vertexShaderID, ShaderType::vertex, shaders.vertexSource);
@@ -41,17 +75,109 @@ void ShaderProgram::PrepareShader(const std::string& file)
 	programID = glCreateProgram();
 	glAttachShader(programID, vertexShaderID);
 	glAttachShader(programID, fragmentShaderID);
-	glAttachShader(programID, geometryShaderID);
+	if (geometryShaderID != 0)
+	{
+		glAttachShader(programID, geometryShaderID);
+	}
 
 	// bind attributes for the shader variables.
 	BindAttributes();
 
-	// link and validate.
+	// link and validate. The binary is kept so it can be cached.
+	glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(programID);
 	glValidateProgram(programID);
+}
 
-	// evaluate uniform variables.
-	GetAllUniformLocations();
+bool ShaderProgram::LoadProgramBinary(const std::string& cachePath, uint64_t sourceHash)
+{
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	std::ifstream stream(cachePath, std::ios::binary);
+	if (formats == 0 || !stream)
+	{
+		return false;
+	}
+
+	ShaderBinaryHeader header;
+	if (!stream.read((char*)&header, sizeof(header)) || memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0
+		|| header.version != BINARY_VERSION || header.sourceHash != sourceHash || header.renderer != GetRendererHash())
+	{
+		return false;
+	}
+	std::vector<char> binary(header.length);
+	if (!stream.read(binary.data(), binary.size()))
+	{
+		return false;
+	}
+
+	// the driver may still refuse a binary it made, e.g. after an update that kept the version string.
+	programID = glCreateProgram();
+	glProgramBinary(programID, header.binaryFormat, binary.data(), binary.size());
+	GLint linked = GL_FALSE;
+	glGetProgramiv(programID, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE)
+	{
+		glDeleteProgram(programID);
+		programID = 0;
+		return false;
+	}
+	return true;
+}
+
+void ShaderProgram::SaveProgramBinary(const std::string& cachePath, uint64_t sourceHash)
+{
+	GLint linked = GL_FALSE;
+	GLint length = 0;
+	glGetProgramiv(programID, GL_LINK_STATUS, &linked);
+	glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (linked != GL_TRUE || length == 0)
+	{
+		return;
+	}
+
+	ShaderBinaryHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+	header.version = BINARY_VERSION;
+	header.sourceHash = sourceHash;
+	header.renderer = GetRendererHash();
+	std::vector<char> binary(length);
+	GLsizei written = 0;
+	GLenum format = 0;
+	glGetProgramBinary(programID, length, &written, &format, binary.data());
+	header.binaryFormat = format;
+	header.length = written;
+
+	// written beside the cache and renamed, so a half-written binary is never loaded.
+	std::string temporaryPath = cachePath + ".tmp";
+	StreamWriter writer;
+	if (!writer.Open(temporaryPath))
+	{
+		return;
+	}
+	writer.Write(&header, sizeof(header));
+	writer.Write(binary.data(), written);
+	if (!writer.Close() || rename(temporaryPath.c_str(), cachePath.c_str()) != 0)
+	{
+		std::cout << "COULD NOT WRITE SHADER BINARY " << cachePath << "." << std::endl;
+		remove(temporaryPath.c_str());
+	}
+}
+
+uint64_t ShaderProgram::Hash(const std::string& text)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (int i = 0; i < text.size(); ++i)
+	{
+		hash = (hash ^ (unsigned char)text[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+uint64_t ShaderProgram::GetRendererHash()
+{
+	return Hash(std::string((const char*)glGetString(GL_RENDERER)) + (const char*)glGetString(GL_VERSION));
 }
 
 
@@ -67,6 +193,15 @@ uint ShaderProgram::GetUniformLocation(const std::string& uniformName)
 	return glGetUniformLocation(programID, uniformName.c_str());
 }
 
+void ShaderProgram::BindUniformBlock(const std::string& blockName, uint bindingPoint)
+{
+	uint blockIndex = glGetUniformBlockIndex(programID, blockName.c_str());
+	if (blockIndex != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(programID, blockIndex, bindingPoint);
+	}
+}
+
 
 
 
@@ -106,10 +241,9 @@ void ShaderProgram::LoadShader(uint& shaderID, ShaderType shaderType, const std:
 	}
 }
 
-// TODO: Exception handling for files not existing, etc.
-ShaderProgram::ShaderProgramSource ShaderProgram::ParseShader(const std::string& filePath)
+ShaderProgram::ShaderProgramSource ShaderProgram::ParseShader(const std::string& text)
 {
-	std::ifstream stream(filePath); // get input stream.
+	std::istringstream stream(text); // get input stream.
 	std::string line;
 	std::stringstream ss[3];
 	ShaderType type = none;
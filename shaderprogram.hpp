@@ -7,8 +7,27 @@
 #include <sstream>
 #include <fstream>
 #include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 
 #include "utilities.hpp"
+#include "streamwriter.hpp"
+
+// First bytes of a shader binary cache file, followed by the program binary itself.
+struct ShaderBinaryHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t binaryFormat;
+
+	// The shader file the program was linked from, and the renderer that linked it.
+	// A binary is only good for the driver that made it, so one from another renderer is not used.
+	uint64_t sourceHash;
+	uint64_t renderer;
+	uint64_t length;
+};
 
 // wrapper for basic shader functions. implement them by creating a new shader class
 // that inherits from ShaderProgram.
@@ -24,6 +43,9 @@ public:
 
 	/** Given the path to a text file containing the shader code, load it into the GPU.
 	 * The file path is relative to the makefile.
+	 *
+	 * The linked program is saved to file + ".bin". If that binary was made from the same shader file by the same driver,
+	 * later runs load it instead of compiling and linking again.
 	 * 
 	 * This method should be called when the shader is first initialized.
 	 * A great place to do this would be in the Start function of the engine. */
@@ -66,16 +88,16 @@ private:
 	 *
 	 * This ID is the total sum of all the different shader "pieces" corresponding to this one.
 	 * To add in more shader components, their IDs need to be tracked below. */
-	uint programID;
+	uint programID = 0;
 
-	/** The ID of the vertex shader component. */
-	uint vertexShaderID;
+	/** The ID of the vertex shader component. 0 when the program was loaded from a binary. */
+	uint vertexShaderID = 0;
 
-	/** The ID of the geometry shader component. */
-	uint geometryShaderID;
+	/** The ID of the geometry shader component. 0 when there is no geometry shader. */
+	uint geometryShaderID = 0;
 
 	/** The ID of the fragment shader component. */
-	uint fragmentShaderID;
+	uint fragmentShaderID = 0;
 
 	/** File I/O: load up the shader at the file path. 
 	 *
@@ -90,14 +112,33 @@ private:
 
 
 
-	/** File I/O: parse the shader text file.
+	/** Parse the text of a shader file.
 	 *
-	 * This method takes in a text file and returns the actual shader code as a ShaderProgramSource object.
+	 * This method takes in the text of a shader file and returns the actual shader code as a ShaderProgramSource object.
 	 *
 	 * WARNING: This method assumes that the vertex and fragment shaders are both in the same text file.
 	 * That is, this function will parse the entire file and separate out the vertex and fragment shader code and put those together in a single ShaderProgramSource object.
 	 * If new shader types are added, this function will need to be adjusted. */
-	static ShaderProgramSource ParseShader(const std::string& textfile);
+	static ShaderProgramSource ParseShader(const std::string& text);
+
+	/** Compile and link the program from the text of a shader file. */
+	void CompileProgram(const std::string& text);
+
+	/** Create the program from a cached binary. Returns false, with no program created, if there is no usable binary. */
+	bool LoadProgramBinary(const std::string& cachePath, uint64_t sourceHash);
+
+	/** Write the binary of the linked program to a cache file. */
+	void SaveProgramBinary(const std::string& cachePath, uint64_t sourceHash);
+
+	/** FNV-1a of a string, for the shader text and the renderer. */
+	static uint64_t Hash(const std::string& text);
+
+	/** Hash of the renderer and driver version strings. */
+	static uint64_t GetRendererHash();
+
+	/** Bump when BindAttributes() or the cache layout changes, so old binaries are not used. */
+	static const uint32_t BINARY_VERSION = 1;
+	static constexpr char BINARY_MAGIC[8] = {'R', 'V', 'S', 'H', 'A', 'D', 'E', 'R'};
 
 protected:
 
@@ -134,6 +175,14 @@ protected:
 
 
 
+	/** Connect the uniform block with the given name to a uniform buffer binding point.
+	 *
+	 * Blocks shared between shaders (see FrameUniforms) are uploaded once and read by every shader bound to the same point.
+	 * Shaders that do not use the block are left alone. */
+	void BindUniformBlock(const std::string& blockName, uint bindingPoint);
+
+
+
 	/** Load the uniform variable at the given location.
 	 * 
 	 * This method should be overloaded for all kinds of data that will be sent to the GPU. */
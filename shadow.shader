@@ -3,8 +3,16 @@
 
 in vec4 vPosition;
 
-uniform mat4 uLightPerspectiveMatrix;
-uniform mat4 uLightViewMatrix;
+// Shared with BasicShader through FrameUniforms (std140):
+layout(std140) uniform LightData
+{
+	mat4 uLightViewMatrix;
+	mat4 uLightPerspectiveMatrix;
+	vec4 uLightPosition;
+	vec4 uSpecularColor;
+	vec4 uLightCoefficients; // ambient, diffuse, specular, shininess.
+};
+
 uniform mat4 uTransformMatrix;
 
 void main()
@@ -0,0 +1,209 @@
+#include "shadowmap.hpp"
+
+ShadowMap::ShadowMap() {}
+ShadowMap::~ShadowMap() {}
+
+void ShadowMap::Initialize(int width, int height)
+{
+	this->width = width;
+	this->height = height;
+
+	glGenTextures(1, &depthTextureID);
+	glBindTexture(GL_TEXTURE_2D, depthTextureID);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	// Let the sampler do the depth comparison, which also gives 2x2 filtering for free.
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &framebufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebufferID);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTextureID, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Shadow map framebuffer is incomplete." << std::endl;
+		exit(-1);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	MarkAllDirty();
+}
+
+void ShadowMap::Update(glm::mat4& lightView, glm::mat4& lightPerspective)
+{
+	if (std::memcmp(&lightView, &this->lightView, sizeof(glm::mat4)) != 0
+		|| std::memcmp(&lightPerspective, &this->lightPerspective, sizeof(glm::mat4)) != 0)
+	{
+		this->lightView = lightView;
+		this->lightPerspective = lightPerspective;
+		MarkAllDirty();
+	}
+}
+
+void ShadowMap::MarkDirty(glm::vec3 min, glm::vec3 max)
+{
+	int x0, y0, x1, y1;
+	if (allDirty || !GetTexelRect(min, max, x0, y0, x1, y1))
+	{
+		return;
+	}
+
+	if (dirtyX0 >= dirtyX1)
+	{
+		dirtyX0 = x0;
+		dirtyY0 = y0;
+		dirtyX1 = x1;
+		dirtyY1 = y1;
+	}
+	else
+	{
+		dirtyX0 = std::min(dirtyX0, x0);
+		dirtyY0 = std::min(dirtyY0, y0);
+		dirtyX1 = std::max(dirtyX1, x1);
+		dirtyY1 = std::max(dirtyY1, y1);
+	}
+}
+
+void ShadowMap::MarkDirty(MeshComponent& mesh)
+{
+	glm::vec3 min, max;
+	mesh.GetWorldBounds(min, max);
+	MarkDirty(min, max);
+}
+
+void ShadowMap::MarkAllDirty()
+{
+	allDirty = true;
+}
+
+bool ShadowMap::IsDirty()
+{
+	return allDirty || dirtyX0 < dirtyX1;
+}
+
+bool ShadowMap::Render(ShadowShader& shadowShader, std::vector<MeshComponent>& meshes)
+{
+	PROFILE_SCOPE("ShadowMap::Render");
+	meshesDrawn = 0;
+	if (!IsDirty())
+	{
+		return false;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebufferID);
+	glViewport(0, 0, width, height);
+	glEnable(GL_DEPTH_TEST);
+	glDepthMask(GL_TRUE);
+
+	// Only the stale texels are cleared and drawn into.
+	if (!allDirty)
+	{
+		glEnable(GL_SCISSOR_TEST);
+		glScissor(dirtyX0, dirtyY0, dirtyX1 - dirtyX0, dirtyY1 - dirtyY0);
+	}
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	// Push depths back a little to avoid shadow acne.
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(2.0f, 4.0f);
+
+	shadowShader.Start();
+	glBindVertexArray(GPUMemory::getVAO());
+
+	for (int i = 0; i < meshes.size(); ++i)
+	{
+		// Only the finest level of detail casts shadows.
+		if (meshes[i].getAllocation() == -1 || meshes[i].lodLevel > 0)
+		{
+			continue;
+		}
+
+		// Meshes outside the dirty region are already correct in the map.
+		if (!allDirty)
+		{
+			glm::vec3 min, max;
+			int x0, y0, x1, y1;
+			meshes[i].GetWorldBounds(min, max);
+			if (!GetTexelRect(min, max, x0, y0, x1, y1)
+				|| x1 <= dirtyX0 || x0 >= dirtyX1 || y1 <= dirtyY0 || y0 >= dirtyY1)
+			{
+				continue;
+			}
+		}
+
+		GPUAllocation& allocation = GPUMemory::GetAllocation(meshes[i].getAllocation());
+		shadowShader.LoadTransformMatrix(meshes[i].transform);
+		const void* indexOffset = (const void*)((size_t)allocation.indexOffset * sizeof(uint));
+		glDrawElementsBaseVertex(GL_TRIANGLES, allocation.indexCount, GL_UNSIGNED_INT, indexOffset, allocation.vertexOffset);
+		++meshesDrawn;
+	}
+
+	glBindVertexArray(0);
+	shadowShader.Stop();
+
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glDisable(GL_SCISSOR_TEST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	allDirty = false;
+	dirtyX0 = dirtyY0 = dirtyX1 = dirtyY1 = 0;
+	return true;
+}
+
+bool ShadowMap::GetTexelRect(glm::vec3 min, glm::vec3 max, int& x0, int& y0, int& x1, int& y1)
+{
+	glm::mat4 lightMatrix = lightPerspective * lightView;
+
+	// Project the corners of the box and take the rectangle around them.
+	glm::vec2 low = glm::vec2(std::numeric_limits<float>::max());
+	glm::vec2 high = glm::vec2(-std::numeric_limits<float>::max());
+	for (int i = 0; i < 8; ++i)
+	{
+		glm::vec3 corner = glm::vec3((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+		glm::vec4 clip = lightMatrix * glm::vec4(corner, 1.0f);
+		glm::vec2 ndc = glm::vec2(clip.x, clip.y) / clip.w;
+		low = glm::min(low, ndc);
+		high = glm::max(high, ndc);
+	}
+
+	// NDC to texels, with a texel of margin for filtering.
+	x0 = std::max(0, (int)std::floor((low.x * 0.5f + 0.5f) * width) - 1);
+	y0 = std::max(0, (int)std::floor((low.y * 0.5f + 0.5f) * height) - 1);
+	x1 = std::min(width, (int)std::ceil((high.x * 0.5f + 0.5f) * width) + 1);
+	y1 = std::min(height, (int)std::ceil((high.y * 0.5f + 0.5f) * height) + 1);
+	return x0 < x1 && y0 < y1;
+}
+
+void ShadowMap::Bind(int unit)
+{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D, depthTextureID);
+}
+
+void ShadowMap::CleanUp()
+{
+	glDeleteFramebuffers(1, &framebufferID);
+	glDeleteTextures(1, &depthTextureID);
+	framebufferID = 0;
+	depthTextureID = 0;
+}
+
+int ShadowMap::getWidth()
+{
+	return width;
+}
+int ShadowMap::getHeight()
+{
+	return height;
+}
+uint ShadowMap::getMeshesDrawn()
+{
+	return meshesDrawn;
+}
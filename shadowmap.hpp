@@ -0,0 +1,90 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <iostream>
+#include "glm/glm.hpp"
+
+#include "utilities.hpp"
+#include "meshcomponent.hpp"
+#include "gpumemory.hpp"
+#include "shadowshader.hpp"
+#include "profiler.hpp"
+
+/** Depth texture rendered from the light, with the framebuffer that renders it.
+ *
+ * The shadow map is cached: nothing is drawn in a frame unless something made it stale.
+ * * Changing the light matrices invalidates the whole map.
+ * * Changing a mesh only invalidates the texels covered by its bounds (MarkDirty()).
+ *   Those texels are cleared under a scissor, and only the meshes that overlap them are drawn again.
+ *
+ * A static scene therefore renders the shadow map once and then only samples it. */
+class ShadowMap
+{
+public:
+
+	ShadowMap();
+	~ShadowMap();
+
+	/** Create the depth texture and framebuffer. Needs an OpenGL context. */
+	void Initialize(int width, int height);
+
+	/** Set the light matrices. The map is invalidated if they changed. */
+	void Update(glm::mat4& lightView, glm::mat4& lightPerspective);
+
+	/** Invalidate the part of the map covered by a world-space box, e.g. a chunk that was edited. */
+	void MarkDirty(glm::vec3 min, glm::vec3 max);
+	void MarkDirty(MeshComponent& mesh);
+
+	/** Invalidate the whole map. */
+	void MarkAllDirty();
+
+	/** Whether Render() has anything to do. */
+	bool IsDirty();
+
+	/** Render the stale part of the map, if any. Returns whether anything was drawn.
+	 * The LightData block must be up to date. Leaves the default framebuffer bound. */
+	bool Render(ShadowShader& shadowShader, std::vector<MeshComponent>& meshes);
+
+	/** Bind the depth texture for sampling. */
+	void Bind(int unit);
+
+	/** Release all resources. */
+	void CleanUp();
+
+	// getters:
+	int getWidth();
+	int getHeight();
+	uint getMeshesDrawn();
+
+	/** Texture unit that BasicShader samples the shadow map from. */
+	static const int TEXTURE_UNIT = 4;
+
+private:
+
+	uint framebufferID = 0;
+	uint depthTextureID = 0;
+	int width = 0;
+	int height = 0;
+
+	glm::mat4 lightView = glm::mat4(1);
+	glm::mat4 lightPerspective = glm::mat4(1);
+
+	// Stale texels as [x0, x1) x [y0, y1). Empty when x0 >= x1.
+	bool allDirty = true;
+	int dirtyX0 = 0;
+	int dirtyY0 = 0;
+	int dirtyX1 = 0;
+	int dirtyY1 = 0;
+
+	// Meshes drawn by the last Render().
+	uint meshesDrawn = 0;
+
+	// The texels covered by a world-space box, clamped to the map. Returns false if none are.
+	bool GetTexelRect(glm::vec3 min, glm::vec3 max, int& x0, int& y0, int& x1, int& y1);
+
+};
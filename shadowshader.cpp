@@ -23,23 +23,9 @@ void ShadowShader::BindAttributes()
 // get uniform locations so uniforms can be bound to the correct shader variables.
 void ShadowShader::GetAllUniformLocations()
 {
-	locationProjectionMatrix = GetUniformLocation("uLightPerspectiveMatrix");
-	locationViewMatrix = GetUniformLocation("uLightViewMatrix");
-	locationTransformMatrix = GetUniformLocation("uTransformMatrix");
-}
+	BindUniformBlock(FrameUniforms::LIGHT_BLOCK_NAME, FrameUniforms::LIGHT_BINDING);
 
-// only need one matrix: modelViewProjection = model * view * projection.
-void ShadowShader::LoadProjectionMatrix(glm::mat4& projection)
-{
-	//PrintRowMajor(mvp);
-	LoadUniform(locationProjectionMatrix, projection);
-}
-
-// only need one matrix: modelViewProjection = model * view * projection.
-void ShadowShader::LoadViewMatrix(glm::mat4& view)
-{
-	//PrintRowMajor(mvp);
-	LoadUniform(locationViewMatrix, view);
+	locationTransformMatrix = GetUniformLocation("uTransformMatrix");
 }
 
 void ShadowShader::LoadTransformMatrix(glm::mat4& transform)
@@ -5,10 +5,13 @@
 
 #include "utilities.hpp"
 #include "shaderprogram.hpp"
+#include "frameuniforms.hpp"
 
 /* A simple shader for drawing shadows.
  * This shader runs when rendering the scene from the perspective
  * of the light source.
+ *
+ * The light matrices come from the LightData uniform block shared with BasicShader.
  */
 class ShadowShader : public ShaderProgram
 {
@@ -23,12 +26,6 @@ public:
 	void Initialize();
 
 
-	/** Load the given projection matrix as a uniform. */
-	void LoadProjectionMatrix(glm::mat4& projection);
-
-	/** Load the given view matrix as a uniform. */
-	void LoadViewMatrix(glm::mat4& view);
-
 	/** Load the given transform matrix as a uniform. */
 	void LoadTransformMatrix(glm::mat4& transform);
 
@@ -39,9 +36,7 @@ private:
 	static std::string shaderFile;
 
 
-	/** ID of the MVP matrix given by GetUniformLocation(mvp). */
-	uint locationProjectionMatrix;
-	uint locationViewMatrix;
+	/** ID of the model transform given by GetUniformLocation(). */
 	uint locationTransformMatrix;
 
 
@@ -57,11 +52,10 @@ protected:
 	void BindAttributes();
 
 
-	/** Get all uniform locations from the GPU:
+	/** Get all uniform locations from the GPU and bind the shared blocks:
 	 *
-	 * 1) Projection matrix.
-	 * 2) View matrix.
-	 * 3) Model transform matrix.
+	 * 1) LightData block.
+	 * 2) Model transform matrix.
 	 */
 	void GetAllUniformLocations();
 
@@ -6,6 +6,7 @@ Smoothing::~Smoothing() {}
 
 void Smoothing::SmoothMesh(Polyhedron* p, double dt, Weight type)
 {
+	PROFILE_SCOPE("Smoothing::SmoothMesh");
 	// If the choice of weight is STATIC, we will need a copy of the original vertices.
 	std::vector<Vert> originalVertices;
 	if (type == Weight::CORD_STATIC || type == Weight::MEAN_CURVATURE_STATIC || type == Weight::MEAN_VALUE_STATIC)
@@ -24,7 +25,8 @@ void Smoothing::SmoothMesh(Polyhedron* p, double dt, Weight type)
 		Corner& c = p->clist[i];
 
 		// Check if we have seen this vertex before.
-		if (!checked.count(c.v->index))
+		// Boundary vertices stay where they are, so the edges of neighboring tiles still meet.
+		if (!checked.count(c.v->index) && !c.IsBoundary())
 		{
 			// Get all connected vertices and update the map.
 			Vert* v = c.v;
@@ -272,6 +274,7 @@ void Smoothing::SmoothMesh(Polyhedron* p, double dt, Weight type)
 			v->x = v->x + dt * xSum;
 			v->y = v->y + dt * ySum;
 			v->z = v->z + dt * zSum;
+			p->MarkDirty(v->index);
 
 			//std::cout << "New coordinates: " << v->x << " " << v->y << " " << v->z << std::endl;
 		}
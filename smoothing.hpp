@@ -3,6 +3,7 @@
 #include <map>
 #include <cmath>
 #include "polyhedron.hpp"
+#include "profiler.hpp"
 #include "glm/glm.hpp"
 
 /** Smooth a mesh according to four different weighting schemes:
@@ -27,6 +28,8 @@ class Smoothing
 public:
 
 	// Smoothing algorithms:
+	// Moved vertices are marked dirty; call Polyhedron::UpdateDirtyRegion() afterwards to refresh normals and angles.
+	// Vertices on the boundary of an open mesh are not moved.
 	void static SmoothMesh(Polyhedron* p, double dt, Weight weight);
 
 	// Morse design:
@@ -0,0 +1,218 @@
+#include "streamwriter.hpp"
+
+StreamWriter::StreamWriter(size_t chunkSize)
+{
+	this->chunkSize = chunkSize;
+}
+
+StreamWriter::~StreamWriter()
+{
+	if (file)
+	{
+		Close();
+	}
+}
+
+bool StreamWriter::Open(std::string path)
+{
+	file = fopen(path.c_str(), "wb");
+	if (!file)
+	{
+		std::cout << "COULD NOT OPEN " << path << " FOR WRITING." << std::endl;
+		return false;
+	}
+	size = 0;
+	failed = false;
+	stopping = false;
+	writing = 0;
+
+	chunks = std::vector<Chunk>(CHUNK_COUNT);
+	full.clear();
+	empty.clear();
+	for (int i = 0; i < CHUNK_COUNT; ++i)
+	{
+		chunks[i].data.reset(new char[chunkSize]);
+		empty.push_back(&chunks[i]);
+	}
+	current = empty.front();
+	empty.pop_front();
+	current->size = 0;
+	current->offset = 0;
+
+	writer = std::thread(&StreamWriter::WriterLoop, this);
+	return true;
+}
+
+void StreamWriter::Write(const void* data, size_t bytes)
+{
+	const char* source = (const char*)data;
+	while (bytes > 0)
+	{
+		size_t n = std::min(bytes, chunkSize - current->size);
+		memcpy(current->data.get() + current->size, source, n);
+		current->size += n;
+		size += n;
+		source += n;
+		bytes -= n;
+		if (current->size == chunkSize)
+		{
+			Submit();
+		}
+	}
+}
+
+void StreamWriter::Pad(size_t alignment)
+{
+	static const char zeros[64] = {};
+	while (size % alignment != 0)
+	{
+		Write(zeros, std::min(alignment - size % alignment, sizeof(zeros)));
+	}
+}
+
+void StreamWriter::WriteOrdered(int count, int grain, const std::function<void(int, int, std::vector<char>&)>& produce)
+{
+	int round = Parallel::GetThreadCount() * BLOCKS_PER_THREAD;
+	if (blocks.size() < round)
+	{
+		blocks.resize(round);
+	}
+	for (int first = 0; first < count; first += round * grain)
+	{
+		int roundBlocks = std::min(round, (count - first + grain - 1) / grain);
+		Parallel::For(0, roundBlocks, 1, [&](int begin, int end)
+		{
+			for (int b = begin; b < end; ++b)
+			{
+				int blockBegin = first + b * grain;
+				blocks[b].clear();
+				produce(blockBegin, std::min(blockBegin + grain, count), blocks[b]);
+			}
+		});
+		for (int b = 0; b < roundBlocks; ++b)
+		{
+			Write(blocks[b].data(), blocks[b].size());
+		}
+	}
+}
+
+void StreamWriter::Flush()
+{
+	if (current->size > 0)
+	{
+		Submit();
+	}
+	Drain();
+}
+
+void StreamWriter::Rewrite(uint64_t offset, const void* data, size_t bytes)
+{
+	// The end of the range may still be in the current chunk.
+	const char* source = (const char*)data;
+	if (offset + bytes > current->offset)
+	{
+		uint64_t start = std::max(offset, current->offset);
+		memcpy(current->data.get() + (start - current->offset), source + (start - offset), offset + bytes - start);
+		bytes = start - offset;
+	}
+	if (bytes == 0)
+	{
+		return;
+	}
+
+	// The rest is on disk, or about to be.
+	Drain();
+	if (fseek(file, offset, SEEK_SET) != 0 || fwrite(source, 1, bytes, file) != bytes || fseek(file, 0, SEEK_END) != 0)
+	{
+		failed = true;
+	}
+}
+
+bool StreamWriter::Close()
+{
+	if (!file)
+	{
+		return false;
+	}
+	if (current->size > 0)
+	{
+		Submit();
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	changed.notify_all();
+	writer.join();
+
+	failed = (fclose(file) != 0) || failed;
+	file = NULL;
+	chunks.clear();
+	blocks.clear();
+	if (failed)
+	{
+		std::cout << "WRITE FAILED." << std::endl;
+	}
+	return !failed;
+}
+
+uint64_t StreamWriter::getSize()
+{
+	return size;
+}
+
+size_t StreamWriter::getChunkSize()
+{
+	return chunkSize;
+}
+
+void StreamWriter::Submit()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	full.push_back(current);
+	changed.notify_all();
+	changed.wait(lock, [this]() { return !empty.empty(); });
+	current = empty.front();
+	empty.pop_front();
+	current->size = 0;
+	current->offset = size;
+}
+
+void StreamWriter::Drain()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	changed.wait(lock, [this]() { return full.empty() && writing == 0; });
+}
+
+void StreamWriter::WriterLoop()
+{
+	while (true)
+	{
+		Chunk* chunk;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [this]() { return stopping || !full.empty(); });
+			if (full.empty())
+			{
+				return; // Closing, and everything is written.
+			}
+			chunk = full.front();
+			full.pop_front();
+			++writing;
+		}
+
+		if (onChunk)
+		{
+			onChunk(chunk->offset, chunk->data.get(), chunk->size);
+		}
+		bool written = fwrite(chunk->data.get(), 1, chunk->size, file) == chunk->size;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			failed = failed || !written;
+			--writing;
+			empty.push_back(chunk);
+		}
+		changed.notify_all();
+	}
+}
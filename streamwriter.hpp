@@ -0,0 +1,114 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "parallel.hpp"
+
+/** Writes a file front to back through a fixed set of large buffers.
+ *
+ * Write() copies into the current chunk. Full chunks go to a thread of their own that writes them to disk,
+ * so producing the next chunk and writing the last one overlap. Once every chunk is in flight, Write() waits for one to come back,
+ * so memory use stays at CHUNK_COUNT chunks however big the file gets.
+ * WriteOrdered() produces records on all threads of Parallel and still writes them in order. */
+class StreamWriter
+{
+public:
+
+	/** Chunks are chunkSize bytes; fewer, larger chunks mean fewer calls to fwrite(). */
+	StreamWriter(size_t chunkSize = DEFAULT_CHUNK_SIZE);
+
+	/** Closes the file if it is still open. */
+	~StreamWriter();
+
+	/** Create or truncate the file at path. */
+	bool Open(std::string path);
+
+	/** Append bytes to the file. */
+	void Write(const void* data, size_t bytes);
+
+	/** Append zeros until the file size is a multiple of alignment. */
+	void Pad(size_t alignment);
+
+	/** Append the output of produce(begin, end, out) for every block of grain records of [0, count), in order.
+	 * Blocks are produced in parallel, a few per thread at a time, each into its own reused buffer,
+	 * so the memory used depends on grain and the thread count but not on count. */
+	void WriteOrdered(int count, int grain, const std::function<void(int, int, std::vector<char>&)>& produce);
+
+	/** Write out everything so far and wait until it is on its way to disk. The next chunk starts at the end of the file. */
+	void Flush();
+
+	/** Overwrite bytes that were already written, e.g. a header that is only known at the end.
+	 * Everything before is written out first. */
+	void Rewrite(uint64_t offset, const void* data, size_t bytes);
+
+	/** Write out the rest and close the file. Returns false if anything could not be written. */
+	bool Close();
+
+	/** Called on the writing thread with every chunk just before it is written, in file order.
+	 * Up to the first Flush(), every chunk but the last is chunkSize bytes long and starts at a multiple of chunkSize. */
+	std::function<void(uint64_t, const char*, size_t)> onChunk;
+
+	// getters:
+	uint64_t getSize();
+	size_t getChunkSize();
+
+	static const size_t DEFAULT_CHUNK_SIZE = 4 << 20;
+
+private:
+
+	// A chunk and where it goes in the file.
+	struct Chunk
+	{
+		std::unique_ptr<char[]> data; // Not cleared, so only the pages written to are ever touched.
+		size_t size = 0;
+		uint64_t offset = 0;
+	};
+
+	// Hand the current chunk to the writing thread and take a free one.
+	void Submit();
+
+	// Wait until the writing thread has written every submitted chunk.
+	void Drain();
+
+	void WriterLoop();
+
+	FILE* file = NULL;
+	size_t chunkSize;
+	uint64_t size = 0;
+	bool failed = false;
+
+	std::vector<Chunk> chunks;
+	Chunk* current = NULL;
+	std::deque<Chunk*> full;
+	std::deque<Chunk*> empty;
+	std::thread writer;
+	std::mutex mutex;
+	std::condition_variable changed;
+	bool stopping = false;
+	int writing = 0;
+
+	// Buffers of WriteOrdered(), one per block of a round.
+	std::vector<std::vector<char>> blocks;
+
+	// Chunks per writer: one being filled, the rest queued or being written.
+	static const int CHUNK_COUNT = 3;
+
+	// Blocks per thread in each round of WriteOrdered().
+	static const int BLOCKS_PER_THREAD = 2;
+
+	// No copies: the writing thread holds a pointer to the writer.
+	StreamWriter(const StreamWriter&) = delete;
+	StreamWriter& operator=(const StreamWriter&) = delete;
+
+};
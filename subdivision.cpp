@@ -2,6 +2,7 @@
 
 Polyhedron* Subdivision::LoopSubdivisionHeap(Polyhedron* p)
 {
+	PROFILE_SCOPE("Subdivision::LoopSubdivisionHeap");
 	int originalVertices = p->vlist.size();
 	int originalEdges = p->elist.size();
 	int originalFaces = p->tlist.size();
@@ -108,7 +109,151 @@ Polyhedron* Subdivision::LoopSubdivisionHeap(Polyhedron* p)
 
 	// Don't forget to initialize the clist!
 	Corner c;
-	loop->clist = std::vector<Corner>(3 * loop->tlist.size(), c);
+	loop->clist.assign(3 * loop->tlist.size(), c);
+	return loop;
+}
+
+Polyhedron* Subdivision::AdaptiveLoopSubdivision(Polyhedron* p, const std::vector<double>& triangleValues, double threshold, AdaptiveSubdivisionCounts* counts)
+{
+	PROFILE_SCOPE("Subdivision::AdaptiveLoopSubdivision");
+	int originalFaces = p->tlist.size();
+
+	/** Red-green closure:
+	 * Red triangles are split into four, which splits all three of their edges.
+	 * A neighbour with two split edges cannot be closed with a single bisection, so it becomes red too.
+	 * Repeat until no triangle has exactly two split edges; the ones with one split edge are green.
+	 */
+	std::vector<bool> red(originalFaces, false);
+	std::vector<bool> split(p->elist.size(), false);
+	std::vector<int> pending;
+	for (int i = 0; i < originalFaces; ++i)
+	{
+		if (std::abs(triangleValues[i]) > threshold)
+		{
+			red[i] = true;
+			pending.push_back(i);
+		}
+	}
+	while (!pending.empty())
+	{
+		Triangle* t = &p->tlist[pending.back()];
+		pending.pop_back();
+		for (int j = 0; j < 3; ++j)
+		{
+			Edge* e = t->edges[j];
+			if (split[e->index])
+			{
+				continue;
+			}
+			split[e->index] = true;
+
+			// Check the other triangles of the edge.
+			for (int k = 0; k < e->numberOfTriangles; ++k)
+			{
+				Triangle* s = e->triangles[k];
+				int splitEdges = split[s->edges[0]->index] + split[s->edges[1]->index] + split[s->edges[2]->index];
+				if (!red[s->index] && splitEdges >= 2)
+				{
+					red[s->index] = true;
+					pending.push_back(s->index);
+				}
+			}
+		}
+	}
+
+	int splitCount = std::count(split.begin(), split.end(), true);
+	int redCount = std::count(red.begin(), red.end(), true);
+	Polyhedron* loop = new Polyhedron(p->vlist.size() + splitCount, p->elist.size() + 3 * splitCount, originalFaces + 3 * splitCount);
+
+	/** Even vertices:
+	 * A vertex is only moved by the Loop rule if all of its triangles are red. Others keep their position,
+	 * so the mesh does not shrink away from the parts that are not refined.
+	 */
+	for (int i = 0; i < p->vlist.size(); ++i)
+	{
+		Vert* v = &p->vlist[i];
+		bool surrounded = v->numberOfTriangles > 0;
+		for (int j = 0; j < v->numberOfTriangles; ++j)
+		{
+			surrounded = surrounded && red[v->triangles[j]->index];
+		}
+
+		Vert even = surrounded ? CreateEvenVertex(v) : Vert(v->x, v->y, v->z);
+		even.index = i;
+		loop->vlist.push_back(even);
+	}
+
+	// Odd vertices, on the split edges only:
+	std::vector<int> oddVertices(p->elist.size(), -1);
+	for (int i = 0; i < p->elist.size(); ++i)
+	{
+		if (split[i])
+		{
+			oddVertices[i] = loop->vlist.size();
+			loop->vlist.push_back(CreateOddVertex(&p->elist[i], loop->vlist.size()));
+		}
+	}
+
+	/** Topology:
+	 * Edge j of a triangle runs from its vertex j to vertex j + 1.
+	 * Red triangles are split like in LoopSubdivisionHeap(). Green triangles are cut from the odd vertex to the opposite corner.
+	 */
+	int greenCount = 0;
+	auto addTriangle = [&](Vert* a, Vert* b, Vert* c)
+	{
+		Triangle t;
+		t.index = loop->tlist.size();
+		t.vertices[0] = a;
+		t.vertices[1] = b;
+		t.vertices[2] = c;
+		loop->tlist.push_back(t);
+	};
+	for (int i = 0; i < originalFaces; ++i)
+	{
+		Triangle* t = &p->tlist[i];
+		Vert* v[3];
+		int w[3];
+		for (int j = 0; j < 3; ++j)
+		{
+			v[j] = &loop->vlist[t->vertices[j]->index];
+			w[j] = oddVertices[t->edges[j]->index];
+		}
+
+		if (red[i])
+		{
+			Vert* w0 = &loop->vlist[w[0]];
+			Vert* w1 = &loop->vlist[w[1]];
+			Vert* w2 = &loop->vlist[w[2]];
+			addTriangle(v[0], w0, w2);
+			addTriangle(w0, v[1], w1);
+			addTriangle(w1, v[2], w2);
+			addTriangle(w0, w1, w2);
+		}
+		else if (w[0] != -1 || w[1] != -1 || w[2] != -1)
+		{
+			int j = (w[0] != -1) ? 0 : (w[1] != -1) ? 1 : 2;
+			Vert* odd = &loop->vlist[w[j]];
+			addTriangle(v[j], odd, v[(j + 2) % 3]);
+			addTriangle(odd, v[(j + 1) % 3], v[(j + 2) % 3]);
+			greenCount++;
+		}
+		else
+		{
+			addTriangle(v[0], v[1], v[2]);
+		}
+	}
+
+	if (counts != nullptr)
+	{
+		counts->originalTriangles = originalFaces;
+		counts->refined = redCount;
+		counts->bisected = greenCount;
+		counts->triangles = loop->tlist.size();
+	}
+
+	// Don't forget to initialize the clist!
+	Corner c;
+	loop->clist.assign(3 * loop->tlist.size(), c);
 	return loop;
 }
 
@@ -216,7 +361,7 @@ Polyhedron Subdivision::LoopSubdivision(Polyhedron* p)
 
 	// Don't forget to initialize the clist!
 	Corner c;
-	loop.clist = std::vector<Corner>(3 * loop.tlist.size(), c);
+	loop.clist.assign(3 * loop.tlist.size(), c);
 	return loop;
 }
 
@@ -411,3 +556,40 @@ Vert Subdivision::CreateEvenVertex(Vert* v)
 
 Subdivision::Subdivision() {}
 Subdivision::~Subdivision() {}
+
+std::string Subdivision::Describe(const AdaptiveSubdivisionCounts& counts)
+{
+	return "Adaptive subdivision: " + std::to_string(counts.refined) + " of " + std::to_string(counts.originalTriangles) + " triangles refined, "
+		+ std::to_string(counts.bisected) + " bisected to close the mesh, " + std::to_string(counts.triangles) + " triangles in total.";
+}
+
+Polyhedron* Subdivision::SubdivideMesh(Polyhedron* p, int n, double curvatureThreshold, std::vector<AdaptiveSubdivisionCounts>* counts, std::ostream* log)
+{
+	PROFILE_SCOPE("Subdivision::SubdivideMesh");
+	std::vector<Polyhedron*> loops;
+	Polyhedron* lp;
+	lp = p;
+	loops.push_back(lp);
+	for (int i = 0; i < n; ++i)
+	{
+		Polyhedron* q;
+		if (curvatureThreshold > 0.0)
+		{
+			std::vector<double> curvatures = MeshAnalysis::GetApproximateGaussianCurvatures(loops[i]->tlist);
+			AdaptiveSubdivisionCounts level;
+			q = AdaptiveLoopSubdivision(loops[i], curvatures, curvatureThreshold, &level);
+			if (counts != nullptr)
+			{
+				counts->push_back(level);
+			}
+		}
+		else
+		{
+			q = LoopSubdivisionHeap(loops[i]);
+		}
+		q->Initialize(log);
+		loops.push_back(q);
+		delete(loops[i]);
+	}
+	return loops.back();
+}
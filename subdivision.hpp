@@ -1,7 +1,18 @@
 #pragma once
 
 #include <map>
+#include <string>
 #include "polyhedron.hpp"
+#include "profiler.hpp"
+
+// What one level of adaptive subdivision did, for the caller to report.
+struct AdaptiveSubdivisionCounts
+{
+	int originalTriangles = 0;
+	int refined = 0; // Split 1 -> 4.
+	int bisected = 0; // Split 1 -> 2 to close the mesh.
+	int triangles = 0; // In the result.
+};
 
 /** Loop subdivision.
  * Goal: given a mesh, output a new mesh that has been subdivided according to Loop subdivision. */
@@ -14,6 +25,22 @@ public:
 	Polyhedron static LoopSubdivision(Polyhedron* p);
 	static Polyhedron* LoopSubdivisionHeap(Polyhedron* p);
 
+	// Adaptive Loop subdivision: only triangles whose value has a magnitude above threshold are split 1 -> 4,
+	// e.g. with MeshAnalysis::GetApproximateGaussianCurvatures() or a horizon measure, one value per triangle.
+	// Red-green refinement keeps the mesh conforming: a triangle with two split edges is split 1 -> 4 as well,
+	// and a triangle with one split edge is bisected 1 -> 2 from the new vertex.
+	// Vertices only move by the Loop rule if every triangle around them is split, so unrefined regions stay where they were.
+	// p must be initialized; the result is not. If counts is given, it is filled in.
+	static Polyhedron* AdaptiveLoopSubdivision(Polyhedron* p, const std::vector<double>& triangleValues, double threshold, AdaptiveSubdivisionCounts* counts = nullptr);
+
+	// Subdivide n times. With a curvature threshold, only the triangles whose approximate Gaussian curvature is above it are refined,
+	// and the counts of every level are appended to counts, if given.
+	// p must be initialized and is deleted if n > 0; the result is initialized, printing to log like Polyhedron::Initialize().
+	static Polyhedron* SubdivideMesh(Polyhedron* p, int n, double curvatureThreshold, std::vector<AdaptiveSubdivisionCounts>* counts = nullptr, std::ostream* log = &std::cout);
+
+	// e.g. "Adaptive subdivision: 120 of 500 triangles refined, 40 bisected to close the mesh, 940 triangles in total."
+	static std::string Describe(const AdaptiveSubdivisionCounts& counts);
+
 private:
 
 	// Get the appropriate linear combination of adjacent vertices.
@@ -0,0 +1,144 @@
+#include "taskgraph.hpp"
+
+TaskGraph::TaskGraph() {}
+TaskGraph::~TaskGraph() {}
+
+int TaskGraph::AddTask(const std::string& name, std::function<void()> work, std::vector<int> dependencies)
+{
+	int index = tasks.size();
+	GraphTask task;
+	task.name = name;
+	task.work = work;
+	task.dependencyCount = dependencies.size();
+	tasks.push_back(task);
+
+	for (int i = 0; i < dependencies.size(); ++i)
+	{
+		tasks[dependencies[i]].dependents.push_back(index);
+	}
+	return index;
+}
+
+void TaskGraph::Run()
+{
+	startTime = std::chrono::high_resolution_clock::now();
+	state = std::make_shared<GraphRunState>();
+	state->remaining.resize(tasks.size());
+	state->unfinished = tasks.size();
+	for (int i = 0; i < tasks.size(); ++i)
+	{
+		state->remaining[i] = tasks[i].dependencyCount;
+	}
+
+	// Start everything that has no dependencies; the rest is started as tasks finish.
+	std::unique_lock<std::mutex> lock(state->mutex);
+	for (int i = 0; i < tasks.size(); ++i)
+	{
+		if (tasks[i].dependencyCount == 0)
+		{
+			Start(i);
+		}
+	}
+
+	// The calling thread works too, until every task is done.
+	while (state->unfinished > 0)
+	{
+		if (state->ready.empty())
+		{
+			state->changed.wait(lock);
+			continue;
+		}
+		int task = state->ready.front();
+		state->ready.pop_front();
+		lock.unlock();
+		Execute(task);
+		lock.lock();
+	}
+	totalMilliseconds = Now();
+}
+
+void TaskGraph::Start(int index)
+{
+	state->ready.push_back(index);
+	state->changed.notify_all();
+
+	std::shared_ptr<GraphRunState> run = state;
+	ThreadPool::GetShared().Submit([this, run]()
+	{
+		int task;
+		{
+			std::lock_guard<std::mutex> lock(run->mutex);
+			if (run->ready.empty())
+			{
+				return;
+			}
+			task = run->ready.front();
+			run->ready.pop_front();
+		}
+		Execute(task);
+	});
+}
+
+void TaskGraph::Execute(int index)
+{
+	GraphTask& task = tasks[index];
+	task.start = Now();
+	{
+		PROFILE_SCOPE(Profiler::Intern(task.name));
+		task.work();
+	}
+	task.end = Now();
+
+	// Release the tasks that were waiting on this one.
+	std::lock_guard<std::mutex> lock(state->mutex);
+	for (int i = 0; i < task.dependents.size(); ++i)
+	{
+		int dependent = task.dependents[i];
+		if (--state->remaining[dependent] == 0)
+		{
+			Start(dependent);
+		}
+	}
+	if (--state->unfinished == 0)
+	{
+		state->changed.notify_all();
+	}
+}
+
+void TaskGraph::PrintTimings(std::ostream& out)
+{
+	char line[256];
+	for (int i = 0; i < tasks.size(); ++i)
+	{
+		GraphTask& task = tasks[i];
+		snprintf(line, sizeof(line), "%-28s%10.2f -> %10.2f  (%.2f ms)", task.name.c_str(), task.start, task.end, task.end - task.start);
+		out << line << std::endl;
+	}
+	snprintf(line, sizeof(line), "%-28s%10.2f ms", "Total", totalMilliseconds);
+	out << line << std::endl;
+}
+
+int TaskGraph::getTaskCount()
+{
+	return tasks.size();
+}
+
+const std::string& TaskGraph::getName(int task)
+{
+	return tasks[task].name;
+}
+
+double TaskGraph::getMilliseconds(int task)
+{
+	return tasks[task].end - tasks[task].start;
+}
+double TaskGraph::getTotalMilliseconds()
+{
+	return totalMilliseconds;
+}
+
+double TaskGraph::Now()
+{
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+	return elapsed.count();
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <chrono>
+#include <iostream>
+#include <cstdio>
+
+#include "utilities.hpp"
+#include "threadpool.hpp"
+#include "profiler.hpp"
+
+/** A task of a TaskGraph and when it ran. */
+struct GraphTask
+{
+	std::string name;
+	std::function<void()> work;
+	std::vector<int> dependents;
+	int dependencyCount = 0;
+
+	// Milliseconds since the start of TaskGraph::Run().
+	double start = 0.0;
+	double end = 0.0;
+};
+
+/** What a TaskGraph shares with the pool jobs it submits while running.
+ *
+ * A job may only get to run after Run() has returned, so it holds on to this rather than to the graph.
+ * A job that finds no task ready touches nothing else. */
+struct GraphRunState
+{
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<int> ready; // Tasks whose dependencies have all finished, not yet taken by a thread.
+	std::vector<int> remaining; // Unfinished dependencies of each task.
+	int unfinished = 0;
+};
+
+/** A set of tasks with dependencies between them, run on the shared ThreadPool.
+ *
+ * A task is started as soon as every task it depends on has finished, so independent tasks run side by side.
+ * Tasks may use Parallel::For() themselves, and Run() may be called from inside a pool task:
+ * like Parallel::For(), the calling thread takes ready tasks too, so it never waits on jobs queued behind itself.
+ * Run() records when each task started and finished, for PrintTimings(). */
+class TaskGraph
+{
+public:
+
+	TaskGraph();
+	~TaskGraph();
+
+	/** Add a task that may only start after the given tasks. Returns its index, for use as a dependency. */
+	int AddTask(const std::string& name, std::function<void()> work, std::vector<int> dependencies = {});
+
+	/** Run every task and return when all have finished. */
+	void Run();
+
+	/** Print the start, end and duration of every task, and the total time. The format flags of out are left alone. */
+	void PrintTimings(std::ostream& out = std::cout);
+
+	// getters:
+	int getTaskCount();
+	const std::string& getName(int task);
+	double getMilliseconds(int task);
+	double getTotalMilliseconds();
+
+private:
+
+	std::vector<GraphTask> tasks;
+
+	std::shared_ptr<GraphRunState> state;
+
+	std::chrono::high_resolution_clock::time_point startTime;
+	double totalMilliseconds = 0.0;
+
+	// Mark a task ready and submit a job to the pool to take it. Call with the state mutex held.
+	void Start(int task);
+
+	// Run a task, then mark the tasks waiting on it ready.
+	void Execute(int task);
+
+	double Now();
+
+};
@@ -0,0 +1,423 @@
+#include "textureloader.hpp"
+
+constexpr char TextureLoader::MAGIC[8];
+std::unordered_map<std::string, uint> TextureLoader::textures;
+
+uint TextureLoader::Load(std::string path)
+{
+	std::unordered_map<std::string, uint>::iterator loaded = textures.find(path);
+	if (loaded != textures.end())
+	{
+		return loaded->second;
+	}
+
+	int file = open(path.c_str(), O_RDONLY);
+	struct stat status;
+	if (file == -1 || fstat(file, &status) != 0 || status.st_size == 0)
+	{
+		std::cout << "COULD NOT OPEN TEXTURE " << path << "." << std::endl;
+		if (file != -1)
+			close(file);
+		return 0;
+	}
+	uint64_t sourceSize = status.st_size;
+	int64_t sourceTime = (int64_t)status.st_mtim.tv_sec * 1000000000 + status.st_mtim.tv_nsec;
+
+	uint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+
+	// Compressed mipmaps made by an earlier run:
+	std::string cachePath = path + ".texcache";
+	if (LoadCache(cachePath, sourceSize, sourceTime))
+	{
+		close(file);
+		SetParameters();
+		glBindTexture(GL_TEXTURE_2D, 0);
+		textures[path] = texture;
+		return texture;
+	}
+
+	void* mapping = mmap(NULL, sourceSize, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (mapping == MAP_FAILED)
+	{
+		std::cout << "COULD NOT OPEN TEXTURE " << path << "." << std::endl;
+		glDeleteTextures(1, &texture);
+		return 0;
+	}
+	madvise(mapping, sourceSize, MADV_SEQUENTIAL);
+
+	TextureImage image;
+	const unsigned char* data = (const unsigned char*)mapping;
+	bool decoded = DecodeBMP(data, sourceSize, image) || DecodePPM(data, sourceSize, image);
+	if (!decoded)
+	{
+		std::cout << "TEXTURE " << path << " IS NOT AN UNCOMPRESSED 24 OR 32 BIT .BMP OR A BINARY .PPM." << std::endl;
+		munmap(mapping, sourceSize);
+		glDeleteTextures(1, &texture);
+		return 0;
+	}
+
+	// Let the driver compress the image and make the mipmaps, once.
+	glPixelStorei(GL_UNPACK_ALIGNMENT, image.alignment);
+	glTexImage2D(GL_TEXTURE_2D, 0, image.alpha ? GL_COMPRESSED_RGBA : GL_COMPRESSED_RGB, image.width, image.height, 0, image.format, GL_UNSIGNED_BYTE, image.pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	munmap(mapping, sourceSize);
+
+	GLint compressed = GL_FALSE;
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+	if (compressed == GL_TRUE)
+	{
+		SaveCache(cachePath, sourceSize, sourceTime);
+	}
+
+	std::cout << "Loaded texture " << path << ": " << image.width << " x " << image.height << std::endl;
+	SetParameters();
+	glBindTexture(GL_TEXTURE_2D, 0);
+	textures[path] = texture;
+	return texture;
+}
+
+void TextureLoader::CleanUp()
+{
+	for (std::unordered_map<std::string, uint>::iterator i = textures.begin(); i != textures.end(); ++i)
+	{
+		glDeleteTextures(1, &i->second);
+	}
+	textures.clear();
+}
+
+uint TextureLoader::GetTextureCount()
+{
+	return textures.size();
+}
+
+size_t TextureLoader::GetBytes()
+{
+	size_t bytes = 0;
+	for (std::unordered_map<std::string, uint>::iterator i = textures.begin(); i != textures.end(); ++i)
+	{
+		glBindTexture(GL_TEXTURE_2D, i->second);
+		for (int level = 0; ; ++level)
+		{
+			GLint width = 0;
+			GLint height = 0;
+			GLint compressed = GL_FALSE;
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &height);
+			if (width == 0 || height == 0)
+			{
+				break;
+			}
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED, &compressed);
+			if (compressed == GL_TRUE)
+			{
+				GLint size = 0;
+				glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+				bytes += size;
+			}
+			else
+			{
+				// Drivers pad RGB to four bytes a texel.
+				bytes += (size_t)width * height * 4;
+			}
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return bytes;
+}
+
+bool TextureLoader::DecodeBMP(const unsigned char* data, size_t size, TextureImage& image)
+{
+	// File header (14 bytes) and the start of the info header (40 bytes), little endian.
+	if (size < 54 || data[0] != 'B' || data[1] != 'M')
+	{
+		return false;
+	}
+	uint32_t pixelOffset;
+	uint32_t headerSize;
+	int32_t width, height;
+	uint16_t bitCount;
+	uint32_t compression;
+	memcpy(&pixelOffset, data + 10, 4);
+	memcpy(&headerSize, data + 14, 4);
+	memcpy(&width, data + 18, 4);
+	memcpy(&height, data + 22, 4);
+	memcpy(&bitCount, data + 28, 2);
+	memcpy(&compression, data + 30, 4);
+
+	// Uncompressed BGR, or 32 bit BGR with an unused fourth byte, or 32 bit BGR(A) with bit fields that say so.
+	const uint32_t BI_RGB = 0;
+	const uint32_t BI_BITFIELDS = 3;
+	if (!(bitCount == 24 && compression == BI_RGB) && !(bitCount == 32 && (compression == BI_RGB || compression == BI_BITFIELDS)))
+	{
+		return false;
+	}
+
+	// The red, green and blue masks follow the 40 byte info header, or are part of a longer one.
+	// Only headers of 56 bytes or more have an alpha mask; the fourth byte is alpha only if that mask says so.
+	bool alpha = false;
+	if (compression == BI_BITFIELDS)
+	{
+		uint32_t masks[4] = {0, 0, 0, 0};
+		int maskCount = (headerSize >= 56) ? 4 : 3;
+		if (size < 54 + 4 * maskCount)
+		{
+			return false;
+		}
+		memcpy(masks, data + 54, 4 * maskCount);
+		if (masks[0] != 0x00FF0000 || masks[1] != 0x0000FF00 || masks[2] != 0x000000FF || (masks[3] != 0 && masks[3] != 0xFF000000))
+		{
+			return false;
+		}
+		alpha = (masks[3] == 0xFF000000);
+	}
+
+	// Rows are padded to 4 bytes, which is also OpenGL's default unpack alignment.
+	size_t rowBytes = ((size_t)width * bitCount / 8 + 3) & ~(size_t)3;
+	int rows = (height < 0) ? -height : height;
+	if (width <= 0 || pixelOffset + rowBytes * rows > size)
+	{
+		return false;
+	}
+
+	image.pixels = data + pixelOffset;
+	image.width = width;
+	image.height = rows;
+	image.format = (bitCount == 32) ? GL_BGRA : GL_BGR;
+	image.alignment = 4;
+	image.alpha = alpha;
+
+	// A negative height means the top row comes first.
+	if (height < 0)
+	{
+		FlipRows(image, rowBytes);
+	}
+	return true;
+}
+
+bool TextureLoader::DecodePPM(const unsigned char* data, size_t size, TextureImage& image)
+{
+	// "P6", then width, height and the largest value as text, separated by whitespace and comments, then one whitespace byte.
+	if (size < 2 || data[0] != 'P' || data[1] != '6')
+	{
+		return false;
+	}
+	size_t position = 2;
+	int values[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		while (position < size && (isspace(data[position]) || data[position] == '#'))
+		{
+			if (data[position] == '#')
+			{
+				while (position < size && data[position] != '\n')
+					++position;
+			}
+			else
+			{
+				++position;
+			}
+		}
+		values[i] = 0;
+		if (position >= size || !isdigit(data[position]))
+		{
+			return false;
+		}
+		while (position < size && isdigit(data[position]))
+		{
+			values[i] = 10 * values[i] + (data[position++] - '0');
+		}
+	}
+	++position;
+
+	// Only 8 bits per channel.
+	size_t rowBytes = 3 * (size_t)values[0];
+	if (values[0] <= 0 || values[1] <= 0 || values[2] != 255 || position + rowBytes * values[1] > size)
+	{
+		return false;
+	}
+
+	image.pixels = data + position;
+	image.width = values[0];
+	image.height = values[1];
+	image.format = GL_RGB;
+	image.alignment = 1;
+	image.alpha = false;
+
+	// PPM stores the top row first.
+	FlipRows(image, rowBytes);
+	return true;
+}
+
+void TextureLoader::FlipRows(TextureImage& image, size_t rowBytes)
+{
+	const unsigned char* source = image.pixels;
+	image.flipped.resize(rowBytes * image.height);
+	unsigned char* flipped = image.flipped.data();
+	int height = image.height;
+	Parallel::For(0, height, 64, [&](int begin, int end)
+	{
+		for (int row = begin; row < end; ++row)
+		{
+			memcpy(flipped + rowBytes * row, source + rowBytes * (height - 1 - row), rowBytes);
+		}
+	});
+	image.pixels = flipped;
+}
+
+bool TextureLoader::LoadCache(std::string cachePath, uint64_t sourceSize, int64_t sourceTime)
+{
+	int file = open(cachePath.c_str(), O_RDONLY);
+	if (file == -1)
+	{
+		return false;
+	}
+	struct stat status;
+	if (fstat(file, &status) != 0 || status.st_size < (off_t)sizeof(TextureCacheHeader))
+	{
+		close(file);
+		return false;
+	}
+	size_t size = status.st_size;
+	void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (mapping == MAP_FAILED)
+	{
+		return false;
+	}
+	const char* data = (const char*)mapping;
+
+	TextureCacheHeader header;
+	memcpy(&header, data, sizeof(header));
+	bool valid = memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == VERSION
+		&& header.sourceSize == sourceSize && header.sourceTime == sourceTime && header.renderer == GetRendererHash()
+		&& header.levels > 0 && sizeof(header) + header.levels * sizeof(TextureCacheLevel) <= size;
+
+	// Check every level fits before uploading any.
+	const TextureCacheLevel* levels = (const TextureCacheLevel*)(data + sizeof(header));
+	uint64_t offset = sizeof(header) + (valid ? header.levels * sizeof(TextureCacheLevel) : 0);
+	for (uint32_t i = 0; valid && i < header.levels; ++i)
+	{
+		offset += (levels[i].size + 7) & ~(uint64_t)7;
+		valid = offset <= size;
+	}
+	if (!valid)
+	{
+		munmap(mapping, size);
+		return false;
+	}
+
+	offset = sizeof(header) + header.levels * sizeof(TextureCacheLevel);
+	for (uint32_t i = 0; i < header.levels; ++i)
+	{
+		glCompressedTexImage2D(GL_TEXTURE_2D, i, header.internalFormat, levels[i].width, levels[i].height, 0, levels[i].size, data + offset);
+		offset += (levels[i].size + 7) & ~(uint64_t)7;
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header.levels - 1);
+
+	// A driver that cannot use the format rejects the levels, which then do not have the size and format written to the cache.
+	// Start over from the image then. The texture itself is checked rather than glGetError(), which also holds errors of earlier calls.
+	GLint internalFormat = 0;
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+	valid = internalFormat == header.internalFormat;
+	for (uint32_t i = 0; valid && i < header.levels; ++i)
+	{
+		GLint width = 0;
+		GLint height = 0;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_HEIGHT, &height);
+		valid = width == levels[i].width && height == levels[i].height;
+	}
+	munmap(mapping, size);
+	if (!valid)
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+		return false;
+	}
+	return true;
+}
+
+void TextureLoader::SaveCache(std::string cachePath, uint64_t sourceSize, int64_t sourceTime)
+{
+	TextureCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.sourceSize = sourceSize;
+	header.sourceTime = sourceTime;
+	header.renderer = GetRendererHash();
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &header.internalFormat);
+
+	// Every level down to 1 x 1.
+	std::vector<TextureCacheLevel> levels;
+	while (true)
+	{
+		GLint width, height, size;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, levels.size(), GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, levels.size(), GL_TEXTURE_HEIGHT, &height);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, levels.size(), GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+		if (width == 0 || height == 0)
+		{
+			break;
+		}
+		TextureCacheLevel level;
+		level.width = width;
+		level.height = height;
+		level.size = size;
+		levels.push_back(level);
+		if (width == 1 && height == 1)
+		{
+			break;
+		}
+	}
+	header.levels = levels.size();
+
+	// Written beside the cache and renamed, so a cache that is being written is never loaded.
+	std::string temporaryPath = cachePath + ".tmp";
+	StreamWriter writer;
+	if (!writer.Open(temporaryPath))
+	{
+		return;
+	}
+	writer.Write(&header, sizeof(header));
+	writer.Write(levels.data(), levels.size() * sizeof(TextureCacheLevel));
+	std::vector<char> pixels;
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	for (int i = 0; i < levels.size(); ++i)
+	{
+		pixels.resize(levels[i].size);
+		glGetCompressedTexImage(GL_TEXTURE_2D, i, pixels.data());
+		writer.Write(pixels.data(), pixels.size());
+		writer.Pad(8);
+	}
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	if (!writer.Close() || rename(temporaryPath.c_str(), cachePath.c_str()) != 0)
+	{
+		std::cout << "COULD NOT WRITE TEXTURE CACHE " << cachePath << "." << std::endl;
+		remove(temporaryPath.c_str());
+	}
+}
+
+uint64_t TextureLoader::GetRendererHash()
+{
+	std::string renderer = std::string((const char*)glGetString(GL_RENDERER)) + (const char*)glGetString(GL_VERSION);
+
+	// FNV-1a:
+	uint64_t hash = 14695981039346656037ull;
+	for (int i = 0; i < renderer.size(); ++i)
+	{
+		hash = (hash ^ (unsigned char)renderer[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+void TextureLoader::SetParameters()
+{
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+}
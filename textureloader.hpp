@@ -0,0 +1,111 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "utilities.hpp"
+#include "parallel.hpp"
+#include "streamwriter.hpp"
+
+// Pixels of a decoded image, ready for glTexImage2D(). The first row is the bottom one, as OpenGL expects.
+struct TextureImage
+{
+	const unsigned char* pixels = NULL;
+	int width = 0;
+	int height = 0;
+	GLenum format = GL_RGB; // GL_BGR, GL_BGRA or GL_RGB.
+	int alignment = 4; // Row alignment in bytes, for GL_UNPACK_ALIGNMENT.
+	bool alpha = false;
+
+	// Rows flipped into memory, for files that store the top row first. Empty when pixels point into the file.
+	std::vector<unsigned char> flipped;
+};
+
+// First bytes of a texture cache file: the compressed mipmaps of one texture, as the driver made them.
+struct TextureCacheHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t levels;
+
+	// The image the mipmaps were made from, and the renderer that compressed them.
+	// Compressed formats are up to the driver, so a cache from another renderer is not used.
+	uint64_t sourceSize;
+	int64_t sourceTime;
+	uint64_t renderer;
+
+	int32_t internalFormat;
+	int32_t padding;
+};
+
+// Size of one mipmap level in a texture cache file. The levels follow the table, each 8-byte aligned.
+struct TextureCacheLevel
+{
+	int32_t width;
+	int32_t height;
+	uint64_t size;
+};
+
+/** Static class to load textures from .bmp and binary .ppm files, with mipmaps.
+ *
+ * Files are memory mapped. Uncompressed 24 and 32 bit BMP rows are already bottom-up, padded to 4 bytes and in BGR order,
+ * so they go to glTexImage2D() straight from the mapping with GL_BGR or GL_BGRA; nothing is swizzled on the CPU.
+ * A 32 bit BMP only has alpha if its bit fields give the fourth byte an alpha mask; BMPs with other masks are not read.
+ *
+ * The first time a file is loaded, the driver compresses it and generates its mipmaps, and the compressed levels
+ * are written next to it as file + ".texcache". Later loads map that file and hand the levels to glCompressedTexImage2D().
+ * Loaded textures are kept by path, so loading a file twice returns the same texture. */
+class TextureLoader
+{
+
+public:
+
+	// The texture of the file at path, loading it if needed. Needs an OpenGL context. Returns 0 if the file cannot be read.
+	static uint Load(std::string path);
+
+	// Delete every loaded texture.
+	static void CleanUp();
+
+	// Number of loaded textures, and the bytes of all their mip levels as the driver stores them.
+	static uint GetTextureCount();
+	static size_t GetBytes();
+
+private:
+
+	TextureLoader();
+	~TextureLoader();
+
+	// Point image at the pixels of a BMP or PPM file in memory. Returns false if the format is not supported.
+	static bool DecodeBMP(const unsigned char* data, size_t size, TextureImage& image);
+	static bool DecodePPM(const unsigned char* data, size_t size, TextureImage& image);
+
+	// Copy the rows of image in reverse order, in parallel.
+	static void FlipRows(TextureImage& image, size_t rowBytes);
+
+	// Upload the compressed levels of a cache file into the bound texture. Returns false if the cache does not match.
+	static bool LoadCache(std::string cachePath, uint64_t sourceSize, int64_t sourceTime);
+
+	// Write the compressed levels of the bound texture to a cache file.
+	static void SaveCache(std::string cachePath, uint64_t sourceSize, int64_t sourceTime);
+
+	// Hash of the renderer and driver version strings.
+	static uint64_t GetRendererHash();
+
+	static void SetParameters();
+
+	static std::unordered_map<std::string, uint> textures;
+
+	static const uint32_t VERSION = 1;
+	static constexpr char MAGIC[8] = {'R', 'V', 'T', 'E', 'X', '\0', '\0', '\0'};
+
+};
@@ -0,0 +1,76 @@
+#include "threadpool.hpp"
+
+// Set on worker threads.
+static thread_local bool isWorker = false;
+
+ThreadPool::ThreadPool(uint threads)
+{
+	if (threads == 0)
+	{
+		threads = std::thread::hardware_concurrency();
+		if (threads == 0)
+			threads = 1;
+	}
+	for (uint i = 0; i < threads; ++i)
+	{
+		workers.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	available.notify_all();
+	for (int i = 0; i < workers.size(); ++i)
+	{
+		workers[i].join();
+	}
+}
+
+void ThreadPool::Submit(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(std::move(job));
+	}
+	available.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+	isWorker = true;
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			available.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (jobs.empty())
+			{
+				return; // Stopping, and nothing left to do.
+			}
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		job();
+	}
+}
+
+uint ThreadPool::getThreadCount()
+{
+	return workers.size();
+}
+
+ThreadPool& ThreadPool::GetShared()
+{
+	static ThreadPool shared;
+	return shared;
+}
+
+bool ThreadPool::IsWorkerThread()
+{
+	return isWorker;
+}
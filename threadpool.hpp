@@ -0,0 +1,52 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include <deque>
+
+#include "utilities.hpp"
+
+/** A fixed set of worker threads that run submitted jobs in order of submission.
+ *
+ * Threads are started once and reused, so short parallel loops do not pay for creating threads.
+ * GetShared() returns the pool used by Parallel::For() and TaskGraph. */
+class ThreadPool
+{
+public:
+
+	/** Start the given number of workers. 0 means one per hardware thread. */
+	ThreadPool(uint threads = 0);
+
+	/** Finish the queued jobs and join the workers. */
+	~ThreadPool();
+
+	/** Queue a job. It runs on some worker thread. */
+	void Submit(std::function<void()> job);
+
+	// getters:
+	uint getThreadCount();
+
+	/** The pool shared by the whole program, started on first use. */
+	static ThreadPool& GetShared();
+
+	/** Whether the calling thread is a worker of any ThreadPool. */
+	static bool IsWorkerThread();
+
+private:
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable available;
+	bool stopping = false;
+
+	void WorkerLoop();
+
+	// No copies: the workers hold a pointer to the pool.
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+};
@@ -1,6 +1,30 @@
 #pragma once
 
+#include <chrono>
+
 // this class contains convenient things like typedefs or enums.
 
 // typedefs:
 typedef unsigned int uint;
+
+// Milliseconds from start until now.
+inline double Milliseconds(std::chrono::high_resolution_clock::time_point start)
+{
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+	return elapsed.count();
+}
+
+/** A view of count consecutive elements owned by some other container.
+ * Copying a Span copies the pointer, not the elements. */
+template <typename T>
+struct Span
+{
+	T* data = nullptr;
+	int count = 0;
+
+	T& operator[](int i) const { return data[i]; }
+	T* begin() const { return data; }
+	T* end() const { return data + count; }
+	int size() const { return count; }
+	bool empty() const { return count == 0; }
+};